@@ -37,6 +37,7 @@
 #define BIGHASH_AUTOGROW 0
 
 struct bighash_entry_s;
+struct histogram;
 
 /**
  * All hash tables are arrays of list_head structures.
@@ -55,12 +56,43 @@ typedef struct bighash_table_s {
     /** The hash bucket array should be automatically grown when the load
      * factor is exceeded */
 #define BIGHASH_TABLE_F_AUTOGROW 0x4
+    /** The hash bucket array should be resized incrementally, a few
+     * buckets per operation, instead of all at once */
+#define BIGHASH_TABLE_F_INCREMENTAL 0x8
+    /** The hash bucket array should be automatically shrunk when the load
+     * factor drops below BIGHASH_CONFIG_SHRINK_LOAD_FACTOR */
+#define BIGHASH_TABLE_F_AUTOSHRINK 0x10
+    /** The table is registered with bighash_stats_register */
+#define BIGHASH_TABLE_F_STATS_REGISTERED 0x20
 
     /** Table Flags */
     uint32_t flags;
 
     /** Current number of entries in this table. */
     int entry_count;
+
+    /** Bucket array being drained by an incremental resize, or NULL */
+    struct bighash_entry_s **old_buckets;
+    /** Number of buckets in old_buckets */
+    int old_bucket_count;
+    /** Next old bucket to migrate. Lower old buckets are empty. */
+    int migrate_bucket;
+    /** Iterations in progress. Migration pauses while nonzero. */
+    int iterators;
+
+    /** Number of times the table has grown */
+    int grow_count;
+    /** Number of times the table has shrunk */
+    int shrink_count;
+
+#if BIGHASH_CONFIG_INCLUDE_PROBE_STATS == 1
+    /** Number of bighash_first calls */
+    uint64_t lookup_count;
+    /** Number of entries examined by bighash_first */
+    uint64_t probe_count;
+    /** Optional histogram of entries examined per lookup */
+    struct histogram *probe_hist;
+#endif
 } bighash_table_t;
 
 
@@ -68,9 +100,10 @@ typedef struct bighash_table_s {
  * Iterator over hastable entries
  */
 typedef struct bighash_iter_s {
-    /** Hashtable. Must not be freed during iteration */
+    /** Hashtable. Must not be freed during iteration. NULL once finished. */
     bighash_table_t *table;
-    /** Current bucket in the iteration */
+    /** Current bucket in the iteration. The old buckets of a resize in
+     * progress come first, then the new ones. */
     int current_bucket;
     /** Next entry in the iteration, or NULL if at end of bucket */
     struct bighash_entry_s *next_entry;
@@ -97,6 +130,25 @@ typedef struct bighash_entry_s {
  */
 bighash_table_t *bighash_table_create(int bucket_count);
 
+/**
+ * @brief Create a hash table with additional flags.
+ * @param bucket_count Number of buckets to allocation.
+ * @param flags BIGHASH_TABLE_F_INCREMENTAL, BIGHASH_TABLE_F_AUTOSHRINK
+ * @returns The new hash table.
+ * @note With BIGHASH_TABLE_F_INCREMENTAL and BIGHASH_AUTOGROW the old and
+ * new bucket arrays coexist after a resize is triggered, and each
+ * insert, lookup and remove migrates at most
+ * BIGHASH_CONFIG_INCREMENTAL_BUCKETS old buckets.
+ * @note With BIGHASH_TABLE_F_AUTOSHRINK and BIGHASH_AUTOGROW the table is
+ * shrunk by bighash_remove once the load factor is below
+ * BIGHASH_CONFIG_SHRINK_LOAD_FACTOR, through the same resize as a grow,
+ * so incrementally with BIGHASH_TABLE_F_INCREMENTAL. A remove doesn't
+ * start a shrink while another resize or an iteration is in progress.
+ * The new size leaves the table half way to BIGHASH_CONFIG_LOAD_FACTOR
+ * so it does not immediately grow again.
+ */
+bighash_table_t *bighash_table_create_flags(int bucket_count, uint32_t flags);
+
 /**
  * @brief Initialize a hash table structure.
  * @param table The table to initialize.
@@ -146,6 +198,22 @@ bighash_entry_t *bighash_first(bighash_table_t *table, uint32_t hash);
  */
 bighash_entry_t *bighash_next(bighash_entry_t *entry);
 
+/** Largest batch a template lookup_batch function handles at once */
+#define BIGHASH_BATCH_SIZE 64
+
+/**
+ * @brief Find the first entry for each of a batch of hash codes.
+ * @param table The hash table.
+ * @param hashes The hash codes.
+ * @param entries Output, the first entry for each hash code or NULL.
+ * @param count Number of hash codes.
+ * @note Equivalent to calling bighash_first for each hash code, but the
+ * bucket heads and first entries of the whole batch are prefetched before
+ * any chain is walked, so their cache misses overlap.
+ */
+void bighash_first_batch(bighash_table_t *table, const uint32_t *hashes,
+                         bighash_entry_t **entries, int count);
+
 /**
  * @brief Insert an entry into the hash table.
  * @param table The hash table.
@@ -166,6 +234,7 @@ void bighash_remove(bighash_table_t *table, bighash_entry_t *entry);
  * @brief Dump the utilization information.
  * @param table The hash table.
  * @param pvs The output pvs.
+ * @note Prints the summary from bighash_stats_get rather than every bucket.
  */
 void bighash_table_utilization_show(bighash_table_t *table, aim_pvs_t *pvs);
 
@@ -174,6 +243,14 @@ void bighash_table_utilization_show(bighash_table_t *table, aim_pvs_t *pvs);
  * @param table The hash table.
  * @param iter The iterator to initialize.
  * @returns The first element in the iteration, or NULL if empty.
+ * @note An incremental resize in progress is not completed. The iteration
+ * walks the old buckets still to migrate and then the new ones, and
+ * migration pauses until the iteration ends, so entries may be looked up
+ * and removed during the iteration. Entries may not be inserted during
+ * the iteration.
+ * @note The iteration ends when bighash_iter_next returns NULL. An
+ * iteration abandoned before then must be ended with bighash_iter_stop,
+ * or migration stays paused until the next insert.
  */
 void *bighash_iter_start(bighash_table_t *table, bighash_iter_t *iter);
 
@@ -184,6 +261,13 @@ void *bighash_iter_start(bighash_table_t *table, bighash_iter_t *iter);
  */
 void *bighash_iter_next(bighash_iter_t *iter);
 
+/**
+ * @brief End an iteration before bighash_iter_next returns NULL.
+ * @param iter The iterator.
+ * @note Does nothing if the iteration has already ended.
+ */
+void bighash_iter_stop(bighash_iter_t *iter);
+
 
 /**
  * @brief Get the number of entries in the table.
@@ -197,9 +281,13 @@ int bighash_entry_count(bighash_table_t *table);
  * @brief Move all entries from one table to another.
  * @param dst The destination table.
  * @param src The source table.
- * @note This performs a remove from the src table and an insertion
- * into the dst table. This can be used to dynamically migrate
- * table sizes and hash functions.
+ * @note Whole chains are spliced into dst when its bucket count divides
+ * the src bucket count, otherwise entries are relinked one at a time
+ * by their stored hash. An autogrow dst is resized once up front. An
+ * incremental resize in progress in either table is not completed, except
+ * that resizing dst completes its previous resize, as bighash_insert does.
+ * This can be used to dynamically migrate table sizes. Entries keep their
+ * hash codes; to change hash functions, remove and reinsert them.
  */
 int bighash_entries_move(bighash_table_t *dst, bighash_table_t *src);
 
@@ -137,6 +137,66 @@
 #define BIGHASH_CONFIG_LOAD_FACTOR 0.5
 #endif
 
+/**
+ * BIGHASH_CONFIG_INCREMENTAL_BUCKETS
+ *
+ * Number of buckets migrated per table operation during an incremental resize. */
+
+
+#ifndef BIGHASH_CONFIG_INCREMENTAL_BUCKETS
+#define BIGHASH_CONFIG_INCREMENTAL_BUCKETS 4
+#endif
+
+/**
+ * BIGHASH_CONFIG_SHRINK_LOAD_FACTOR
+ *
+ * Ratio of entries to buckets below which an autoshrink table is shrunk. */
+
+
+#ifndef BIGHASH_CONFIG_SHRINK_LOAD_FACTOR
+#define BIGHASH_CONFIG_SHRINK_LOAD_FACTOR 0.125
+#endif
+
+/**
+ * BIGHASH_CONFIG_OA_LOAD_FACTOR
+ *
+ * Ratio of used slots to slots in an open addressing table. */
+
+
+#ifndef BIGHASH_CONFIG_OA_LOAD_FACTOR
+#define BIGHASH_CONFIG_OA_LOAD_FACTOR 0.875
+#endif
+
+/**
+ * BIGHASH_CONFIG_INCLUDE_PROBE_STATS
+ *
+ * Count lookup probes in bighash_first. Requires the histogram module. */
+
+
+#ifndef BIGHASH_CONFIG_INCLUDE_PROBE_STATS
+#define BIGHASH_CONFIG_INCLUDE_PROBE_STATS 0
+#endif
+
+/**
+ * BIGHASH_CONFIG_INCLUDE_RCU
+ *
+ * Include the concurrent table with lock-free readers. Requires the OS module. */
+
+
+#ifndef BIGHASH_CONFIG_INCLUDE_RCU
+#define BIGHASH_CONFIG_INCLUDE_RCU 0
+#endif
+
+/**
+ * BIGHASH_CONFIG_KEY_HASH_WORDS
+ *
+ * Hash 16 and 40 byte template keys 8 bytes at a time. Faster, but the hash values differ from murmur_hash. */
+
+
+#ifndef BIGHASH_CONFIG_KEY_HASH_WORDS
+#define BIGHASH_CONFIG_KEY_HASH_WORDS 0
+#endif
+
 
 
 /**
@@ -0,0 +1,137 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+/************************************************************//**
+ *
+ * @file
+ * @brief Default key hash and compare for the BigHash templates.
+ *
+ * Keys are treated as opaque byte arrays. The length is always a
+ * compile time constant in the templates, so only one branch of each
+ * function survives.
+ *
+ * 4 and 8 byte keys use one or two murmur rounds, the same value as
+ * murmur_hash. Other lengths use murmur_hash itself, unless
+ * BIGHASH_CONFIG_KEY_HASH_WORDS is set: then 16 and 40 byte keys are
+ * mixed 8 bytes at a time with bighash_key_hash_words, which halves the
+ * dependency chain of murmur's 4 byte rounds. That changes their hash
+ * values, so hashes stored or compared outside the table must be
+ * recomputed, and lookups must use the template's hash function rather
+ * than hashing by hand. A single template can opt in instead with
+ *
+ *     #define TEMPLATE_HASH_FUNC(k, s) bighash_key_hash_words(k, sizeof(*(k)), s)
+ *
+ * Equality uses word compares for 4 and 8 byte keys and memcmp
+ * otherwise, which compilers expand inline for constant lengths.
+ *
+ * @addtogroup bighash-bighash
+ * @{
+ *
+ ***************************************************************/
+#ifndef __BIGHASH_KEY_H__
+#define __BIGHASH_KEY_H__
+
+#include <BigHash/bighash_config.h>
+#include <murmur/murmur.h>
+#include <string.h>
+
+/**
+ * @brief Hash a key 8 bytes at a time.
+ * @param key The key.
+ * @param len Length of the key in bytes, a multiple of 8.
+ * @param seed Hash seed.
+ * @note The value differs from murmur_hash.
+ */
+static inline uint32_t
+bighash_key_hash_words(const void *key, int len, uint32_t seed)
+{
+    const uint8_t *data = key;
+    uint64_t h = seed ^ (len * 0x9e3779b97f4a7c15ULL);
+    int i;
+    for (i = 0; i < len; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        h = (h ^ word) * 0xff51afd7ed558ccdULL;
+        h ^= h >> 32;
+    }
+
+    /* MurmurHash3 64-bit finalizer */
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return (uint32_t)h;
+}
+
+/**
+ * @brief Hash a key.
+ * @param key The key.
+ * @param len Length of the key in bytes.
+ * @param seed Hash seed.
+ */
+static inline uint32_t
+bighash_key_hash(const void *key, int len, uint32_t seed)
+{
+    const uint8_t *data = key;
+    uint32_t w0, w1;
+
+    if (len == 4) {
+        memcpy(&w0, data, sizeof(w0));
+        return murmur_finish(murmur_round(seed, w0), len);
+    }
+    else if (len == 8) {
+        memcpy(&w0, data, sizeof(w0));
+        memcpy(&w1, data + 4, sizeof(w1));
+        return murmur_finish(murmur_round(murmur_round(seed, w0), w1), len);
+    }
+    else if (BIGHASH_CONFIG_KEY_HASH_WORDS && (len == 16 || len == 40)) {
+        return bighash_key_hash_words(data, len, seed);
+    }
+
+    return murmur_hash(key, len, seed);
+}
+
+/**
+ * @brief Compare two keys.
+ * @param a The first key.
+ * @param b The second key.
+ * @param len Length of the keys in bytes.
+ * @returns Non-zero if the keys are equal.
+ */
+static inline int
+bighash_key_equal(const void *a, const void *b, int len)
+{
+    if (len == 4) {
+        uint32_t x, y;
+        memcpy(&x, a, sizeof(x));
+        memcpy(&y, b, sizeof(y));
+        return x == y;
+    }
+    else if (len == 8) {
+        uint64_t x, y;
+        memcpy(&x, a, sizeof(x));
+        memcpy(&y, b, sizeof(y));
+        return x == y;
+    }
+
+    return memcmp(a, b, len) == 0;
+}
+
+#endif /* __BIGHASH_KEY_H__ */
+/* @} */
@@ -0,0 +1,156 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+/************************************************************//**
+ *
+ * @file
+ * @brief Open addressing BigHash table.
+ *
+ * This is a sibling of bighash_table_t that stores entry pointers in a
+ * flat slot array instead of chaining them through bighash_entry_t.
+ *
+ * Slots are grouped in groups of BIGHASH_OA_GROUP_SIZE. Each slot has a
+ * control byte holding 7 bits of the hash, or a marker for empty and
+ * deleted slots. The control bytes of a group are contiguous, so a probe
+ * compares a whole group against the hash tag (with SSE2 when available)
+ * and only dereferences entries whose tag matches.
+ *
+ * Entries with the same hash share a slot. The first one occupies it and
+ * the rest are chained behind it through the next pointer in
+ * bighash_entry_t, so bighash_oa_next doesn't probe.
+ *
+ * Removal leaves a deleted marker instead of moving entries, so
+ * entries may be removed during an iteration. The table is only rehashed
+ * by bighash_oa_insert.
+ *
+ * @addtogroup bighash-bighash
+ * @{
+ *
+ ***************************************************************/
+#ifndef __BIGHASH_OA_H__
+#define __BIGHASH_OA_H__
+
+#include <BigHash/bighash.h>
+
+/** Number of slots covered by one group probe */
+#define BIGHASH_OA_GROUP_SIZE 16
+
+/**
+ * Open addressing hash table.
+ */
+typedef struct bighash_oa_table_s {
+    /** Control byte for each slot */
+    int8_t *ctrl;
+    /** Entry pointer for each slot */
+    bighash_entry_t **slots;
+    /** Number of slots, a power of 2 and a multiple of the group size */
+    int slot_count;
+    /** Current number of entries in this table. */
+    int entry_count;
+    /** Number of deleted slots */
+    int deleted_count;
+    /** Number of times the table has been rehashed */
+    int rehash_count;
+} bighash_oa_table_t;
+
+/**
+ * Iterator over open addressing table entries
+ */
+typedef struct bighash_oa_iter_s {
+    /** Hashtable. Must not be freed during iteration */
+    bighash_oa_table_t *table;
+    /** Next slot to examine */
+    int slot;
+    /** Next entry sharing the previous slot */
+    bighash_entry_t *next;
+} bighash_oa_iter_t;
+
+/**
+ * @brief Create an open addressing hash table.
+ * @param slot_count Initial number of slots, or BIGHASH_AUTOGROW.
+ * @returns The new hash table.
+ * @note The slot count is rounded up to a power of 2. The table always
+ * grows when it exceeds BIGHASH_CONFIG_OA_LOAD_FACTOR.
+ */
+bighash_oa_table_t *bighash_oa_table_create(int slot_count);
+
+/**
+ * @brief Destroy an open addressing hash table.
+ * @param table The table to destroy.
+ * @param free The entry free function (optional)
+ */
+void bighash_oa_table_destroy(bighash_oa_table_t *table, bighash_entry_free_f free);
+
+/**
+ * @brief Insert an entry into the hash table.
+ * @param table The hash table.
+ * @param entry The entry (does not need to be initialized).
+ * @param hash The hash code.
+ */
+void bighash_oa_insert(bighash_oa_table_t *table, bighash_entry_t *entry, uint32_t hash);
+
+/**
+ * @brief Remove an entry from the hash table.
+ * @param table The hash table.
+ * @param entry The entry.
+ */
+void bighash_oa_remove(bighash_oa_table_t *table, bighash_entry_t *entry);
+
+/**
+ * @brief Begin iterating over entries with the given hash code.
+ * @param table The hash table.
+ * @param hash The hash code.
+ * @returns The pointer to the first entry with the given hash code.
+ * @returns NULL if no entries exist with the given hash code.
+ */
+bighash_entry_t *bighash_oa_first(bighash_oa_table_t *table, uint32_t hash);
+
+/**
+ * @brief Continue iterating over entries with a given hash code.
+ * @param entry The previous entry.
+ * @returns The pointer to the next entry with the same hash code.
+ * @returns NULL if no more entries exist with the same hash code.
+ */
+bighash_entry_t *bighash_oa_next(bighash_entry_t *entry);
+
+/**
+ * @brief Get the number of entries in the table.
+ * @param table The hash table.
+ * @returns The count.
+ */
+int bighash_oa_entry_count(bighash_oa_table_t *table);
+
+/**
+ * @brief Start iteration over all entries in the table.
+ * @param table The hash table.
+ * @param iter The iterator to initialize.
+ * @returns The first element in the iteration, or NULL if empty.
+ * @note The current entry may be removed during the iteration, but
+ * entries may not be inserted.
+ */
+void *bighash_oa_iter_start(bighash_oa_table_t *table, bighash_oa_iter_t *iter);
+
+/**
+ * @brief Get the next element in the current iteration.
+ * @param iter The iterator.
+ * @returns The next element, or NULL if the end has been reached.
+ */
+void *bighash_oa_iter_next(bighash_oa_iter_t *iter);
+
+#endif /* __BIGHASH_OA_H__ */
+/* @} */
@@ -0,0 +1,165 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+/*
+ * BigHash open addressing template
+ *
+ * This is the bighash_oa_table_t counterpart of bighash_template.h. It
+ * takes the same parameter macros and generates functions with the same
+ * names and signatures, so a user of bighash_template.h can switch by
+ * changing the include and the table type. The differences are:
+ *
+ *   - functions take a bighash_oa_table_t
+ *   - remove() is provided, since bighash_remove can't be used
+ *
+ * The following macros must be defined before including this file:
+ *   TEMPLATE_NAME - prefix for the created functions
+ *   TEMPLATE_OBJ_TYPE - type (not a pointer) of the stored object
+ *   TEMPLATE_KEY_FIELD - field name of the key
+ *   TEMPLATE_ENTRY_FIELD - field name of the bighash_entry_t
+ *
+ * The following macros are optional:
+ *   TEMPLATE_HASH_FUNC - uint32_t f(const key_type *key, uint32_t seed),
+ *     defaults to bighash_key_hash over the key bytes
+ *   TEMPLATE_EQUAL_FUNC - int f(const key_type *a, const key_type *b),
+ *     returning non-zero if equal, defaults to bighash_key_equal
+ *   TEMPLATE_HASH_SEED - seed passed to the hash function, defaults to 0
+ *
+ * Keys with padding or pointers must provide both functions, since the
+ * defaults hash and compare every byte of the key.
+ *
+ * The above macros will be automatically undefined by this file.
+ *
+ * This file is intended to be included by a header that defines the parameter
+ * macros. It should also use a guard to prevent multiple inclusion, because
+ * this file deliberately does not.
+ */
+
+#include <BigHash/bighash_oa.h>
+#include <BigHash/bighash_key.h>
+
+#ifndef TEMPLATE_NAME
+#error "Must define TEMPLATE_NAME"
+#endif
+
+#ifndef TEMPLATE_OBJ_TYPE
+#error "Must define TEMPLATE_OBJ_TYPE"
+#endif
+
+#ifndef TEMPLATE_KEY_FIELD
+#error "Must define TEMPLATE_KEY_FIELD"
+#endif
+
+#ifndef TEMPLATE_ENTRY_FIELD
+#error "Must define TEMPLATE_ENTRY_FIELD"
+#endif
+
+#ifndef TEMPLATE_HASH_SEED
+#define TEMPLATE_HASH_SEED 0
+#endif
+
+/* Macro to create a function name */
+#define BHT_NAME_PASTE(X,Y) X ## _ ## Y
+#define BHT_NAME_EXPAND(X, Y) BHT_NAME_PASTE(X, Y)
+#define BHT_NAME(X) BHT_NAME_EXPAND(TEMPLATE_NAME, X)
+
+/* Derive the key type from the object type and field */
+#define TEMPLATE_KEY_TYPE typeof(((TEMPLATE_OBJ_TYPE *)0)->TEMPLATE_KEY_FIELD)
+
+/* Hash a key */
+static inline uint32_t
+BHT_NAME(hash)(const TEMPLATE_KEY_TYPE *key)
+{
+#ifdef TEMPLATE_HASH_FUNC
+    return TEMPLATE_HASH_FUNC(key, TEMPLATE_HASH_SEED);
+#else
+    return bighash_key_hash(key, sizeof(*key), TEMPLATE_HASH_SEED);
+#endif
+}
+
+/* Compare two keys */
+static inline int
+BHT_NAME(equal)(const TEMPLATE_KEY_TYPE *a, const TEMPLATE_KEY_TYPE *b)
+{
+#ifdef TEMPLATE_EQUAL_FUNC
+    return TEMPLATE_EQUAL_FUNC(a, b);
+#else
+    return bighash_key_equal(a, b, sizeof(*a));
+#endif
+}
+
+/* Insert an object into the hashtable */
+static inline void
+BHT_NAME(insert)(bighash_oa_table_t *table, TEMPLATE_OBJ_TYPE *obj)
+{
+    bighash_oa_insert(table, &obj->TEMPLATE_ENTRY_FIELD,
+                      BHT_NAME(hash)(&obj->TEMPLATE_KEY_FIELD));
+}
+
+/* Remove an object from the hashtable */
+static inline void
+BHT_NAME(remove)(bighash_oa_table_t *table, TEMPLATE_OBJ_TYPE *obj)
+{
+    bighash_oa_remove(table, &obj->TEMPLATE_ENTRY_FIELD);
+}
+
+/*
+ * Given an entry, find the next object matching 'key'.
+ * The given entry is included in this search.
+ */
+static inline TEMPLATE_OBJ_TYPE *
+BHT_NAME(search)(bighash_entry_t *entry, const TEMPLATE_KEY_TYPE *key)
+{
+    while (entry != NULL) {
+        TEMPLATE_OBJ_TYPE *obj = container_of(entry, TEMPLATE_ENTRY_FIELD, TEMPLATE_OBJ_TYPE);
+        if (BHT_NAME(equal)(&obj->TEMPLATE_KEY_FIELD, key)) {
+            return obj;
+        }
+        entry = bighash_oa_next(entry);
+    }
+    return NULL;
+}
+
+/* Return the first object matching 'key', or NULL */
+static inline TEMPLATE_OBJ_TYPE *
+BHT_NAME(first)(bighash_oa_table_t *table, const TEMPLATE_KEY_TYPE *key)
+{
+    return BHT_NAME(search)(bighash_oa_first(table, BHT_NAME(hash)(key)), key);
+}
+
+/* Return the next object matching 'key', or NULL */
+static inline TEMPLATE_OBJ_TYPE *
+BHT_NAME(next)(TEMPLATE_OBJ_TYPE *prev)
+{
+    return BHT_NAME(search)(bighash_oa_next(&prev->TEMPLATE_ENTRY_FIELD),
+                            &prev->TEMPLATE_KEY_FIELD);
+}
+
+#undef BHT_NAME_PASTE
+#undef BHT_NAME_EXPAND
+#undef BHT_NAME
+
+#undef TEMPLATE_KEY_TYPE
+
+#undef TEMPLATE_NAME
+#undef TEMPLATE_OBJ_TYPE
+#undef TEMPLATE_KEY_FIELD
+#undef TEMPLATE_ENTRY_FIELD
+#undef TEMPLATE_HASH_FUNC
+#undef TEMPLATE_EQUAL_FUNC
+#undef TEMPLATE_HASH_SEED
@@ -0,0 +1,209 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+/************************************************************//**
+ *
+ * @file
+ * @brief Concurrent BigHash table with lock-free readers.
+ *
+ * Writers (insert, remove, grow) serialize on a table lock. Readers take
+ * no lock. Instead each reader thread registers a bighash_rcu_reader_t
+ * and brackets its lookups with bighash_rcu_read_lock and
+ * bighash_rcu_read_unlock, which only publish the reader's epoch.
+ *
+ * Entries and bucket arrays are never freed under a reader:
+ *
+ *   - Removing an entry unlinks it but leaves its next pointer intact,
+ *     so a reader standing on it can continue down the chain. The caller
+ *     must call bighash_rcu_synchronize before freeing or reusing it.
+ *   - Growing publishes a new bucket array whose buckets point into the
+ *     old chains, frees the old array after all readers have left it,
+ *     and then splits each shared chain one link at a time, waiting for
+ *     readers between links. Readers never wait or retry. The grow runs
+ *     inside bighash_rcu_insert, which therefore waits for readers like
+ *     bighash_rcu_synchronize does.
+ *
+ * A grow waits for every read section in progress before it changes any
+ * link, so entries held within a read section, including removed ones,
+ * can't be moved onto another chain under bighash_rcu_next.
+ *
+ * @addtogroup bighash-bighash
+ * @{
+ *
+ ***************************************************************/
+#ifndef __BIGHASH_RCU_H__
+#define __BIGHASH_RCU_H__
+
+#include <BigHash/bighash.h>
+
+#if BIGHASH_CONFIG_INCLUDE_RCU == 1
+
+#include <OS/os_sem.h>
+
+/** Bucket array, allocated with its size */
+typedef struct bighash_rcu_buckets_s bighash_rcu_buckets_t;
+
+/**
+ * Reader state. One per reader thread, owned by the caller.
+ */
+typedef struct bighash_rcu_reader_s {
+    /** Table epoch when the read section began, or 0 outside one */
+    uint64_t epoch;
+    /** Next registered reader */
+    struct bighash_rcu_reader_s *next;
+} __attribute__((aligned(64))) bighash_rcu_reader_t;
+
+/**
+ * Concurrent hash table.
+ */
+typedef struct bighash_rcu_table_s {
+    /** Current bucket array */
+    bighash_rcu_buckets_t *buckets;
+    /** Current number of entries in this table. */
+    int entry_count;
+    /** Table flags (BIGHASH_TABLE_F_AUTOGROW) */
+    uint32_t flags;
+    /** Number of times the table has grown */
+    int grow_count;
+    /** Reclamation epoch, advanced by bighash_rcu_synchronize */
+    uint64_t epoch;
+    /** Registered readers */
+    bighash_rcu_reader_t *readers;
+    /** Writer lock */
+    os_sem_t lock;
+} bighash_rcu_table_t;
+
+/**
+ * @brief Create a concurrent hash table.
+ * @param bucket_count Number of buckets, or BIGHASH_AUTOGROW.
+ * @returns The new hash table.
+ * @note The bucket count is rounded up to a power of 2.
+ */
+bighash_rcu_table_t *bighash_rcu_table_create(int bucket_count);
+
+/**
+ * @brief Destroy a concurrent hash table.
+ * @param table The table to destroy.
+ * @param free The entry free function (optional)
+ * @note There must be no readers or writers left.
+ */
+void bighash_rcu_table_destroy(bighash_rcu_table_t *table, bighash_entry_free_f free);
+
+/**
+ * @brief Register a reader with the table.
+ * @param table The hash table.
+ * @param reader The reader state, which must stay valid until it is
+ * unregistered.
+ */
+void bighash_rcu_reader_register(bighash_rcu_table_t *table,
+                                 bighash_rcu_reader_t *reader);
+
+/**
+ * @brief Unregister a reader.
+ * @param table The hash table.
+ * @param reader The reader state. Must not be in a read section.
+ */
+void bighash_rcu_reader_unregister(bighash_rcu_table_t *table,
+                                   bighash_rcu_reader_t *reader);
+
+/**
+ * @brief Begin a read section.
+ * @param table The hash table.
+ * @param reader The registered reader state of this thread.
+ * @note Entries returned by bighash_rcu_first and bighash_rcu_next may
+ * only be used until bighash_rcu_read_unlock. Read sections don't nest.
+ */
+static inline void
+bighash_rcu_read_lock(bighash_rcu_table_t *table, bighash_rcu_reader_t *reader)
+{
+    __atomic_store_n(&reader->epoch, __atomic_load_n(&table->epoch, __ATOMIC_RELAXED),
+                     __ATOMIC_RELAXED);
+    /* Publish the epoch before loading any table pointers */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief End a read section.
+ * @param table The hash table.
+ * @param reader The registered reader state of this thread.
+ */
+static inline void
+bighash_rcu_read_unlock(bighash_rcu_table_t *table, bighash_rcu_reader_t *reader)
+{
+    (void)table;
+    __atomic_store_n(&reader->epoch, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Wait until every read section in progress has ended.
+ * @param table The hash table.
+ * @note Call this after bighash_rcu_remove and before freeing the entry.
+ * Must not be called from within a read section.
+ */
+void bighash_rcu_synchronize(bighash_rcu_table_t *table);
+
+/**
+ * @brief Insert an entry into the hash table.
+ * @param table The hash table.
+ * @param entry The entry (does not need to be initialized).
+ * @param hash The hash code.
+ * @note May grow the table and wait for readers to leave the old bucket
+ * array, so, like bighash_rcu_synchronize, must not be called from within
+ * a read section.
+ */
+void bighash_rcu_insert(bighash_rcu_table_t *table, bighash_entry_t *entry, uint32_t hash);
+
+/**
+ * @brief Remove an entry from the hash table.
+ * @param table The hash table.
+ * @param entry The entry.
+ * @note Readers may still hold the entry until bighash_rcu_synchronize.
+ */
+void bighash_rcu_remove(bighash_rcu_table_t *table, bighash_entry_t *entry);
+
+/**
+ * @brief Begin iterating over entries with the given hash code.
+ * @param table The hash table.
+ * @param hash The hash code.
+ * @returns The pointer to the first entry with the given hash code.
+ * @returns NULL if no entries exist with the given hash code.
+ * @note Must be called in a read section or by a writer.
+ */
+bighash_entry_t *bighash_rcu_first(bighash_rcu_table_t *table, uint32_t hash);
+
+/**
+ * @brief Continue iterating over entries with a given hash code.
+ * @param table The hash table.
+ * @param entry The previous entry.
+ * @returns The pointer to the next entry with the same hash code.
+ * @returns NULL if no more entries exist with the same hash code.
+ * @note Must be called in the same read section as bighash_rcu_first.
+ */
+bighash_entry_t *bighash_rcu_next(bighash_rcu_table_t *table, bighash_entry_t *entry);
+
+/**
+ * @brief Get the number of entries in the table.
+ * @param table The hash table.
+ * @returns The count.
+ */
+int bighash_rcu_entry_count(bighash_rcu_table_t *table);
+
+#endif /* BIGHASH_CONFIG_INCLUDE_RCU */
+
+#endif /* __BIGHASH_RCU_H__ */
+/* @} */
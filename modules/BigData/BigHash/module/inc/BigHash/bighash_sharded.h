@@ -0,0 +1,225 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+/************************************************************//**
+ *
+ * @file
+ * @brief Lock striped BigHash table.
+ *
+ * A sharded table is a set of independently locked bighash_table_t
+ * shards. The shard for an entry is chosen by the high bits of its hash,
+ * leaving the low bits to pick the bucket within the shard. Each shard
+ * grows on its own.
+ *
+ * bighash_sharded_insert and bighash_sharded_remove lock the shard
+ * themselves. Lookups must hold the shard lock while using the entries
+ * they find:
+ *
+ *     bighash_sharded_lock(table, hash);
+ *     e = bighash_sharded_first(table, hash);
+ *     ...
+ *     bighash_sharded_unlock(table, hash);
+ *
+ * While holding the lock, any bighash_table_t function may be used on
+ * bighash_sharded_shard(table, hash).
+ *
+ * @addtogroup bighash-bighash
+ * @{
+ *
+ ***************************************************************/
+#ifndef __BIGHASH_SHARDED_H__
+#define __BIGHASH_SHARDED_H__
+
+#include <BigHash/bighash.h>
+
+#if BIGHASH_CONFIG_INCLUDE_LOCKING == 1
+
+#include <pthread.h>
+
+/**
+ * One shard, padded to a whole number of cache lines. The shards array
+ * is cache line aligned, so shard locks don't share lines.
+ */
+typedef struct bighash_shard_s {
+    /** The shard lock */
+    pthread_mutex_t lock;
+    /** The shard's table */
+    bighash_table_t *table;
+    /** Padding */
+    char pad[64 - (sizeof(pthread_mutex_t) + sizeof(bighash_table_t *)) % 64];
+} bighash_shard_t;
+
+/* Fails to compile if shards aren't a multiple of the cache line size */
+typedef char bighash_shard_size_check__[sizeof(bighash_shard_t) % 64 == 0 ? 1 : -1];
+
+/**
+ * Lock striped hash table.
+ */
+typedef struct bighash_sharded_table_s {
+    /** Number of shards, a power of 2 */
+    int shard_count;
+    /** log2(shard_count) */
+    int shard_bits;
+    /** Shards, cache line aligned */
+    bighash_shard_t *shards;
+    /** Unaligned allocation backing shards */
+    void *shards_alloc;
+} bighash_sharded_table_t;
+
+/**
+ * Iterator over all entries of a sharded table. The shard being walked
+ * is locked.
+ */
+typedef struct bighash_sharded_iter_s {
+    /** Hashtable */
+    bighash_sharded_table_t *table;
+    /** Current shard, locked */
+    int shard;
+    /** Iterator within the current shard */
+    bighash_iter_t iter;
+} bighash_sharded_iter_t;
+
+/**
+ * @brief Create a sharded hash table.
+ * @param shard_count Number of shards, rounded up to a power of 2.
+ * @param bucket_count Buckets per shard, or BIGHASH_AUTOGROW.
+ * @returns The new hash table.
+ */
+bighash_sharded_table_t *bighash_sharded_table_create(int shard_count,
+                                                      int bucket_count);
+
+/**
+ * @brief Destroy a sharded hash table.
+ * @param table The table to destroy.
+ * @param free The entry free function (optional)
+ */
+void bighash_sharded_table_destroy(bighash_sharded_table_t *table,
+                                   bighash_entry_free_f free);
+
+/* Shard for a hash code */
+static inline bighash_shard_t *
+bighash_sharded_shard__(bighash_sharded_table_t *table, uint32_t hash)
+{
+    return &table->shards[((uint64_t)hash << table->shard_bits) >> 32];
+}
+
+/**
+ * @brief Get the shard table for a hash code.
+ * @param table The hash table.
+ * @param hash The hash code.
+ * @note The shard must be locked while it is used.
+ */
+static inline bighash_table_t *
+bighash_sharded_shard(bighash_sharded_table_t *table, uint32_t hash)
+{
+    return bighash_sharded_shard__(table, hash)->table;
+}
+
+/**
+ * @brief Lock the shard for a hash code.
+ * @param table The hash table.
+ * @param hash The hash code.
+ */
+static inline void
+bighash_sharded_lock(bighash_sharded_table_t *table, uint32_t hash)
+{
+    pthread_mutex_lock(&bighash_sharded_shard__(table, hash)->lock);
+}
+
+/**
+ * @brief Unlock the shard for a hash code.
+ * @param table The hash table.
+ * @param hash The hash code.
+ */
+static inline void
+bighash_sharded_unlock(bighash_sharded_table_t *table, uint32_t hash)
+{
+    pthread_mutex_unlock(&bighash_sharded_shard__(table, hash)->lock);
+}
+
+/**
+ * @brief Insert an entry into the hash table.
+ * @param table The hash table.
+ * @param entry The entry (does not need to be initialized).
+ * @param hash The hash code.
+ * @note Locks the shard. Use bighash_insert on the shard if it is
+ * already locked.
+ */
+void bighash_sharded_insert(bighash_sharded_table_t *table,
+                            bighash_entry_t *entry, uint32_t hash);
+
+/**
+ * @brief Remove an entry from the hash table.
+ * @param table The hash table.
+ * @param entry The entry.
+ * @note Locks the shard. Use bighash_remove on the shard if it is
+ * already locked.
+ */
+void bighash_sharded_remove(bighash_sharded_table_t *table,
+                            bighash_entry_t *entry);
+
+/**
+ * @brief Begin iterating over entries with the given hash code.
+ * @param table The hash table.
+ * @param hash The hash code.
+ * @returns The first entry with the given hash code, or NULL.
+ * @note The shard must be locked. Continue with bighash_next.
+ */
+static inline bighash_entry_t *
+bighash_sharded_first(bighash_sharded_table_t *table, uint32_t hash)
+{
+    return bighash_first(bighash_sharded_shard(table, hash), hash);
+}
+
+/**
+ * @brief Get the number of entries in the table.
+ * @param table The hash table.
+ * @returns The count. Not synchronized with concurrent writers.
+ */
+int bighash_sharded_entry_count(bighash_sharded_table_t *table);
+
+/**
+ * @brief Start iteration over all entries in the table.
+ * @param table The hash table.
+ * @param iter The iterator to initialize.
+ * @returns The first element in the iteration, or NULL if empty.
+ * @note Each shard is locked while it is walked, and the iteration must
+ * run to the end or be ended with bighash_sharded_iter_stop. Entries of
+ * the current shard may be removed with bighash_remove on
+ * bighash_sharded_shard.
+ */
+void *bighash_sharded_iter_start(bighash_sharded_table_t *table,
+                                 bighash_sharded_iter_t *iter);
+
+/**
+ * @brief Get the next element in the current iteration.
+ * @param iter The iterator.
+ * @returns The next element, or NULL if the end has been reached.
+ */
+void *bighash_sharded_iter_next(bighash_sharded_iter_t *iter);
+
+/**
+ * @brief End an iteration early, unlocking the current shard.
+ * @param iter The iterator.
+ */
+void bighash_sharded_iter_stop(bighash_sharded_iter_t *iter);
+
+#endif /* BIGHASH_CONFIG_INCLUDE_LOCKING */
+
+#endif /* __BIGHASH_SHARDED_H__ */
+/* @} */
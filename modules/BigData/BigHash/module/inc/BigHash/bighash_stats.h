@@ -0,0 +1,144 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+/************************************************************//**
+ *
+ * @file
+ * @brief BigHash table statistics.
+ *
+ * bighash_stats_get summarizes the chain lengths of a table in one pass
+ * over the buckets. Tables registered with bighash_stats_register can be
+ * shown by name, which the bighash uCli "stats" command uses.
+ *
+ * With BIGHASH_CONFIG_INCLUDE_PROBE_STATS the table also counts the
+ * entries examined by each bighash_first call, and can record them in a
+ * histogram from the histogram module.
+ *
+ * @addtogroup bighash-bighash
+ * @{
+ *
+ ***************************************************************/
+#ifndef __BIGHASH_STATS_H__
+#define __BIGHASH_STATS_H__
+
+#include <BigHash/bighash.h>
+
+#if BIGHASH_CONFIG_INCLUDE_LOCKING == 1
+#include <OS/os_sem.h>
+#endif
+
+/** Number of chain length counters. The last one counts longer chains. */
+#define BIGHASH_STATS_CHAIN_BUCKETS 16
+
+/**
+ * Hash table statistics.
+ */
+typedef struct bighash_stats_s {
+    /** Number of buckets */
+    int bucket_count;
+    /** Number of old buckets left to migrate by an incremental resize */
+    int old_bucket_count;
+    /** Number of entries */
+    int entry_count;
+    /** Entries per bucket */
+    double load_factor;
+    /** Number of empty buckets, including old ones left to migrate */
+    int empty_buckets;
+    /** Longest chain */
+    int max_chain;
+    /** Mean length of the non-empty chains */
+    double mean_chain;
+    /** Number of buckets with each chain length */
+    uint32_t chain_counts[BIGHASH_STATS_CHAIN_BUCKETS];
+    /** Number of times the table has grown */
+    int grow_count;
+    /** Number of times the table has shrunk */
+    int shrink_count;
+    /** Number of lookups, if BIGHASH_CONFIG_INCLUDE_PROBE_STATS */
+    uint64_t lookup_count;
+    /** Number of entries examined by lookups */
+    uint64_t probe_count;
+} bighash_stats_t;
+
+/**
+ * @brief Collect statistics for a table.
+ * @param table The hash table.
+ * @param stats Filled in with the statistics.
+ * @note Doesn't modify the table. During an incremental resize the chain
+ * counts cover both the new buckets and the old ones not yet migrated.
+ * The table must not be modified concurrently.
+ */
+void bighash_stats_get(bighash_table_t *table, bighash_stats_t *stats);
+
+/**
+ * @brief Show table statistics.
+ * @param stats The statistics.
+ * @param pvs The output pvs.
+ */
+void bighash_stats_show(bighash_stats_t *stats, aim_pvs_t *pvs);
+
+/**
+ * @brief Register a table so its statistics can be shown by name.
+ * @param table The hash table.
+ * @param name The table name, which is copied.
+ * @note bighash_table_destroy unregisters the table. Showing the table
+ * reads it without any lock of its owner, so a table registered this way
+ * may only be shown by the thread that modifies it. Tables shared with
+ * other threads, such as the uCli, should use bighash_stats_register_locked.
+ */
+void bighash_stats_register(bighash_table_t *table, const char *name);
+
+#if BIGHASH_CONFIG_INCLUDE_LOCKING == 1
+/**
+ * @brief Register a table along with the lock that guards it.
+ * @param table The hash table.
+ * @param name The table name, which is copied.
+ * @param lock Taken while the table is shown.
+ * @note The registry is locked before 'lock', so the table must not be
+ * destroyed or unregistered while 'lock' is held.
+ */
+void bighash_stats_register_locked(bighash_table_t *table, const char *name,
+                                   os_sem_t lock);
+#endif
+
+/**
+ * @brief Unregister a table.
+ * @param table The hash table.
+ */
+void bighash_stats_unregister(bighash_table_t *table);
+
+/**
+ * @brief Show the statistics of registered tables.
+ * @param prefix Only show tables whose name starts with this (optional).
+ * @param pvs The output pvs.
+ * @returns The number of tables shown.
+ */
+int bighash_stats_show_registered(const char *prefix, aim_pvs_t *pvs);
+
+#if BIGHASH_CONFIG_INCLUDE_PROBE_STATS == 1
+/**
+ * @brief Record the entries examined per lookup in a histogram.
+ * @param table The hash table.
+ * @param hist The histogram, or NULL to stop recording.
+ */
+void bighash_stats_probe_histogram_set(bighash_table_t *table,
+                                       struct histogram *hist);
+#endif
+
+#endif /* __BIGHASH_STATS_H__ */
+/* @} */
@@ -30,6 +30,16 @@
  *   TEMPLATE_KEY_FIELD - field name of the key
  *   TEMPLATE_ENTRY_FIELD - field name of the bighash_entry_t
  *
+ * The following macros are optional:
+ *   TEMPLATE_HASH_FUNC - uint32_t f(const key_type *key, uint32_t seed),
+ *     defaults to bighash_key_hash over the key bytes
+ *   TEMPLATE_EQUAL_FUNC - int f(const key_type *a, const key_type *b),
+ *     returning non-zero if equal, defaults to bighash_key_equal
+ *   TEMPLATE_HASH_SEED - seed passed to the hash function, defaults to 0
+ *
+ * Keys with padding or pointers must provide both functions, since the
+ * defaults hash and compare every byte of the key.
+ *
  * The above macros will be automatically undefined by this file.
  *
  * This file is intended to be included by a header that defines the parameter
@@ -38,7 +48,7 @@
  */
 
 #include <BigHash/bighash.h>
-#include <murmur/murmur.h>
+#include <BigHash/bighash_key.h>
 
 #ifndef TEMPLATE_NAME
 #error "Must define TEMPLATE_NAME"
@@ -56,6 +66,10 @@
 #error "Must define TEMPLATE_ENTRY_FIELD"
 #endif
 
+#ifndef TEMPLATE_HASH_SEED
+#define TEMPLATE_HASH_SEED 0
+#endif
+
 /* Macro to create a function name */
 #define BHT_NAME_PASTE(X,Y) X ## _ ## Y
 #define BHT_NAME_EXPAND(X, Y) BHT_NAME_PASTE(X, Y)
@@ -68,7 +82,22 @@
 static inline uint32_t
 BHT_NAME(hash)(const TEMPLATE_KEY_TYPE *key)
 {
-    return murmur_hash(key, sizeof(*key), 0);
+#ifdef TEMPLATE_HASH_FUNC
+    return TEMPLATE_HASH_FUNC(key, TEMPLATE_HASH_SEED);
+#else
+    return bighash_key_hash(key, sizeof(*key), TEMPLATE_HASH_SEED);
+#endif
+}
+
+/* Compare two keys */
+static inline int
+BHT_NAME(equal)(const TEMPLATE_KEY_TYPE *a, const TEMPLATE_KEY_TYPE *b)
+{
+#ifdef TEMPLATE_EQUAL_FUNC
+    return TEMPLATE_EQUAL_FUNC(a, b);
+#else
+    return bighash_key_equal(a, b, sizeof(*a));
+#endif
 }
 
 /* Insert an object into the hashtable */
@@ -88,7 +117,7 @@ BHT_NAME(search)(bighash_entry_t *entry, const TEMPLATE_KEY_TYPE *key)
 {
     while (entry != NULL) {
         TEMPLATE_OBJ_TYPE *obj = container_of(entry, TEMPLATE_ENTRY_FIELD, TEMPLATE_OBJ_TYPE);
-        if (!memcmp(&obj->TEMPLATE_KEY_FIELD, key, sizeof(*key))) {
+        if (BHT_NAME(equal)(&obj->TEMPLATE_KEY_FIELD, key)) {
             return obj;
         }
         entry = bighash_next(entry);
@@ -111,6 +140,31 @@ BHT_NAME(next)(TEMPLATE_OBJ_TYPE *prev)
                             &prev->TEMPLATE_KEY_FIELD);
 }
 
+/*
+ * Look up the first object matching each of a batch of keys. objs[i] is
+ * set to the match for keys[i], or NULL. Longer batches are split into
+ * runs of BIGHASH_BATCH_SIZE.
+ */
+static inline void
+BHT_NAME(lookup_batch)(bighash_table_t *table, const TEMPLATE_KEY_TYPE **keys,
+                       TEMPLATE_OBJ_TYPE **objs, int count)
+{
+    uint32_t hashes[BIGHASH_BATCH_SIZE];
+    bighash_entry_t *entries[BIGHASH_BATCH_SIZE];
+    int base, i, n;
+
+    for (base = 0; base < count; base += n) {
+        n = count - base < BIGHASH_BATCH_SIZE ? count - base : BIGHASH_BATCH_SIZE;
+        for (i = 0; i < n; i++) {
+            hashes[i] = BHT_NAME(hash)(keys[base + i]);
+        }
+        bighash_first_batch(table, hashes, entries, n);
+        for (i = 0; i < n; i++) {
+            objs[base + i] = BHT_NAME(search)(entries[i], keys[base + i]);
+        }
+    }
+}
+
 #undef BHT_NAME_PASTE
 #undef BHT_NAME_EXPAND
 #undef BHT_NAME
@@ -121,3 +175,6 @@ BHT_NAME(next)(TEMPLATE_OBJ_TYPE *prev)
 #undef TEMPLATE_OBJ_TYPE
 #undef TEMPLATE_KEY_FIELD
 #undef TEMPLATE_ENTRY_FIELD
+#undef TEMPLATE_HASH_FUNC
+#undef TEMPLATE_EQUAL_FUNC
+#undef TEMPLATE_HASH_SEED
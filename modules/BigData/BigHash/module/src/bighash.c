@@ -19,15 +19,33 @@
 
 #include <BigHash/bighash_config.h>
 #include <BigHash/bighash.h>
+#include <BigHash/bighash_stats.h>
 #include "bighash_log.h"
 
+#if BIGHASH_CONFIG_INCLUDE_PROBE_STATS == 1
+#include <histogram/histogram.h>
+#endif
+
 static void bighash_grow(bighash_table_t *table);
+static void bighash_shrink(bighash_table_t *table);
+static int bighash_should_shrink__(bighash_table_t *table);
+static void bighash_migrate__(bighash_table_t *table, int count);
+static void bighash_migrate_finish__(bighash_table_t *table);
+static void bighash_migrate_step__(bighash_table_t *table);
+static void bighash_merge_bucket__(bighash_entry_t *cur, bighash_entry_t **new_bucket);
+static void bighash_resize__(bighash_table_t *table, int new_bucket_count);
 
 bighash_table_t *
 bighash_table_create(int bucket_count)
+{
+    return bighash_table_create_flags(bucket_count, 0);
+}
+
+bighash_table_t *
+bighash_table_create_flags(int bucket_count, uint32_t flags)
 {
     bighash_table_t *table = aim_zmalloc(sizeof(*table));
-    table->flags |= BIGHASH_TABLE_F_TABLE_ALLOCATED;
+    table->flags |= BIGHASH_TABLE_F_TABLE_ALLOCATED | flags;
     bighash_table_init(table, bucket_count);
     return table;
 }
@@ -67,14 +85,14 @@ bighash_table_init(bighash_table_t *table, int bucket_count)
     return 0;
 }
 
-void
-bighash_table_destroy(bighash_table_t *table, bighash_entry_free_f efree)
+static void
+bighash_buckets_destroy__(bighash_entry_t **buckets, int bucket_count,
+                          bighash_entry_free_f efree)
 {
-    /* Destroy or invalidate all entries */
     int b;
-    for(b = 0; b < table->bucket_count; b++) {
+    for(b = 0; b < bucket_count; b++) {
         bighash_entry_t *cur, *next;
-        cur = table->buckets[b];
+        cur = buckets[b];
         while (cur != NULL) {
             next = cur->next;
             cur->next = NULL;
@@ -85,6 +103,25 @@ bighash_table_destroy(bighash_table_t *table, bighash_entry_free_f efree)
             cur = next;
         }
     }
+}
+
+void
+bighash_table_destroy(bighash_table_t *table, bighash_entry_free_f efree)
+{
+    if (table->flags & BIGHASH_TABLE_F_STATS_REGISTERED) {
+        bighash_stats_unregister(table);
+    }
+
+    /* Destroy or invalidate all entries */
+    bighash_buckets_destroy__(table->buckets, table->bucket_count, efree);
+
+    if(table->old_buckets) {
+        bighash_buckets_destroy__(table->old_buckets, table->old_bucket_count,
+                                  efree);
+        aim_free(table->old_buckets);
+        table->old_buckets = NULL;
+        table->old_bucket_count = 0;
+    }
 
     if(table->flags & BIGHASH_TABLE_F_BUCKETS_ALLOCATED) {
         aim_free(table->buckets);
@@ -101,6 +138,13 @@ bighash_table_destroy(bighash_table_t *table, bighash_entry_free_f efree)
 bighash_entry_t **
 bighash_bucket(bighash_table_t *table, uint32_t hash)
 {
+    if (table->old_buckets) {
+        /* Old buckets below migrate_bucket have already been moved */
+        int old_bucket = hash % table->old_bucket_count;
+        if (old_bucket >= table->migrate_bucket) {
+            return &table->old_buckets[old_bucket];
+        }
+    }
     int bucket = hash % table->bucket_count;
     return &table->buckets[bucket];
 }
@@ -108,7 +152,13 @@ bighash_bucket(bighash_table_t *table, uint32_t hash)
 void
 bighash_insert(bighash_table_t *table, bighash_entry_t *e, uint32_t hash)
 {
-    bighash_entry_t **bucket = bighash_bucket(table, hash);
+    bighash_entry_t **bucket;
+
+    /* Inserts aren't allowed during iteration, so any have been abandoned */
+    table->iterators = 0;
+    bighash_migrate_step__(table);
+
+    bucket = bighash_bucket(table, hash);
     e->next = *bucket;
     e->hash = hash;
     *bucket = e;
@@ -121,10 +171,36 @@ bighash_insert(bighash_table_t *table, bighash_entry_t *e, uint32_t hash)
     }
 }
 
+#if BIGHASH_CONFIG_INCLUDE_PROBE_STATS == 1
+static inline void
+bighash_probes_record__(bighash_table_t *table, uint32_t probes)
+{
+    table->lookup_count++;
+    table->probe_count += probes;
+    if (table->probe_hist) {
+        histogram_inc(table->probe_hist, probes);
+    }
+}
+#endif
+
 bighash_entry_t *
 bighash_first(bighash_table_t *table, uint32_t hash)
 {
+    bighash_migrate_step__(table);
+
     bighash_entry_t *e = *bighash_bucket(table, hash);
+#if BIGHASH_CONFIG_INCLUDE_PROBE_STATS == 1
+    uint32_t probes = 0;
+    while (e != NULL) {
+        probes++;
+        if (e->hash == hash) {
+            break;
+        }
+        e = e->next;
+    }
+    bighash_probes_record__(table, probes);
+    return e;
+#else
     while (e != NULL) {
         if (e->hash == hash) {
             return e;
@@ -132,6 +208,44 @@ bighash_first(bighash_table_t *table, uint32_t hash)
         e = e->next;
     }
     return NULL;
+#endif
+}
+
+void
+bighash_first_batch(bighash_table_t *table, const uint32_t *hashes,
+                    bighash_entry_t **entries, int count)
+{
+    int i;
+
+    bighash_migrate_step__(table);
+
+    for (i = 0; i < count; i++) {
+        __builtin_prefetch(bighash_bucket(table, hashes[i]));
+    }
+
+    for (i = 0; i < count; i++) {
+        entries[i] = *bighash_bucket(table, hashes[i]);
+        if (entries[i] != NULL) {
+            __builtin_prefetch(entries[i]);
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        bighash_entry_t *e = entries[i];
+#if BIGHASH_CONFIG_INCLUDE_PROBE_STATS == 1
+        uint32_t probes = e != NULL;
+        while (e != NULL && e->hash != hashes[i]) {
+            e = e->next;
+            probes += e != NULL;
+        }
+        bighash_probes_record__(table, probes);
+#else
+        while (e != NULL && e->hash != hashes[i]) {
+            e = e->next;
+        }
+#endif
+        entries[i] = e;
+    }
 }
 
 bighash_entry_t *
@@ -151,12 +265,22 @@ bighash_next(bighash_entry_t *e)
 void
 bighash_remove(bighash_table_t *table, bighash_entry_t *e)
 {
+    bighash_migrate_step__(table);
+
     bighash_entry_t **prev_ptr = bighash_bucket(table, e->hash);
     bighash_entry_t *cur = *prev_ptr;
     while (cur != NULL) {
         if (cur == e) {
             *prev_ptr = cur->next;
             table->entry_count--;
+            /*
+             * Start shrinking once the previous resize is done, unless it
+             * would move entries under an iteration.
+             */
+            if (table->old_buckets == NULL && table->iterators == 0 &&
+                bighash_should_shrink__(table)) {
+                bighash_shrink(table);
+            }
             return;
         }
         prev_ptr = &cur->next;
@@ -164,32 +288,101 @@ bighash_remove(bighash_table_t *table, bighash_entry_t *e)
     }
 }
 
-void
-bighash_table_utilization_show(bighash_table_t *table, aim_pvs_t *pvs)
+/* Add the chains of buckets[start..end) to stats */
+static void
+bighash_stats_chains__(bighash_stats_t *stats, bighash_entry_t **buckets,
+                       int start, int end)
 {
     int i;
-    int count = 0;
-
-    aim_printf(pvs, "table: %d buckets\n", table->bucket_count);
 
-    for(i = 0; i < table->bucket_count; i++) {
+    for (i = start; i < end; i++) {
         int c = 0;
-        bighash_entry_t *cur = table->buckets[i];
-        while (cur != NULL) {
+        bighash_entry_t *cur;
+        for (cur = buckets[i]; cur != NULL; cur = cur->next) {
             c++;
-            cur = cur->next;
         }
-        aim_printf(pvs, "    %.4d: %d \n", i, c);
-        count += c;
+        if (c == 0) {
+            stats->empty_buckets++;
+        }
+        if (c > stats->max_chain) {
+            stats->max_chain = c;
+        }
+        stats->chain_counts[c < BIGHASH_STATS_CHAIN_BUCKETS ?
+                            c : BIGHASH_STATS_CHAIN_BUCKETS - 1]++;
+    }
+}
+
+void
+bighash_stats_get(bighash_table_t *table, bighash_stats_t *stats)
+{
+    int chains;
+
+    BIGHASH_MEMSET(stats, 0, sizeof(*stats));
+    stats->bucket_count = table->bucket_count;
+    stats->entry_count = table->entry_count;
+    stats->load_factor = (double)table->entry_count / table->bucket_count;
+    stats->grow_count = table->grow_count;
+    stats->shrink_count = table->shrink_count;
+#if BIGHASH_CONFIG_INCLUDE_PROBE_STATS == 1
+    stats->lookup_count = table->lookup_count;
+    stats->probe_count = table->probe_count;
+#endif
+
+    /*
+     * During an incremental resize the old buckets from migrate_bucket
+     * on still hold chains. Count them as they are rather than finishing
+     * the resize, so this doesn't modify the table.
+     */
+    bighash_stats_chains__(stats, table->buckets, 0, table->bucket_count);
+    if (table->old_buckets) {
+        stats->old_bucket_count = table->old_bucket_count - table->migrate_bucket;
+        bighash_stats_chains__(stats, table->old_buckets, table->migrate_bucket,
+                               table->old_bucket_count);
+    }
+
+    chains = stats->bucket_count + stats->old_bucket_count;
+    if (stats->empty_buckets < chains) {
+        stats->mean_chain = (double)table->entry_count /
+            (chains - stats->empty_buckets);
     }
 }
 
+#if BIGHASH_CONFIG_INCLUDE_PROBE_STATS == 1
+void
+bighash_stats_probe_histogram_set(bighash_table_t *table, struct histogram *hist)
+{
+    table->probe_hist = hist;
+}
+#endif
+
+void
+bighash_table_utilization_show(bighash_table_t *table, aim_pvs_t *pvs)
+{
+    bighash_stats_t stats;
+    bighash_stats_get(table, &stats);
+    bighash_stats_show(&stats, pvs);
+}
+
+/*
+ * Bucket b of an iteration: the old buckets of a resize in progress,
+ * then the new ones. Migrated old buckets are empty.
+ */
+static bighash_entry_t *
+bighash_iter_bucket__(bighash_table_t *table, int b)
+{
+    if (b < table->old_bucket_count) {
+        return table->old_buckets[b];
+    }
+    return table->buckets[b - table->old_bucket_count];
+}
+
 static int
 next_nonempty_bucket__(bighash_table_t *table, int current)
 {
     int b;
-    for(b = current+1; b < table->bucket_count; b++) {
-        if(table->buckets[b] != NULL) {
+    int count = table->old_bucket_count + table->bucket_count;
+    for(b = current+1; b < count; b++) {
+        if(bighash_iter_bucket__(table, b) != NULL) {
             return b;
         }
     }
@@ -199,8 +392,14 @@ next_nonempty_bucket__(bighash_table_t *table, int current)
 void *
 bighash_iter_start(bighash_table_t *table, bighash_iter_t *iter)
 {
+    /*
+     * Moving entries between buckets would break the iteration, so
+     * migration pauses until it ends rather than being finished here.
+     */
+    table->iterators++;
+
     iter->table = table;
-    iter->current_bucket = -1;
+    iter->current_bucket = table->old_buckets ? table->migrate_bucket - 1 : -1;
     iter->next_entry = NULL;
     return bighash_iter_next(iter);
 }
@@ -210,15 +409,20 @@ bighash_iter_next(bighash_iter_t *iter)
 {
     bighash_entry_t *cur = iter->next_entry;
 
+    if (iter->table == NULL) {
+        return NULL;
+    }
+
     if (cur == NULL) {
         /* Advance to next bucket */
         int next_bucket = next_nonempty_bucket__(iter->table, iter->current_bucket);
         if (next_bucket == -1) {
             /* Finished all buckets */
+            bighash_iter_stop(iter);
             return NULL;
         }
         iter->current_bucket = next_bucket;
-        cur = iter->table->buckets[iter->current_bucket];
+        cur = bighash_iter_bucket__(iter->table, iter->current_bucket);
     }
 
     iter->next_entry = cur->next;
@@ -226,63 +430,261 @@ bighash_iter_next(bighash_iter_t *iter)
     return cur;
 }
 
+void
+bighash_iter_stop(bighash_iter_t *iter)
+{
+    if (iter->table) {
+        if (iter->table->iterators > 0) {
+            iter->table->iterators--;
+        }
+        iter->table = NULL;
+    }
+}
+
 int
 bighash_entry_count(bighash_table_t *table)
 {
     return table->entry_count;
 }
 
+/*
+ * Move a chain from bucket i of a src array of 'count' buckets into dst.
+ * If dst's bucket count divides count, every entry belongs in dst bucket
+ * i % dst->bucket_count and the whole chain can be spliced. Otherwise, or
+ * while dst is resizing, each entry is pushed onto its bucket.
+ */
+static void
+bighash_move_chain__(bighash_table_t *dst, bighash_entry_t *cur, int i, int count)
+{
+    if (dst->old_buckets == NULL && count % dst->bucket_count == 0) {
+        bighash_merge_bucket__(cur, &dst->buckets[i % dst->bucket_count]);
+        return;
+    }
+
+    while (cur != NULL) {
+        bighash_entry_t *next = cur->next;
+        bighash_entry_t **bucket = bighash_bucket(dst, cur->hash);
+        cur->next = *bucket;
+        *bucket = cur;
+        cur = next;
+    }
+}
+
+/*
+ * Move the entries of src into dst a chain at a time. Neither table is
+ * searched and dst is resized at most once, up front.
+ */
 int
 bighash_entries_move(bighash_table_t *dst, bighash_table_t *src)
 {
-    bighash_iter_t iter;
-    bighash_entry_t *e;
-    for(e = bighash_iter_start(src, &iter); e; e = bighash_iter_next(&iter)) {
-        bighash_remove(src, e);
-        bighash_insert(dst, e, e->hash);
+    int i;
+
+    if (dst == src || src->entry_count == 0) {
+        return 0;
+    }
+
+    /* Size dst for the combined count rather than growing step by step */
+    if (dst->flags & BIGHASH_TABLE_F_AUTOGROW) {
+        int total = dst->entry_count + src->entry_count;
+        int new_bucket_count = dst->bucket_count;
+
+        while (total >= new_bucket_count*BIGHASH_CONFIG_LOAD_FACTOR) {
+            new_bucket_count *= 2;
+        }
+
+        if (new_bucket_count != dst->bucket_count) {
+            bighash_resize__(dst, new_bucket_count);
+            dst->grow_count++;
+        }
+    }
+
+    /* Old buckets of a resize in progress in src, then its new ones */
+    for (i = src->migrate_bucket; i < src->old_bucket_count; i++) {
+        bighash_move_chain__(dst, src->old_buckets[i], i, src->old_bucket_count);
+        src->old_buckets[i] = NULL;
+    }
+    for (i = 0; i < src->bucket_count; i++) {
+        bighash_move_chain__(dst, src->buckets[i], i, src->bucket_count);
+        src->buckets[i] = NULL;
     }
+
+    /* src is empty, so there is nothing left to migrate */
+    if (src->old_buckets) {
+        aim_free(src->old_buckets);
+        src->old_buckets = NULL;
+        src->old_bucket_count = 0;
+        src->migrate_bucket = 0;
+    }
+
+    dst->entry_count += src->entry_count;
+    src->entry_count = 0;
+
+    if (bighash_should_shrink__(src)) {
+        bighash_shrink(src);
+    }
+
     return 0;
 }
 
+/*
+ * Split an old bucket into the lo and hi buckets of the new array.
+ * Both new buckets must be empty. The relative order of the entries
+ * is preserved.
+ */
 static void
-bighash_grow(bighash_table_t *table)
+bighash_split_bucket__(bighash_entry_t *cur, bighash_entry_t **new_buckets,
+                       int i, uint32_t bit)
 {
-    AIM_ASSERT(aim_is_pow2_u32(table->bucket_count), "Bucket count must be a power of 2");
+    bighash_entry_t **new_tail_lo = &new_buckets[i];
+    bighash_entry_t **new_tail_hi = &new_buckets[bit + i];
 
-    int new_bucket_count = table->bucket_count * 2;
-    bighash_entry_t **new_buckets = aim_malloc(sizeof(new_buckets[0]) * new_bucket_count);
+    /* Initialize new buckets to an empty list */
+    *new_tail_lo = NULL;
+    *new_tail_hi = NULL;
 
-    /* Bit that decides whether we go in the hi or lo bucket */
-    uint32_t bit = table->bucket_count;
+    while (cur != NULL) {
+        /* Get the new tail */
+        bighash_entry_t ***new_tail_ptr = cur->hash & bit ? &new_tail_hi
+                                                          : &new_tail_lo;
+        bighash_entry_t **new_tail = *new_tail_ptr;
+        bighash_entry_t *next = cur->next;
+
+        /* Add cur to the end of the list */
+        *new_tail = cur;
+        cur->next = NULL;
+
+        /* Advance local list pointers */
+        *new_tail_ptr = &cur->next;
+        cur = next;
+    }
+}
 
-    int i;
-    for (i = 0; i < table->bucket_count; i++) {
-        bighash_entry_t *cur = table->buckets[i];
-        bighash_entry_t **new_tail_lo = &new_buckets[i];
-        bighash_entry_t **new_tail_hi = &new_buckets[bit + i];
+/*
+ * Merge an old bucket into its bucket in the smaller new array.
+ * This is the counterpart of bighash_split_bucket__. The old chain is
+ * spliced in front of the new bucket, so entries with the same hash
+ * keep their relative order.
+ */
+static void
+bighash_merge_bucket__(bighash_entry_t *cur, bighash_entry_t **new_bucket)
+{
+    bighash_entry_t *tail = cur;
 
-        /* Initialize new buckets to an empty list */
-        *new_tail_lo = NULL;
-        *new_tail_hi = NULL;
+    if (cur == NULL) {
+        return;
+    }
 
-        while (cur != NULL) {
-            /* Get the new tail */
-            bighash_entry_t ***new_tail_ptr = cur->hash & bit ? &new_tail_hi
-                                                              : &new_tail_lo;
-            bighash_entry_t **new_tail = *new_tail_ptr;
-            bighash_entry_t *next = cur->next;
-
-            /* Add cur to the end of the list */
-            *new_tail = cur;
-            cur->next = NULL;
+    while (tail->next != NULL) {
+        tail = tail->next;
+    }
+    tail->next = *new_bucket;
+    *new_bucket = cur;
+}
 
-            /* Advance local list pointers */
-            *new_tail_ptr = &cur->next;
-            cur = next;
+/*
+ * Move up to 'count' old buckets into the new bucket array and
+ * release the old array once it has been drained.
+ */
+static void
+bighash_migrate__(bighash_table_t *table, int count)
+{
+    /* Bit that decides whether we go in the hi or lo bucket */
+    uint32_t bit = table->old_bucket_count;
+    uint32_t mask = table->bucket_count - 1;
+    int grow = table->bucket_count > table->old_bucket_count;
+
+    while (count-- > 0 && table->migrate_bucket < table->old_bucket_count) {
+        int i = table->migrate_bucket++;
+        if (grow) {
+            bighash_split_bucket__(table->old_buckets[i], table->buckets, i, bit);
+        }
+        else {
+            bighash_merge_bucket__(table->old_buckets[i], &table->buckets[i & mask]);
         }
+        table->old_buckets[i] = NULL;
     }
 
-    aim_free(table->buckets);
+    if (table->migrate_bucket == table->old_bucket_count) {
+        aim_free(table->old_buckets);
+        table->old_buckets = NULL;
+        table->old_bucket_count = 0;
+        table->migrate_bucket = 0;
+    }
+}
+
+/* Migrate a few old buckets, unless an iteration has paused migration */
+static void
+bighash_migrate_step__(bighash_table_t *table)
+{
+    if (table->old_buckets && table->iterators == 0) {
+        bighash_migrate__(table, BIGHASH_CONFIG_INCREMENTAL_BUCKETS);
+    }
+}
+
+static void
+bighash_migrate_finish__(bighash_table_t *table)
+{
+    if (table->old_buckets) {
+        bighash_migrate__(table, table->old_bucket_count);
+    }
+}
+
+/*
+ * Switch the table to a new power of 2 bucket array. The current
+ * array becomes the old array and is migrated all at once, or a few
+ * buckets per operation for incremental tables.
+ */
+static void
+bighash_resize__(bighash_table_t *table, int new_bucket_count)
+{
+    AIM_ASSERT(aim_is_pow2_u32(table->bucket_count), "Bucket count must be a power of 2");
+
+    /* Only one resize can be in progress at a time */
+    bighash_migrate_finish__(table);
+
+    table->old_buckets = table->buckets;
+    table->old_bucket_count = table->bucket_count;
+    table->migrate_bucket = 0;
     table->bucket_count = new_bucket_count;
-    table->buckets = new_buckets;
+    table->buckets = aim_zmalloc(sizeof(table->buckets[0]) * new_bucket_count);
+
+    if (!(table->flags & BIGHASH_TABLE_F_INCREMENTAL)) {
+        bighash_migrate_finish__(table);
+    }
+}
+
+static void
+bighash_grow(bighash_table_t *table)
+{
+    bighash_resize__(table, table->bucket_count * 2);
+    table->grow_count++;
+}
+
+static int
+bighash_should_shrink__(bighash_table_t *table)
+{
+    return (table->flags & BIGHASH_TABLE_F_AUTOGROW) &&
+        (table->flags & BIGHASH_TABLE_F_AUTOSHRINK) &&
+        table->bucket_count > BIGHASH_CONFIG_INITIAL_HASH_BUCKETS_SIZE &&
+        table->entry_count < table->bucket_count*BIGHASH_CONFIG_SHRINK_LOAD_FACTOR;
+}
+
+static void
+bighash_shrink(bighash_table_t *table)
+{
+    int new_bucket_count = table->bucket_count;
+
+    /*
+     * Leave the table half way to the grow threshold so a few inserts
+     * after a shrink don't immediately grow it again.
+     */
+    while (new_bucket_count/2 >= BIGHASH_CONFIG_INITIAL_HASH_BUCKETS_SIZE &&
+           table->entry_count < (new_bucket_count/2)*BIGHASH_CONFIG_LOAD_FACTOR/2) {
+        new_bucket_count /= 2;
+    }
+
+    if (new_bucket_count != table->bucket_count) {
+        bighash_resize__(table, new_bucket_count);
+        table->shrink_count++;
+    }
 }
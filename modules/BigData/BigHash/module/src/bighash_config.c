@@ -73,6 +73,36 @@ bighash_config_settings_t bighash_config_settings[] =
     { __bighash_config_STRINGIFY_NAME(BIGHASH_CONFIG_LOAD_FACTOR), __bighash_config_STRINGIFY_VALUE(BIGHASH_CONFIG_LOAD_FACTOR) },
 #else
 { BIGHASH_CONFIG_LOAD_FACTOR(__bighash_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef BIGHASH_CONFIG_INCREMENTAL_BUCKETS
+    { __bighash_config_STRINGIFY_NAME(BIGHASH_CONFIG_INCREMENTAL_BUCKETS), __bighash_config_STRINGIFY_VALUE(BIGHASH_CONFIG_INCREMENTAL_BUCKETS) },
+#else
+{ BIGHASH_CONFIG_INCREMENTAL_BUCKETS(__bighash_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef BIGHASH_CONFIG_SHRINK_LOAD_FACTOR
+    { __bighash_config_STRINGIFY_NAME(BIGHASH_CONFIG_SHRINK_LOAD_FACTOR), __bighash_config_STRINGIFY_VALUE(BIGHASH_CONFIG_SHRINK_LOAD_FACTOR) },
+#else
+{ BIGHASH_CONFIG_SHRINK_LOAD_FACTOR(__bighash_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef BIGHASH_CONFIG_OA_LOAD_FACTOR
+    { __bighash_config_STRINGIFY_NAME(BIGHASH_CONFIG_OA_LOAD_FACTOR), __bighash_config_STRINGIFY_VALUE(BIGHASH_CONFIG_OA_LOAD_FACTOR) },
+#else
+{ BIGHASH_CONFIG_OA_LOAD_FACTOR(__bighash_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef BIGHASH_CONFIG_INCLUDE_PROBE_STATS
+    { __bighash_config_STRINGIFY_NAME(BIGHASH_CONFIG_INCLUDE_PROBE_STATS), __bighash_config_STRINGIFY_VALUE(BIGHASH_CONFIG_INCLUDE_PROBE_STATS) },
+#else
+{ BIGHASH_CONFIG_INCLUDE_PROBE_STATS(__bighash_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef BIGHASH_CONFIG_INCLUDE_RCU
+    { __bighash_config_STRINGIFY_NAME(BIGHASH_CONFIG_INCLUDE_RCU), __bighash_config_STRINGIFY_VALUE(BIGHASH_CONFIG_INCLUDE_RCU) },
+#else
+{ BIGHASH_CONFIG_INCLUDE_RCU(__bighash_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef BIGHASH_CONFIG_KEY_HASH_WORDS
+    { __bighash_config_STRINGIFY_NAME(BIGHASH_CONFIG_KEY_HASH_WORDS), __bighash_config_STRINGIFY_VALUE(BIGHASH_CONFIG_KEY_HASH_WORDS) },
+#else
+{ BIGHASH_CONFIG_KEY_HASH_WORDS(__bighash_config_STRINGIFY_NAME), "__undefined__" },
 #endif
     { NULL, NULL }
 };
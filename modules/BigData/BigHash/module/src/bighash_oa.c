@@ -0,0 +1,343 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+
+#include <BigHash/bighash_config.h>
+#include <BigHash/bighash_oa.h>
+#include "bighash_log.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ * Control byte values. Full slots hold the low 7 bits of the hash,
+ * so empty and deleted slots are the only negative values.
+ */
+#define CTRL_EMPTY   ((int8_t)-128)
+#define CTRL_DELETED ((int8_t)-2)
+
+#define HASH_TAG(_hash) ((int8_t)((_hash) & 0x7f))
+#define HASH_GROUP(_hash) ((_hash) >> 7)
+
+/* Bitmask of the slots in a group whose control byte equals 'value' */
+static inline uint32_t
+group_match__(const int8_t *ctrl, int8_t value)
+{
+#ifdef __SSE2__
+    __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(value)));
+#else
+    uint32_t mask = 0;
+    int i;
+    for (i = 0; i < BIGHASH_OA_GROUP_SIZE; i++) {
+        if (ctrl[i] == value) {
+            mask |= 1 << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+/* Bitmask of the empty or deleted slots in a group */
+static inline uint32_t
+group_match_free__(const int8_t *ctrl)
+{
+#ifdef __SSE2__
+    return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+#else
+    uint32_t mask = 0;
+    int i;
+    for (i = 0; i < BIGHASH_OA_GROUP_SIZE; i++) {
+        if (ctrl[i] < 0) {
+            mask |= 1 << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+/*
+ * Groups are probed in triangular order, which visits every group
+ * when the group count is a power of 2.
+ */
+#define PROBE_START(_table, _hash, _group, _step)                       \
+    do {                                                                \
+        _group = HASH_GROUP(_hash) & group_mask__(_table);              \
+        _step = 0;                                                      \
+    } while(0)
+
+#define PROBE_NEXT(_table, _group, _step)                               \
+    (_group = (_group + ++_step) & group_mask__(_table))
+
+static inline uint32_t
+group_mask__(bighash_oa_table_t *table)
+{
+    return table->slot_count/BIGHASH_OA_GROUP_SIZE - 1;
+}
+
+static void
+bighash_oa_alloc__(bighash_oa_table_t *table, int slot_count)
+{
+    table->slot_count = slot_count;
+    table->ctrl = aim_malloc(slot_count);
+    BIGHASH_MEMSET(table->ctrl, CTRL_EMPTY, slot_count);
+    table->slots = aim_zmalloc(sizeof(table->slots[0]) * slot_count);
+    table->deleted_count = 0;
+}
+
+bighash_oa_table_t *
+bighash_oa_table_create(int slot_count)
+{
+    bighash_oa_table_t *table = aim_zmalloc(sizeof(*table));
+    int count = BIGHASH_OA_GROUP_SIZE;
+
+    while (count < slot_count) {
+        count *= 2;
+    }
+    bighash_oa_alloc__(table, count);
+    return table;
+}
+
+void
+bighash_oa_table_destroy(bighash_oa_table_t *table, bighash_entry_free_f efree)
+{
+    int i;
+    for (i = 0; i < table->slot_count; i++) {
+        bighash_entry_t *e, *next;
+        if (table->ctrl[i] < 0) {
+            continue;
+        }
+        for (e = table->slots[i]; e; e = next) {
+            next = e->next;
+            e->hash = 0;
+            if (efree) {
+                efree(e);
+            }
+        }
+    }
+
+    aim_free(table->ctrl);
+    aim_free(table->slots);
+    aim_free(table);
+}
+
+/*
+ * Place an entry, along with the entries chained behind it, in the
+ * first free slot of its probe sequence
+ */
+static void
+bighash_oa_place__(bighash_oa_table_t *table, bighash_entry_t *e)
+{
+    uint32_t group, step;
+
+    PROBE_START(table, e->hash, group, step);
+    for (;;) {
+        int8_t *ctrl = table->ctrl + group*BIGHASH_OA_GROUP_SIZE;
+        uint32_t free_mask = group_match_free__(ctrl);
+        if (free_mask) {
+            int slot = group*BIGHASH_OA_GROUP_SIZE + __builtin_ctz(free_mask);
+            if (table->ctrl[slot] == CTRL_DELETED) {
+                table->deleted_count--;
+            }
+            table->ctrl[slot] = HASH_TAG(e->hash);
+            table->slots[slot] = e;
+            return;
+        }
+        PROBE_NEXT(table, group, step);
+    }
+}
+
+/*
+ * Rebuild the table without deleted slots, doubling the slot count
+ * unless most of the load was deleted slots.
+ */
+static void
+bighash_oa_rehash__(bighash_oa_table_t *table)
+{
+    int8_t *old_ctrl = table->ctrl;
+    bighash_entry_t **old_slots = table->slots;
+    int old_slot_count = table->slot_count;
+    int slot_count = old_slot_count;
+    int i;
+
+    if (table->entry_count >= slot_count*BIGHASH_CONFIG_OA_LOAD_FACTOR/2) {
+        slot_count *= 2;
+    }
+
+    bighash_oa_alloc__(table, slot_count);
+    for (i = 0; i < old_slot_count; i++) {
+        if (old_ctrl[i] >= 0) {
+            bighash_oa_place__(table, old_slots[i]);
+        }
+    }
+    table->rehash_count++;
+
+    aim_free(old_ctrl);
+    aim_free(old_slots);
+}
+
+/* Find the slot holding the entries with the given hash, or -1 */
+static int
+bighash_oa_find__(bighash_oa_table_t *table, uint32_t hash)
+{
+    int8_t tag = HASH_TAG(hash);
+    uint32_t group, step;
+
+    PROBE_START(table, hash, group, step);
+
+    /* Fetch the slot pointers in parallel with the control bytes */
+    __builtin_prefetch(table->slots + group*BIGHASH_OA_GROUP_SIZE);
+
+    for (;;) {
+        int8_t *ctrl = table->ctrl + group*BIGHASH_OA_GROUP_SIZE;
+        bighash_entry_t **slots = table->slots + group*BIGHASH_OA_GROUP_SIZE;
+        uint32_t match = group_match__(ctrl, tag);
+
+        while (match) {
+            int i = __builtin_ctz(match);
+            match &= match - 1;
+            if (slots[i]->hash == hash) {
+                return group*BIGHASH_OA_GROUP_SIZE + i;
+            }
+        }
+
+        /* An entry is never placed past a group with an empty slot */
+        if (group_match__(ctrl, CTRL_EMPTY)) {
+            return -1;
+        }
+        PROBE_NEXT(table, group, step);
+    }
+}
+
+void
+bighash_oa_insert(bighash_oa_table_t *table, bighash_entry_t *e, uint32_t hash)
+{
+    int slot;
+
+    /* Deleted slots lengthen probes just like full ones */
+    if (table->entry_count + table->deleted_count + 1 >
+        table->slot_count*BIGHASH_CONFIG_OA_LOAD_FACTOR) {
+        bighash_oa_rehash__(table);
+    }
+
+    e->hash = hash;
+    slot = bighash_oa_find__(table, hash);
+    if (slot >= 0) {
+        /* Behind the first entry, so bighash_oa_first keeps returning it */
+        bighash_entry_t *first = table->slots[slot];
+        e->next = first->next;
+        first->next = e;
+    }
+    else {
+        e->next = NULL;
+        bighash_oa_place__(table, e);
+    }
+    table->entry_count++;
+}
+
+bighash_entry_t *
+bighash_oa_first(bighash_oa_table_t *table, uint32_t hash)
+{
+    int slot = bighash_oa_find__(table, hash);
+    return slot < 0 ? NULL : table->slots[slot];
+}
+
+bighash_entry_t *
+bighash_oa_next(bighash_entry_t *e)
+{
+    return e->next;
+}
+
+void
+bighash_oa_remove(bighash_oa_table_t *table, bighash_entry_t *e)
+{
+    int slot = bighash_oa_find__(table, e->hash);
+    bighash_entry_t **prev;
+    int8_t *ctrl;
+    int i;
+
+    if (slot < 0) {
+        return;
+    }
+
+    for (prev = &table->slots[slot]; *prev != e; prev = &(*prev)->next) {
+        if (*prev == NULL) {
+            return;
+        }
+    }
+    *prev = e->next;
+    table->entry_count--;
+
+    if (table->slots[slot] != NULL) {
+        return;
+    }
+
+    ctrl = table->ctrl + (slot & ~(BIGHASH_OA_GROUP_SIZE - 1));
+    i = slot & (BIGHASH_OA_GROUP_SIZE - 1);
+
+    /*
+     * A group that has never been full can't be in the middle of
+     * another hash's probe sequence, so the slot can go straight back
+     * to empty.
+     */
+    if (group_match__(ctrl, CTRL_EMPTY)) {
+        ctrl[i] = CTRL_EMPTY;
+    }
+    else {
+        ctrl[i] = CTRL_DELETED;
+        table->deleted_count++;
+    }
+}
+
+int
+bighash_oa_entry_count(bighash_oa_table_t *table)
+{
+    return table->entry_count;
+}
+
+void *
+bighash_oa_iter_start(bighash_oa_table_t *table, bighash_oa_iter_t *iter)
+{
+    iter->table = table;
+    iter->slot = 0;
+    iter->next = NULL;
+    return bighash_oa_iter_next(iter);
+}
+
+void *
+bighash_oa_iter_next(bighash_oa_iter_t *iter)
+{
+    bighash_oa_table_t *table = iter->table;
+    bighash_entry_t *e = iter->next;
+
+    while (e == NULL && iter->slot < table->slot_count) {
+        int slot = iter->slot++;
+        if (table->ctrl[slot] >= 0) {
+            e = table->slots[slot];
+        }
+    }
+
+    if (e != NULL) {
+        /* Read ahead so 'e' may be removed */
+        iter->next = e->next;
+        return e;
+    }
+
+    return NULL;
+}
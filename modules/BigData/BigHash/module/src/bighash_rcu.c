@@ -0,0 +1,322 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+
+#include <BigHash/bighash_config.h>
+
+#if BIGHASH_CONFIG_INCLUDE_RCU == 1
+
+#include <BigHash/bighash_rcu.h>
+#include "bighash_log.h"
+#include <sched.h>
+
+struct bighash_rcu_buckets_s {
+    int count;
+    bighash_entry_t *heads[];
+};
+
+#define LOAD(_p) __atomic_load_n(_p, __ATOMIC_ACQUIRE)
+#define STORE(_p, _v) __atomic_store_n(_p, _v, __ATOMIC_RELEASE)
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_RELAX() __builtin_ia32_pause()
+#else
+#define CPU_RELAX() __asm__ __volatile__("" ::: "memory")
+#endif
+
+/* Spin briefly, then give up the CPU in case the thread we wait on needs it */
+#define SPIN_LIMIT 1000
+
+static inline void
+bighash_rcu_wait__(int *spins)
+{
+    if (++*spins < SPIN_LIMIT) {
+        CPU_RELAX();
+    }
+    else {
+        sched_yield();
+    }
+}
+
+static bighash_rcu_buckets_t *
+bighash_rcu_buckets_alloc__(int count)
+{
+    bighash_rcu_buckets_t *buckets =
+        aim_zmalloc(sizeof(*buckets) + sizeof(buckets->heads[0]) * count);
+    buckets->count = count;
+    return buckets;
+}
+
+bighash_rcu_table_t *
+bighash_rcu_table_create(int bucket_count)
+{
+    bighash_rcu_table_t *table = aim_zmalloc(sizeof(*table));
+    int count = BIGHASH_CONFIG_INITIAL_HASH_BUCKETS_SIZE;
+
+    if (bucket_count == BIGHASH_AUTOGROW) {
+        table->flags |= BIGHASH_TABLE_F_AUTOGROW;
+    }
+    while (count < bucket_count) {
+        count *= 2;
+    }
+
+    table->buckets = bighash_rcu_buckets_alloc__(count);
+    table->epoch = 1;
+    table->lock = os_sem_create(1);
+    return table;
+}
+
+void
+bighash_rcu_table_destroy(bighash_rcu_table_t *table, bighash_entry_free_f efree)
+{
+    bighash_rcu_buckets_t *buckets = table->buckets;
+    int b;
+
+    for (b = 0; b < buckets->count; b++) {
+        bighash_entry_t *cur, *next;
+        for (cur = buckets->heads[b]; cur != NULL; cur = next) {
+            next = cur->next;
+            cur->next = NULL;
+            cur->hash = 0;
+            if (efree) {
+                efree(cur);
+            }
+        }
+    }
+
+    os_sem_destroy(table->lock);
+    aim_free(buckets);
+    aim_free(table);
+}
+
+void
+bighash_rcu_reader_register(bighash_rcu_table_t *table,
+                            bighash_rcu_reader_t *reader)
+{
+    reader->epoch = 0;
+    os_sem_take(table->lock);
+    reader->next = table->readers;
+    STORE(&table->readers, reader);
+    os_sem_give(table->lock);
+}
+
+void
+bighash_rcu_reader_unregister(bighash_rcu_table_t *table,
+                              bighash_rcu_reader_t *reader)
+{
+    bighash_rcu_reader_t **prev_ptr;
+
+    os_sem_take(table->lock);
+    for (prev_ptr = &table->readers; *prev_ptr; prev_ptr = &(*prev_ptr)->next) {
+        if (*prev_ptr == reader) {
+            *prev_ptr = reader->next;
+            break;
+        }
+    }
+    os_sem_give(table->lock);
+}
+
+/* Wait for readers that began before this call. Called with the lock held. */
+static void
+bighash_rcu_synchronize_locked__(bighash_rcu_table_t *table)
+{
+    bighash_rcu_reader_t *reader;
+    uint64_t epoch;
+
+    /* Order the preceding unlinks before sampling the readers */
+    epoch = __atomic_add_fetch(&table->epoch, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    for (reader = table->readers; reader; reader = reader->next) {
+        int spins = 0;
+        for (;;) {
+            uint64_t reader_epoch = LOAD(&reader->epoch);
+            if (reader_epoch == 0 || reader_epoch >= epoch) {
+                break;
+            }
+            bighash_rcu_wait__(&spins);
+        }
+    }
+}
+
+void
+bighash_rcu_synchronize(bighash_rcu_table_t *table)
+{
+    os_sem_take(table->lock);
+    bighash_rcu_synchronize_locked__(table);
+    os_sem_give(table->lock);
+}
+
+/*
+ * Advance an old chain's unzip cursor by one link. 'cur' starts a run of
+ * entries that go to the same new bucket. The last entry of the run is
+ * pointed past the following run, which belongs to the sibling bucket,
+ * and that run becomes the next cursor.
+ */
+static bighash_entry_t *
+bighash_rcu_unzip_step__(bighash_entry_t *cur, uint32_t bit)
+{
+    bighash_entry_t *other, *same;
+
+    while (cur->next != NULL && (cur->next->hash & bit) == (cur->hash & bit)) {
+        cur = cur->next;
+    }
+
+    other = cur->next;
+    if (other == NULL) {
+        return NULL;
+    }
+
+    same = other;
+    while (same != NULL && (same->hash & bit) != (cur->hash & bit)) {
+        same = same->next;
+    }
+    STORE(&cur->next, same);
+    return other;
+}
+
+/*
+ * Double the bucket array. Each new bucket starts out pointing at the
+ * first entry of the old chain that belongs to it, so both buckets of a
+ * pair share that chain and lookups skip the other bucket's entries by
+ * hash. The new array is published with one store, and the old one is
+ * freed once no reader can be using it.
+ *
+ * The shared chains are then unzipped one link per chain at a time.
+ * A link is only changed after every reader that may stand on the run
+ * it skips has left, so a reader never misses an entry of its own
+ * bucket and never waits for the grow.
+ */
+static void
+bighash_rcu_grow__(bighash_rcu_table_t *table)
+{
+    bighash_rcu_buckets_t *old = table->buckets;
+    bighash_rcu_buckets_t *new = bighash_rcu_buckets_alloc__(old->count * 2);
+    uint32_t bit = old->count;
+    bighash_entry_t **cursors;
+    int i, zipped;
+
+    for (i = 0; i < old->count; i++) {
+        bighash_entry_t *cur;
+        for (cur = old->heads[i]; cur != NULL; cur = cur->next) {
+            bighash_entry_t **head = &new->heads[i + (cur->hash & bit)];
+            if (*head == NULL) {
+                *head = cur;
+            }
+        }
+    }
+
+    STORE(&table->buckets, new);
+    table->grow_count++;
+    bighash_rcu_synchronize_locked__(table);
+
+    /* No reader can reach the old array now, so it holds the cursors */
+    cursors = old->heads;
+    do {
+        zipped = 0;
+        for (i = 0; i < old->count; i++) {
+            if (cursors[i] != NULL) {
+                cursors[i] = bighash_rcu_unzip_step__(cursors[i], bit);
+                zipped |= cursors[i] != NULL;
+            }
+        }
+        if (zipped) {
+            bighash_rcu_synchronize_locked__(table);
+        }
+    } while (zipped);
+
+    aim_free(old);
+}
+
+void
+bighash_rcu_insert(bighash_rcu_table_t *table, bighash_entry_t *e, uint32_t hash)
+{
+    bighash_rcu_buckets_t *buckets;
+    bighash_entry_t **bucket;
+
+    os_sem_take(table->lock);
+
+    buckets = table->buckets;
+    bucket = &buckets->heads[hash & (buckets->count - 1)];
+    e->hash = hash;
+    e->next = *bucket;
+    STORE(bucket, e);
+    table->entry_count++;
+
+    if ((table->flags & BIGHASH_TABLE_F_AUTOGROW) &&
+        table->entry_count >= buckets->count*BIGHASH_CONFIG_LOAD_FACTOR) {
+        bighash_rcu_grow__(table);
+    }
+
+    os_sem_give(table->lock);
+}
+
+void
+bighash_rcu_remove(bighash_rcu_table_t *table, bighash_entry_t *e)
+{
+    bighash_rcu_buckets_t *buckets;
+    bighash_entry_t **prev_ptr;
+
+    os_sem_take(table->lock);
+
+    buckets = table->buckets;
+    prev_ptr = &buckets->heads[e->hash & (buckets->count - 1)];
+    while (*prev_ptr != NULL) {
+        if (*prev_ptr == e) {
+            /* e->next is left alone for readers standing on e */
+            STORE(prev_ptr, e->next);
+            table->entry_count--;
+            break;
+        }
+        prev_ptr = &(*prev_ptr)->next;
+    }
+
+    os_sem_give(table->lock);
+}
+
+/* Find the first entry with the given hash, starting at 'e' */
+static inline bighash_entry_t *
+bighash_rcu_search__(bighash_entry_t *e, uint32_t hash)
+{
+    while (e != NULL && e->hash != hash) {
+        e = LOAD(&e->next);
+    }
+    return e;
+}
+
+bighash_entry_t *
+bighash_rcu_first(bighash_rcu_table_t *table, uint32_t hash)
+{
+    bighash_rcu_buckets_t *buckets = LOAD(&table->buckets);
+    return bighash_rcu_search__(LOAD(&buckets->heads[hash & (buckets->count - 1)]), hash);
+}
+
+bighash_entry_t *
+bighash_rcu_next(bighash_rcu_table_t *table, bighash_entry_t *e)
+{
+    (void)table;
+    return bighash_rcu_search__(LOAD(&e->next), e->hash);
+}
+
+int
+bighash_rcu_entry_count(bighash_rcu_table_t *table)
+{
+    return __atomic_load_n(&table->entry_count, __ATOMIC_RELAXED);
+}
+
+#endif /* BIGHASH_CONFIG_INCLUDE_RCU */
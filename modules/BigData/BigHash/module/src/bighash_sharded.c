@@ -0,0 +1,147 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+
+#include <BigHash/bighash_config.h>
+
+#if BIGHASH_CONFIG_INCLUDE_LOCKING == 1
+
+#include <BigHash/bighash_sharded.h>
+#include "bighash_log.h"
+
+bighash_sharded_table_t *
+bighash_sharded_table_create(int shard_count, int bucket_count)
+{
+    bighash_sharded_table_t *table = aim_zmalloc(sizeof(*table));
+    int i;
+
+    table->shard_count = 1;
+    while (table->shard_count < shard_count) {
+        table->shard_count *= 2;
+        table->shard_bits++;
+    }
+
+    /* Over-allocate to align the shards to a cache line */
+    table->shards_alloc = aim_zmalloc(sizeof(table->shards[0]) * table->shard_count + 63);
+    table->shards = (bighash_shard_t *)(((uintptr_t)table->shards_alloc + 63) & ~(uintptr_t)63);
+    for (i = 0; i < table->shard_count; i++) {
+        table->shards[i].table = bighash_table_create(bucket_count);
+        pthread_mutex_init(&table->shards[i].lock, NULL);
+    }
+
+    return table;
+}
+
+void
+bighash_sharded_table_destroy(bighash_sharded_table_t *table,
+                              bighash_entry_free_f efree)
+{
+    int i;
+    for (i = 0; i < table->shard_count; i++) {
+        bighash_table_destroy(table->shards[i].table, efree);
+        pthread_mutex_destroy(&table->shards[i].lock);
+    }
+    aim_free(table->shards_alloc);
+    aim_free(table);
+}
+
+void
+bighash_sharded_insert(bighash_sharded_table_t *table,
+                       bighash_entry_t *e, uint32_t hash)
+{
+    bighash_shard_t *shard = bighash_sharded_shard__(table, hash);
+    pthread_mutex_lock(&shard->lock);
+    bighash_insert(shard->table, e, hash);
+    pthread_mutex_unlock(&shard->lock);
+}
+
+void
+bighash_sharded_remove(bighash_sharded_table_t *table, bighash_entry_t *e)
+{
+    bighash_shard_t *shard = bighash_sharded_shard__(table, e->hash);
+    pthread_mutex_lock(&shard->lock);
+    bighash_remove(shard->table, e);
+    pthread_mutex_unlock(&shard->lock);
+}
+
+int
+bighash_sharded_entry_count(bighash_sharded_table_t *table)
+{
+    int i, count = 0;
+    for (i = 0; i < table->shard_count; i++) {
+        count += bighash_entry_count(table->shards[i].table);
+    }
+    return count;
+}
+
+/* Move to the next non-empty shard, leaving it locked */
+static void *
+bighash_sharded_iter_advance__(bighash_sharded_iter_t *iter)
+{
+    bighash_sharded_table_t *table = iter->table;
+    void *e = NULL;
+
+    while (e == NULL) {
+        pthread_mutex_unlock(&table->shards[iter->shard].lock);
+        if (++iter->shard == table->shard_count) {
+            return NULL;
+        }
+        pthread_mutex_lock(&table->shards[iter->shard].lock);
+        e = bighash_iter_start(table->shards[iter->shard].table, &iter->iter);
+    }
+
+    return e;
+}
+
+void *
+bighash_sharded_iter_start(bighash_sharded_table_t *table,
+                           bighash_sharded_iter_t *iter)
+{
+    void *e;
+
+    iter->table = table;
+    iter->shard = 0;
+    pthread_mutex_lock(&table->shards[0].lock);
+    e = bighash_iter_start(table->shards[0].table, &iter->iter);
+    return e ? e : bighash_sharded_iter_advance__(iter);
+}
+
+void *
+bighash_sharded_iter_next(bighash_sharded_iter_t *iter)
+{
+    void *e;
+
+    if (iter->shard >= iter->table->shard_count) {
+        return NULL;
+    }
+
+    e = bighash_iter_next(&iter->iter);
+    return e ? e : bighash_sharded_iter_advance__(iter);
+}
+
+void
+bighash_sharded_iter_stop(bighash_sharded_iter_t *iter)
+{
+    if (iter->shard < iter->table->shard_count) {
+        bighash_iter_stop(&iter->iter);
+        pthread_mutex_unlock(&iter->table->shards[iter->shard].lock);
+        iter->shard = iter->table->shard_count;
+    }
+}
+
+#endif /* BIGHASH_CONFIG_INCLUDE_LOCKING */
@@ -0,0 +1,183 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+
+#include <BigHash/bighash_config.h>
+#include <BigHash/bighash_stats.h>
+#include <AIM/aim_list.h>
+#include <inttypes.h>
+#include "bighash_log.h"
+
+/* Registered table */
+typedef struct bighash_stats_entry_s {
+    struct list_links links;
+    bighash_table_t *table;
+    char *name;
+#if BIGHASH_CONFIG_INCLUDE_LOCKING == 1
+    /* Owner's lock, or NULL */
+    os_sem_t lock;
+#endif
+} bighash_stats_entry_t;
+
+static LIST_DEFINE(bighash_stats_tables__);
+
+#if BIGHASH_CONFIG_INCLUDE_LOCKING == 1
+/* Registry lock, created on first use since os_sem has no static initializer */
+static os_sem_t
+bighash_stats_lock__(void)
+{
+    static os_sem_t lock;
+    os_sem_t cur = __atomic_load_n(&lock, __ATOMIC_ACQUIRE);
+
+    if (cur == NULL) {
+        os_sem_t new = os_sem_create(1);
+        if (__atomic_compare_exchange_n(&lock, &cur, new, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            cur = new;
+        }
+        else {
+            os_sem_destroy(new);
+        }
+    }
+    return cur;
+}
+
+#define REGISTRY_LOCK() os_sem_take(bighash_stats_lock__())
+#define REGISTRY_UNLOCK() os_sem_give(bighash_stats_lock__())
+#else
+#define REGISTRY_LOCK()
+#define REGISTRY_UNLOCK()
+#endif
+
+void
+bighash_stats_show(bighash_stats_t *stats, aim_pvs_t *pvs)
+{
+    int i;
+
+    aim_printf(pvs, "table: %d buckets, %d entries, load %.2f, grown %d, shrunk %d\n",
+               stats->bucket_count, stats->entry_count, stats->load_factor,
+               stats->grow_count, stats->shrink_count);
+    if (stats->old_bucket_count) {
+        aim_printf(pvs, "resizing: %d old buckets left to migrate\n",
+                   stats->old_bucket_count);
+    }
+    aim_printf(pvs, "chains: %.1f%% empty, mean %.2f, max %d\n",
+               100.0 * stats->empty_buckets /
+               (stats->bucket_count + stats->old_bucket_count),
+               stats->mean_chain, stats->max_chain);
+
+    aim_printf(pvs, "lengths:");
+    for (i = 0; i < BIGHASH_STATS_CHAIN_BUCKETS && i <= stats->max_chain; i++) {
+        aim_printf(pvs, " %d%s:%u", i,
+                   i == BIGHASH_STATS_CHAIN_BUCKETS - 1 ? "+" : "",
+                   stats->chain_counts[i]);
+    }
+    aim_printf(pvs, "\n");
+
+    if (stats->lookup_count) {
+        aim_printf(pvs, "probes: %.2f per lookup, %"PRIu64" lookups\n",
+                   (double)stats->probe_count / stats->lookup_count,
+                   stats->lookup_count);
+    }
+}
+
+static bighash_stats_entry_t *
+bighash_stats_entry_create__(bighash_table_t *table, const char *name)
+{
+    bighash_stats_entry_t *entry = aim_zmalloc(sizeof(*entry));
+    entry->table = table;
+    entry->name = aim_strdup(name);
+    return entry;
+}
+
+static void
+bighash_stats_add__(bighash_stats_entry_t *entry)
+{
+    REGISTRY_LOCK();
+    list_push(&bighash_stats_tables__, &entry->links);
+    entry->table->flags |= BIGHASH_TABLE_F_STATS_REGISTERED;
+    REGISTRY_UNLOCK();
+}
+
+void
+bighash_stats_register(bighash_table_t *table, const char *name)
+{
+    bighash_stats_add__(bighash_stats_entry_create__(table, name));
+}
+
+#if BIGHASH_CONFIG_INCLUDE_LOCKING == 1
+void
+bighash_stats_register_locked(bighash_table_t *table, const char *name,
+                              os_sem_t lock)
+{
+    bighash_stats_entry_t *entry = bighash_stats_entry_create__(table, name);
+    entry->lock = lock;
+    bighash_stats_add__(entry);
+}
+#endif
+
+void
+bighash_stats_unregister(bighash_table_t *table)
+{
+    struct list_links *cur, *next;
+
+    REGISTRY_LOCK();
+    LIST_FOREACH_SAFE(&bighash_stats_tables__, cur, next) {
+        bighash_stats_entry_t *entry = container_of(cur, links, bighash_stats_entry_t);
+        if (entry->table == table) {
+            list_remove(&entry->links);
+            aim_free(entry->name);
+            aim_free(entry);
+        }
+    }
+    table->flags &= ~BIGHASH_TABLE_F_STATS_REGISTERED;
+    REGISTRY_UNLOCK();
+}
+
+int
+bighash_stats_show_registered(const char *prefix, aim_pvs_t *pvs)
+{
+    struct list_links *cur;
+    int count = 0;
+
+    REGISTRY_LOCK();
+    LIST_FOREACH(&bighash_stats_tables__, cur) {
+        bighash_stats_entry_t *entry = container_of(cur, links, bighash_stats_entry_t);
+        bighash_stats_t stats;
+        if (prefix && strncmp(entry->name, prefix, strlen(prefix))) {
+            continue;
+        }
+#if BIGHASH_CONFIG_INCLUDE_LOCKING == 1
+        if (entry->lock) {
+            os_sem_take(entry->lock);
+        }
+#endif
+        bighash_stats_get(entry->table, &stats);
+#if BIGHASH_CONFIG_INCLUDE_LOCKING == 1
+        if (entry->lock) {
+            os_sem_give(entry->lock);
+        }
+#endif
+        aim_printf(pvs, "%s\n", entry->name);
+        bighash_stats_show(&stats, pvs);
+        count++;
+    }
+    REGISTRY_UNLOCK();
+
+    return count;
+}
@@ -24,6 +24,7 @@
 #include <uCli/ucli.h>
 #include <uCli/ucli_argparse.h>
 #include <uCli/ucli_handler_macros.h>
+#include <BigHash/bighash_stats.h>
 
 static ucli_status_t
 bighash_ucli_ucli__config__(ucli_context_t* uc)
@@ -31,6 +32,24 @@ bighash_ucli_ucli__config__(ucli_context_t* uc)
     UCLI_HANDLER_MACRO_MODULE_CONFIG(bighash)
 }
 
+static ucli_status_t
+bighash_ucli_ucli__stats__(ucli_context_t* uc)
+{
+    UCLI_COMMAND_INFO(uc,
+                      "stats", -1,
+                      "$summary#Show chain statistics of registered hash tables.");
+
+    const char *prefix = NULL;
+    if (uc->pargs->count > 0) {
+        UCLI_ARGPARSE_OR_RETURN(uc, "s", &prefix);
+    }
+
+    if (bighash_stats_show_registered(prefix, &uc->pvs) == 0) {
+        ucli_printf(uc, "no hash tables registered\n");
+    }
+    return UCLI_STATUS_OK;
+}
+
 /* <auto.ucli.handlers.start> */
 /******************************************************************************
  *
@@ -41,6 +60,7 @@ bighash_ucli_ucli__config__(ucli_context_t* uc)
 static ucli_command_handler_f bighash_ucli_ucli_handlers__[] =
 {
     bighash_ucli_ucli__config__,
+    bighash_ucli_ucli__stats__,
     NULL
 };
 /******************************************************************************/
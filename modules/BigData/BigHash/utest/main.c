@@ -30,6 +30,14 @@
 #include <stdlib.h>
 #include <murmur/murmur.h>
 #include <AIM/aim_list.h> /* for container_of */
+#include <BigHash/bighash_oa.h>
+#include <BigHash/bighash_rcu.h>
+#include <BigHash/bighash_sharded.h>
+#include <BigHash/bighash_stats.h>
+#include <histogram/histogram.h>
+#include <OS/os_time.h>
+#include <pthread.h>
+#include <unistd.h>
 
 #define AIM_LOG_MODULE_NAME bighash_unittest
 #include <AIM/aim_log.h>
@@ -170,6 +178,8 @@ int test_table_data__(bighash_table_t *table, biglist_t** entry_list)
 }
 
 #include "test_hashtable.h"
+#include "test_oa_hashtable.h"
+#include "test_padded_hashtable.h"
 
 int
 test_template(void)
@@ -206,6 +216,60 @@ test_template(void)
     return 0;
 }
 
+static void
+test_key_hooks(void)
+{
+    /* One spare byte for the unaligned hash of a + 1 */
+    uint8_t a[49], b[49];
+    int len, i;
+
+    for(i = 0; i < (int)sizeof(a); i++) {
+        a[i] = b[i] = random();
+    }
+
+    /* Hashes match murmur_hash unless the 8 byte word mix is enabled */
+    for(len = 1; len < (int)sizeof(a); len++) {
+        if(!BIGHASH_CONFIG_KEY_HASH_WORDS || (len != 16 && len != 40)) {
+            AIM_ASSERT(bighash_key_hash(a, len, 7) == murmur_hash(a, len, 7));
+        }
+        else {
+            AIM_ASSERT(bighash_key_hash(a, len, 7) == bighash_key_hash_words(a, len, 7));
+        }
+        if(len % 8 == 0) {
+            AIM_ASSERT(bighash_key_hash_words(a, len, 7) != bighash_key_hash_words(a, len, 8));
+            AIM_ASSERT(bighash_key_hash_words(a, len, 7) != bighash_key_hash_words(a + 1, len, 7));
+        }
+        AIM_ASSERT(bighash_key_equal(a, b, len));
+        for(i = 0; i < len; i++) {
+            b[i] ^= 0x10;
+            AIM_ASSERT(!bighash_key_equal(a, b, len));
+            b[i] ^= 0x10;
+        }
+    }
+
+    /* Padding bytes don't affect lookups with custom hash and compare */
+    {
+        bighash_table_t *table = bighash_table_create(BIGHASH_AUTOGROW);
+        test_padded_entry_t entry;
+        test_padded_key_t key;
+
+        memset(&entry, 0xff, sizeof(entry));
+        entry.key.proto = 6;
+        entry.key.addr = 0x0a000001;
+        test_padded_hashtable_insert(table, &entry);
+        AIM_ASSERT(entry.hash_entry.hash == test_padded_key_hash(&entry.key, 42));
+
+        memset(&key, 0, sizeof(key));
+        key.proto = 6;
+        key.addr = 0x0a000001;
+        AIM_ASSERT(test_padded_hashtable_first(table, &key) == &entry);
+        key.proto = 17;
+        AIM_ASSERT(test_padded_hashtable_first(table, &key) == NULL);
+
+        bighash_table_destroy(table, NULL);
+    }
+}
+
 static void
 test_autogrow(void)
 {
@@ -228,8 +292,1085 @@ test_autogrow(void)
     }
 }
 
+static void
+test_incremental(void)
+{
+    bighash_table_t *table = bighash_table_create_flags(BIGHASH_AUTOGROW,
+                                                        BIGHASH_TABLE_F_INCREMENTAL);
+    biglist_t *entries = NULL;
+    int migrating = 0;
+    int c;
+
+    /* Every entry must be reachable while buckets are migrating */
+    for(c = 0; c < 8500; c++) {
+        test_entry_t *te = aim_zmalloc(sizeof(*te));
+        te->id = c;
+        bighash_insert(table, &te->hash_entry, hash_id(te->id));
+        entries = biglist_prepend(entries, te);
+        if(table->old_buckets != NULL) {
+            migrating++;
+            AIM_ASSERT(find_by_id(table, te->id) == te);
+            AIM_ASSERT(find_by_id(table, c/2) != NULL);
+        }
+    }
+    AIM_ASSERT(migrating > 0);
+    AIM_ASSERT(table->bucket_count == 32768);
+
+    /* Iteration walks both bucket arrays without migrating any */
+    AIM_ASSERT(table->old_buckets != NULL);
+    migrating = table->migrate_bucket;
+    {
+        bighash_iter_t iter;
+        bighash_entry_t *e;
+        c = 0;
+        for(e = bighash_iter_start(table, &iter); e; e = bighash_iter_next(&iter)) {
+            AIM_ASSERT(find_by_id(table, container_of(e, hash_entry, test_entry_t)->id) != NULL);
+            c++;
+        }
+        AIM_ASSERT(c == 8500);
+    }
+    AIM_ASSERT(table->old_buckets != NULL);
+    AIM_ASSERT(table->migrate_bucket == migrating);
+    AIM_ASSERT(table->iterators == 0);
+
+    /* Lookups during an iteration don't migrate, until it is stopped */
+    {
+        bighash_iter_t iter;
+        AIM_ASSERT(bighash_iter_start(table, &iter) != NULL);
+        AIM_ASSERT(find_by_id(table, 1) != NULL);
+        AIM_ASSERT(table->migrate_bucket == migrating);
+        bighash_iter_stop(&iter);
+        bighash_iter_stop(&iter);
+        AIM_ASSERT(table->iterators == 0);
+        AIM_ASSERT(bighash_iter_next(&iter) == NULL);
+        AIM_ASSERT(find_by_id(table, 1) != NULL);
+        AIM_ASSERT(table->old_buckets == NULL ||
+                   table->migrate_bucket > migrating);
+    }
+    test_table_data__(table, &entries);
+
+    /* Destroy must free entries from both bucket arrays */
+    insert__(table, 16384, NULL);
+    AIM_ASSERT(table->old_buckets != NULL);
+    bighash_table_destroy(table, free_test_entry);
+}
+
+static void
+test_autoshrink__(uint32_t flags)
+{
+    bighash_table_t *table = bighash_table_create_flags(BIGHASH_AUTOGROW,
+                                                        BIGHASH_TABLE_F_AUTOSHRINK | flags);
+    biglist_t *entries = NULL;
+    biglist_t *ble;
+    test_entry_t *te;
+    int count = 0, bucket_count;
+
+    insert__(table, 10000, &entries);
+    AIM_ASSERT(table->bucket_count == 32768);
+
+    /* Removes shrink the table as it drains */
+    for (ble = entries; ble && count < 9900; count++) {
+        te = ble->data;
+        bighash_remove(table, &te->hash_entry);
+        entries = biglist_remove_link_free(entries, ble);
+        aim_free(te);
+        ble = entries;
+    }
+    AIM_ASSERT(table->shrink_count > 0);
+    if (flags & BIGHASH_TABLE_F_INCREMENTAL) {
+        /* A shrink only starts once the previous one has migrated */
+        AIM_ASSERT(table->bucket_count < 32768);
+    }
+    else {
+        AIM_ASSERT(table->bucket_count == 512);
+    }
+
+    /* Same-hash lookups still see every entry while buckets merge */
+    BIGLIST_FOREACH_DATA(ble, entries, test_entry_t*, te) {
+        AIM_ASSERT(find_by_id(table, te->id) == te);
+    }
+
+    /* Hysteresis: refilling to just below the grow threshold doesn't resize */
+    bucket_count = table->bucket_count;
+    while (bighash_entry_count(table) < bucket_count*BIGHASH_CONFIG_LOAD_FACTOR - 1) {
+        te = aim_zmalloc(sizeof(*te));
+        te->id = 100000 + bighash_entry_count(table);
+        bighash_insert(table, &te->hash_entry, hash_id(te->id));
+        entries = biglist_prepend(entries, te);
+        AIM_ASSERT(table->bucket_count == bucket_count);
+    }
+    bighash_table_destroy(table, free_test_entry);
+    biglist_free(entries);
+
+    /* Removes during an iteration don't shrink, the next one after it does */
+    table = bighash_table_create_flags(BIGHASH_AUTOGROW,
+                                       BIGHASH_TABLE_F_AUTOSHRINK | flags);
+    entries = NULL;
+    insert__(table, 1000, &entries);
+    AIM_ASSERT(table->bucket_count == 2048);
+    {
+        bighash_iter_t iter;
+        bighash_entry_t *e;
+        for(e = bighash_iter_start(table, &iter); e; e = bighash_iter_next(&iter)) {
+            test_entry_t *te = container_of(e, hash_entry, test_entry_t);
+            if(te->id >= 11) {
+                bighash_remove(table, e);
+                entries = biglist_remove(entries, te);
+                aim_free(te);
+            }
+        }
+    }
+    AIM_ASSERT(table->bucket_count == 2048);
+    AIM_ASSERT(bighash_entry_count(table) == 11);
+    te = entries->data;
+    bighash_remove(table, &te->hash_entry);
+    entries = biglist_remove(entries, te);
+    aim_free(te);
+    AIM_ASSERT(table->bucket_count == BIGHASH_CONFIG_INITIAL_HASH_BUCKETS_SIZE*8);
+    test_table_data__(table, &entries);
+    bighash_table_destroy(table, NULL);
+}
+
+static void
+test_autoshrink(void)
+{
+    test_autoshrink__(0);
+    test_autoshrink__(BIGHASH_TABLE_F_INCREMENTAL);
+}
+
+static void
+test_entries_move__(int src_buckets, int dst_buckets, int dst_count)
+{
+    bighash_table_t *src = bighash_table_create(src_buckets);
+    bighash_table_t *dst = bighash_table_create(dst_buckets);
+    biglist_t *entries = NULL;
+    bighash_iter_t iter;
+    int c;
+
+    for(c = 0; c < 1000 + dst_count; c++) {
+        test_entry_t *te = aim_zmalloc(sizeof(*te));
+        te->id = c;
+        bighash_insert(c < dst_count ? dst : src, &te->hash_entry, hash_id(te->id));
+        entries = biglist_prepend(entries, te);
+    }
+
+    bighash_entries_move(dst, src);
+    AIM_ASSERT(bighash_entry_count(src) == 0);
+    AIM_ASSERT(bighash_iter_start(src, &iter) == NULL);
+    AIM_ASSERT(bighash_entry_count(dst) == 1000 + dst_count);
+    test_table_data__(dst, &entries);
+
+    bighash_table_destroy(src, NULL);
+    bighash_table_destroy(dst, free_test_entry);
+    biglist_free(entries);
+}
+
+static void
+test_entries_move(void)
+{
+    /* Spliced chains */
+    test_entries_move__(64, 64, 0);
+    test_entries_move__(64, 64, 100);
+    test_entries_move__(256, 64, 100);
+    /* Relinked entries */
+    test_entries_move__(64, 256, 100);
+    test_entries_move__(100, 64, 100);
+    test_entries_move__(64, 100, 100);
+
+    /* An autogrow destination is resized once, to the final size */
+    {
+        bighash_table_t *src = bighash_table_create_flags(BIGHASH_AUTOGROW,
+                                                          BIGHASH_TABLE_F_INCREMENTAL);
+        bighash_table_t *dst = bighash_table_create(BIGHASH_AUTOGROW);
+        biglist_t *entries = NULL;
+        int grow_count;
+
+        insert__(src, 10000, &entries);
+        AIM_ASSERT(src->old_buckets != NULL);
+        grow_count = dst->grow_count;
+        bighash_entries_move(dst, src);
+        AIM_ASSERT(dst->grow_count == grow_count + 1);
+        AIM_ASSERT(dst->bucket_count == 32768);
+        AIM_ASSERT(src->old_buckets == NULL);
+        AIM_ASSERT(bighash_entry_count(src) == 0);
+        test_table_data__(dst, &entries);
+
+        /* And back, onto a table with a different bucket count */
+        bighash_entries_move(src, dst);
+        AIM_ASSERT(bighash_entry_count(dst) == 0);
+        test_table_data__(src, &entries);
+
+        bighash_table_destroy(dst, NULL);
+        bighash_table_destroy(src, free_test_entry);
+        biglist_free(entries);
+    }
+
+    /* A destination in the middle of a resize keeps migrating incrementally */
+    {
+        bighash_table_t *src = bighash_table_create(64);
+        bighash_table_t *dst = bighash_table_create_flags(BIGHASH_AUTOGROW,
+                                                          BIGHASH_TABLE_F_INCREMENTAL);
+        biglist_t *entries = NULL;
+        int migrate_bucket, i;
+
+        insert__(dst, 8200, &entries);
+        AIM_ASSERT(dst->old_buckets != NULL);
+        migrate_bucket = dst->migrate_bucket;
+        for(i = 0; i < 10; i++) {
+            test_entry_t *te = aim_zmalloc(sizeof(*te));
+            te->id = 100000 + i;
+            bighash_insert(src, &te->hash_entry, hash_id(te->id));
+            entries = biglist_prepend(entries, te);
+        }
+        bighash_entries_move(dst, src);
+        AIM_ASSERT(dst->old_buckets != NULL);
+        AIM_ASSERT(dst->migrate_bucket == migrate_bucket);
+        test_table_data__(dst, &entries);
+
+        bighash_table_destroy(src, NULL);
+        bighash_table_destroy(dst, free_test_entry);
+        biglist_free(entries);
+    }
+
+    /* An autoshrink source shrinks once it is empty */
+    {
+        bighash_table_t *src = bighash_table_create_flags(BIGHASH_AUTOGROW,
+                                                          BIGHASH_TABLE_F_AUTOSHRINK);
+        bighash_table_t *dst = bighash_table_create(BIGHASH_AUTOGROW);
+
+        insert__(src, 10000, NULL);
+        bighash_entries_move(dst, src);
+        AIM_ASSERT(src->bucket_count == BIGHASH_CONFIG_INITIAL_HASH_BUCKETS_SIZE);
+        AIM_ASSERT(bighash_entry_count(dst) == 10000);
+
+        bighash_table_destroy(src, NULL);
+        bighash_table_destroy(dst, free_test_entry);
+    }
+}
+
+static void
+test_stats(void)
+{
+    bighash_table_t *table = bighash_table_create(16);
+    bighash_entry_t entries[40];
+    bighash_stats_t stats;
+    struct histogram *hist;
+    int i;
+
+    /* Chains of 0..8 in buckets 0..8, with 4 more in bucket 9 */
+    for(i = 0; i < 36; i++) {
+        int bucket = 1;
+        while((bucket*(bucket+1))/2 <= i) {
+            bucket++;
+        }
+        bighash_insert(table, &entries[i], bucket);
+    }
+    for(i = 36; i < 40; i++) {
+        bighash_insert(table, &entries[i], 9 + 16*i);
+    }
+
+    bighash_stats_get(table, &stats);
+    AIM_ASSERT(stats.bucket_count == 16);
+    AIM_ASSERT(stats.entry_count == 40);
+    AIM_ASSERT(stats.load_factor == 2.5);
+    AIM_ASSERT(stats.empty_buckets == 7);
+    AIM_ASSERT(stats.max_chain == 8);
+    AIM_ASSERT(stats.mean_chain == 40.0/9);
+    AIM_ASSERT(stats.chain_counts[0] == 7);
+    AIM_ASSERT(stats.chain_counts[4] == 2);
+    AIM_ASSERT(stats.chain_counts[8] == 1);
+    AIM_ASSERT(stats.grow_count == 0);
+
+#if BIGHASH_CONFIG_INCLUDE_PROBE_STATS == 1
+    /* The oldest entry in bucket 8 is at the end of the chain */
+    hist = histogram_create("bighash_utest.probes");
+    bighash_stats_probe_histogram_set(table, hist);
+    AIM_ASSERT(bighash_first(table, 8) == &entries[35]);
+    AIM_ASSERT(bighash_first(table, 24) == NULL);
+    AIM_ASSERT(table->lookup_count == 2);
+    AIM_ASSERT(table->probe_count == 1 + 8);
+    AIM_ASSERT(hist->counts[histogram_bucket(1)] == 1);
+    AIM_ASSERT(hist->counts[histogram_bucket(8)] == 1);
+    bighash_stats_probe_histogram_set(table, NULL);
+    histogram_destroy(hist);
+#else
+    (void)hist;
+#endif
+
+    bighash_stats_register(table, "bighash_utest.fixed");
+    AIM_ASSERT(bighash_stats_show_registered("bighash_utest", &aim_pvs_stdout) == 1);
+    AIM_ASSERT(bighash_stats_show_registered("other", &aim_pvs_stdout) == 0);
+    bighash_stats_unregister(table);
+    AIM_ASSERT(bighash_stats_show_registered(NULL, &aim_pvs_stdout) == 0);
+
+#if BIGHASH_CONFIG_INCLUDE_LOCKING == 1
+    {
+        os_sem_t lock = os_sem_create(1);
+        bighash_stats_register_locked(table, "bighash_utest.locked", lock);
+        AIM_ASSERT(bighash_stats_show_registered("bighash_utest.locked", &aim_pvs_stdout) == 1);
+        /* Showing gave the owner's lock back */
+        AIM_ASSERT(os_sem_take_timeout(lock, 1000) == 0);
+        os_sem_give(lock);
+        bighash_stats_unregister(table);
+        os_sem_destroy(lock);
+    }
+#endif
+
+    /* Destroy unregisters the table */
+    bighash_stats_register(table, "bighash_utest.fixed");
+    bighash_table_destroy(table, NULL);
+    AIM_ASSERT(bighash_stats_show_registered(NULL, &aim_pvs_stdout) == 0);
+
+    /* Stats during an incremental resize count both bucket arrays */
+    {
+        bighash_table_t *t = bighash_table_create_flags(BIGHASH_AUTOGROW,
+                                                        BIGHASH_TABLE_F_INCREMENTAL);
+        int migrate_bucket, chained = 0;
+        insert__(t, 8200, NULL);
+        AIM_ASSERT(t->old_buckets != NULL);
+        migrate_bucket = t->migrate_bucket;
+        bighash_stats_get(t, &stats);
+        AIM_ASSERT(t->old_buckets != NULL);
+        AIM_ASSERT(t->migrate_bucket == migrate_bucket);
+        AIM_ASSERT(stats.old_bucket_count == t->old_bucket_count - migrate_bucket);
+        for(i = 0; i < BIGHASH_STATS_CHAIN_BUCKETS; i++) {
+            chained += stats.chain_counts[i];
+        }
+        AIM_ASSERT(chained == stats.bucket_count + stats.old_bucket_count);
+        bighash_table_destroy(t, free_test_entry);
+    }
+
+    /* Grow and shrink counts */
+    {
+        bighash_table_t *t = bighash_table_create_flags(BIGHASH_AUTOGROW,
+                                                        BIGHASH_TABLE_F_AUTOSHRINK);
+        test_entry_t *te = aim_zmalloc(sizeof(*te) * 1000);
+        for(i = 0; i < 1000; i++) {
+            te[i].id = i;
+            bighash_insert(t, &te[i].hash_entry, hash_id(i));
+        }
+        for(i = 1; i < 1000; i++) {
+            bighash_remove(t, &te[i].hash_entry);
+        }
+        bighash_insert(t, &te[1].hash_entry, hash_id(1));
+        bighash_stats_get(t, &stats);
+        AIM_ASSERT(stats.grow_count == 8);
+        /* Each remove past the low-water mark halves the table again */
+        AIM_ASSERT(stats.shrink_count == 8);
+        AIM_ASSERT(stats.bucket_count == BIGHASH_CONFIG_INITIAL_HASH_BUCKETS_SIZE);
+        AIM_ASSERT(stats.entry_count == 2);
+        bighash_table_destroy(t, NULL);
+        aim_free(te);
+    }
+}
+
+static void
+test_lookup_batch(void)
+{
+    bighash_table_t *table = bighash_table_create_flags(BIGHASH_AUTOGROW,
+                                                        BIGHASH_TABLE_F_INCREMENTAL);
+    int count = 1000, nkeys = 150;
+    test_entry_t *entries = aim_zmalloc(sizeof(*entries) * count);
+    uint32_t ids[150];
+    const uint32_t *keys[150];
+    test_entry_t *objs[150];
+    int i;
+
+    for(i = 0; i < count; i++) {
+        entries[i].id = i;
+        test_hashtable_insert(table, &entries[i]);
+    }
+
+    /* Even keys hit, odd keys miss. Longer than one batch. */
+    for(i = 0; i < nkeys; i++) {
+        ids[i] = (i % 2) ? count + i : i*5;
+        keys[i] = &ids[i];
+    }
+
+    test_hashtable_lookup_batch(table, keys, objs, nkeys);
+    for(i = 0; i < nkeys; i++) {
+        AIM_ASSERT(objs[i] == test_hashtable_first(table, keys[i]));
+        AIM_ASSERT((objs[i] != NULL) == !(i % 2));
+    }
+
+    /* Empty batch */
+    test_hashtable_lookup_batch(table, keys, objs, 0);
+
+    bighash_table_destroy(table, NULL);
+    aim_free(entries);
+}
+
+static void
+test_oa(void)
+{
+    const int count = 10000, dups = 100;
+    bighash_oa_table_t *table = bighash_oa_table_create(BIGHASH_AUTOGROW);
+    test_entry_t *entries = aim_zmalloc(sizeof(*entries) * (count + dups));
+    test_entry_t *te;
+    bighash_oa_iter_t iter;
+    uint32_t id;
+    int i, found;
+
+    for(i = 0; i < count + dups; i++) {
+        entries[i].id = i < count ? i : i - count;
+        test_oa_hashtable_insert(table, &entries[i]);
+        if(i < count && test_oa_hashtable_first(table, &entries[i].id) != &entries[i]) {
+            AIM_DIE("inserted entry was not found, count=%d", i);
+        }
+        AIM_ASSERT(bighash_oa_entry_count(table) == i+1);
+    }
+    AIM_ASSERT(table->rehash_count > 0);
+
+    /* Duplicate keys are all returned by first/next */
+    for(id = 0; id < dups; id++) {
+        found = 0;
+        for(te = test_oa_hashtable_first(table, &id); te;
+            te = test_oa_hashtable_next(te)) {
+            AIM_ASSERT(te == &entries[id] || te == &entries[count + id]);
+            found++;
+        }
+        AIM_ASSERT(found == 2);
+    }
+    id = count;
+    AIM_ASSERT(test_oa_hashtable_first(table, &id) == NULL);
+
+    /* Every entry is enumerated once, including while removing */
+    found = 0;
+    for(te = bighash_oa_iter_start(table, &iter); te; te = bighash_oa_iter_next(&iter)) {
+        te = container_of((bighash_entry_t *)te, hash_entry, test_entry_t);
+        AIM_ASSERT(te->found == 0);
+        te->found++;
+        found++;
+        if(te->id % 2) {
+            test_oa_hashtable_remove(table, te);
+        }
+    }
+    AIM_ASSERT(found == count + dups);
+    AIM_ASSERT(bighash_oa_entry_count(table) == (count + dups)/2);
+    for(i = 0; i < count; i++) {
+        te = test_oa_hashtable_first(table, &entries[i].id);
+        AIM_ASSERT((i % 2) ? te == NULL : te == &entries[i]);
+    }
+
+    /* Refill through deleted slots */
+    for(i = 1; i < count; i += 2) {
+        test_oa_hashtable_insert(table, &entries[i]);
+    }
+    for(i = 0; i < count; i++) {
+        AIM_ASSERT(test_oa_hashtable_first(table, &entries[i].id) == &entries[i]);
+    }
+
+    bighash_oa_table_destroy(table, NULL);
+    aim_free(entries);
+}
+
+/*
+ * Concurrent table stress test. Readers look up stable ids, which must
+ * be found once inserted, and churn ids, which a writer keeps inserting,
+ * removing and freeing. The writer poisons entries before freeing them.
+ */
+#define RCU_STABLE 50000
+#define RCU_CHURN 1000
+#define RCU_READERS 4
+#define RCU_POISON 0x5a5a5a5a
+
+typedef struct rcu_test_s {
+    bighash_rcu_table_t *table;
+    int stable_count;
+    int stop;
+    int errors;
+    uint64_t lookups;
+} rcu_test_t;
+
+static test_entry_t *
+rcu_find__(bighash_rcu_table_t *table, uint32_t id)
+{
+    bighash_entry_t *e;
+    for (e = bighash_rcu_first(table, hash_id(id)); e; e = bighash_rcu_next(table, e)) {
+        test_entry_t *te = container_of(e, hash_entry, test_entry_t);
+        if (te->id == id) {
+            return te;
+        }
+    }
+    return NULL;
+}
+
+static void *
+rcu_reader__(void *arg)
+{
+    rcu_test_t *t = arg;
+    bighash_rcu_reader_t reader;
+    uint64_t lookups = 0;
+    uint32_t r = (uintptr_t)&reader;
+
+    bighash_rcu_reader_register(t->table, &reader);
+    while (!__atomic_load_n(&t->stop, __ATOMIC_ACQUIRE)) {
+        int stable_count = __atomic_load_n(&t->stable_count, __ATOMIC_ACQUIRE);
+        uint32_t id;
+        test_entry_t *te;
+
+        r = r * 1103515245 + 12345;
+        id = (r >> 8) % (RCU_STABLE + RCU_CHURN);
+
+        bighash_rcu_read_lock(t->table, &reader);
+        te = rcu_find__(t->table, id);
+        if (id < RCU_STABLE) {
+            if (id < stable_count && te == NULL) {
+                __atomic_add_fetch(&t->errors, 1, __ATOMIC_RELAXED);
+            }
+        }
+        else if (te && te->found == RCU_POISON) {
+            __atomic_add_fetch(&t->errors, 1, __ATOMIC_RELAXED);
+        }
+        bighash_rcu_read_unlock(t->table, &reader);
+        lookups++;
+    }
+    bighash_rcu_reader_unregister(t->table, &reader);
+
+    __atomic_add_fetch(&t->lookups, lookups, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+static void
+rcu_free_entry__(bighash_entry_t *e)
+{
+    test_entry_t *te = container_of(e, hash_entry, test_entry_t);
+    te->found = RCU_POISON;
+    aim_free(te);
+}
+
+static void
+test_rcu(void)
+{
+    rcu_test_t t = { 0 };
+    test_entry_t *churn[RCU_CHURN] = { 0 };
+    test_entry_t *removed[RCU_CHURN];
+    pthread_t threads[RCU_READERS];
+    int i, round;
+
+    t.table = bighash_rcu_table_create(BIGHASH_AUTOGROW);
+    for(i = 0; i < RCU_READERS; i++) {
+        AIM_ASSERT(pthread_create(&threads[i], NULL, rcu_reader__, &t) == 0);
+    }
+
+    /* Grow repeatedly under the readers */
+    for(i = 0; i < RCU_STABLE; i++) {
+        test_entry_t *te = aim_zmalloc(sizeof(*te));
+        te->id = i;
+        bighash_rcu_insert(t.table, &te->hash_entry, hash_id(te->id));
+        __atomic_store_n(&t.stable_count, i + 1, __ATOMIC_RELEASE);
+    }
+    AIM_ASSERT(t.table->grow_count > 10);
+
+    /* Replace churn entries, freeing the old ones after a grace period */
+    for(round = 0; round < 20; round++) {
+        for(i = 0; i < RCU_CHURN; i++) {
+            test_entry_t *te = aim_zmalloc(sizeof(*te));
+            te->id = RCU_STABLE + i;
+            bighash_rcu_insert(t.table, &te->hash_entry, hash_id(te->id));
+            if(churn[i]) {
+                bighash_rcu_remove(t.table, &churn[i]->hash_entry);
+            }
+            removed[i] = churn[i];
+            churn[i] = te;
+        }
+        bighash_rcu_synchronize(t.table);
+        for(i = 0; i < RCU_CHURN; i++) {
+            if(removed[i]) {
+                rcu_free_entry__(&removed[i]->hash_entry);
+            }
+        }
+    }
+
+    /* Remove and free, a grace period each for the first few */
+    for(i = 0; i < RCU_CHURN; i++) {
+        bighash_rcu_remove(t.table, &churn[i]->hash_entry);
+        if(i < 50) {
+            bighash_rcu_synchronize(t.table);
+            rcu_free_entry__(&churn[i]->hash_entry);
+        }
+    }
+    bighash_rcu_synchronize(t.table);
+    for(i = 50; i < RCU_CHURN; i++) {
+        rcu_free_entry__(&churn[i]->hash_entry);
+    }
+
+    __atomic_store_n(&t.stop, 1, __ATOMIC_RELEASE);
+    for(i = 0; i < RCU_READERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    if(t.errors) {
+        AIM_DIE("%d concurrent lookup errors", t.errors);
+    }
+    AIM_ASSERT(t.lookups > 0);
+    AIM_ASSERT(t.table->grow_count > 0);
+    AIM_ASSERT(bighash_rcu_entry_count(t.table) == RCU_STABLE);
+    AIM_ASSERT(rcu_find__(t.table, RCU_STABLE) == NULL);
+    for(i = 0; i < RCU_STABLE; i++) {
+        AIM_ASSERT(rcu_find__(t.table, i) != NULL);
+    }
+
+    bighash_rcu_table_destroy(t.table, rcu_free_entry__);
+}
+
+/*
+ * Sharded table. Writer threads each insert and remove their own range
+ * of ids, so every shard sees concurrent writers.
+ */
+#define SHARDED_THREADS 4
+#define SHARDED_PER_THREAD 5000
+
+typedef struct sharded_worker_s {
+    bighash_sharded_table_t *table;
+    test_entry_t *entries;
+    int count;
+    int rounds;
+    /* Inserts, finds and removes done */
+    uint64_t ops;
+} sharded_worker_t;
+
+static test_entry_t *
+sharded_find__(bighash_sharded_table_t *table, uint32_t id)
+{
+    bighash_entry_t *e;
+    for (e = bighash_sharded_first(table, hash_id(id)); e; e = bighash_next(e)) {
+        test_entry_t *te = container_of(e, hash_entry, test_entry_t);
+        if (te->id == id) {
+            return te;
+        }
+    }
+    return NULL;
+}
+
+/* Insert all entries, look each up, then remove the odd ones */
+static void *
+sharded_worker__(void *arg)
+{
+    sharded_worker_t *w = arg;
+    int i, round;
+
+    for(round = 0; round < w->rounds; round++) {
+        for(i = 0; i < w->count; i++) {
+            test_entry_t *te = &w->entries[i];
+            bighash_sharded_insert(w->table, &te->hash_entry, hash_id(te->id));
+        }
+        for(i = 0; i < w->count; i++) {
+            uint32_t hash = hash_id(w->entries[i].id);
+            bighash_sharded_lock(w->table, hash);
+            AIM_ASSERT(sharded_find__(w->table, w->entries[i].id) == &w->entries[i]);
+            bighash_sharded_unlock(w->table, hash);
+        }
+        for(i = round < w->rounds - 1 ? 0 : 1; i < w->count; i += round < w->rounds - 1 ? 1 : 2) {
+            bighash_sharded_remove(w->table, &w->entries[i].hash_entry);
+            w->ops++;
+        }
+        w->ops += 2 * w->count;
+    }
+
+    return NULL;
+}
+
+static void
+test_sharded(void)
+{
+    bighash_sharded_table_t *table = bighash_sharded_table_create(6, BIGHASH_AUTOGROW);
+    test_entry_t *entries = aim_zmalloc(sizeof(*entries) * SHARDED_THREADS * SHARDED_PER_THREAD);
+    sharded_worker_t workers[SHARDED_THREADS];
+    pthread_t threads[SHARDED_THREADS];
+    bighash_sharded_iter_t iter;
+    bighash_entry_t *e;
+    test_entry_t *te;
+    int i, count, grown = 0;
+
+    AIM_ASSERT(table->shard_count == 8);
+
+    for(i = 0; i < SHARDED_THREADS * SHARDED_PER_THREAD; i++) {
+        entries[i].id = i;
+    }
+    for(i = 0; i < SHARDED_THREADS; i++) {
+        workers[i].ops = 0;
+        workers[i].table = table;
+        workers[i].entries = &entries[i * SHARDED_PER_THREAD];
+        workers[i].count = SHARDED_PER_THREAD;
+        workers[i].rounds = 3;
+        AIM_ASSERT(pthread_create(&threads[i], NULL, sharded_worker__, &workers[i]) == 0);
+    }
+    for(i = 0; i < SHARDED_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    /* Even ids are left, spread over every shard */
+    AIM_ASSERT(bighash_sharded_entry_count(table) == SHARDED_THREADS * SHARDED_PER_THREAD / 2);
+    for(i = 0; i < table->shard_count; i++) {
+        AIM_ASSERT(bighash_entry_count(table->shards[i].table) > 0);
+        grown += table->shards[i].table->bucket_count > BIGHASH_CONFIG_INITIAL_HASH_BUCKETS_SIZE;
+    }
+    AIM_ASSERT(grown == table->shard_count);
+
+    /* Iteration sees every entry once */
+    count = 0;
+    for(te = bighash_sharded_iter_start(table, &iter); te;
+        te = bighash_sharded_iter_next(&iter)) {
+        te = container_of((bighash_entry_t *)te, hash_entry, test_entry_t);
+        AIM_ASSERT(te->id % 2 == 0);
+        AIM_ASSERT(te->found++ == 0);
+        count++;
+    }
+    AIM_ASSERT(count == SHARDED_THREADS * SHARDED_PER_THREAD / 2);
+    AIM_ASSERT(bighash_sharded_iter_next(&iter) == NULL);
+
+    /* Stopping early releases the shard lock */
+    te = bighash_sharded_iter_start(table, &iter);
+    AIM_ASSERT(te != NULL);
+    bighash_sharded_iter_stop(&iter);
+    bighash_sharded_insert(table, &entries[1].hash_entry, hash_id(entries[1].id));
+    bighash_sharded_remove(table, &entries[1].hash_entry);
+
+    /* Removal while iterating */
+    for(e = bighash_sharded_iter_start(table, &iter); e;
+        e = bighash_sharded_iter_next(&iter)) {
+        bighash_remove(bighash_sharded_shard(table, e->hash), e);
+    }
+    AIM_ASSERT(bighash_sharded_entry_count(table) == 0);
+
+    bighash_sharded_table_destroy(table, NULL);
+    aim_free(entries);
+}
+
+/*
+ * Compare the chained and open addressing tables on inserts, hits and
+ * misses. Lookups use a random order so each one is a cache miss once
+ * the table is larger than the cache.
+ */
+static void
+perftest(int count)
+{
+    test_entry_t *entries = aim_zmalloc(sizeof(*entries) * count);
+    uint32_t *order = aim_malloc(sizeof(*order) * count);
+    bighash_table_t *chained = bighash_table_create(BIGHASH_AUTOGROW);
+    bighash_oa_table_t *oa = bighash_oa_table_create(BIGHASH_AUTOGROW);
+    uint64_t start, insert_us[2], hit_us[2], miss_us[2], batch_us;
+    const uint32_t *keys[BIGHASH_BATCH_SIZE];
+    test_entry_t *objs[BIGHASH_BATCH_SIZE];
+    uint32_t key;
+    int i, hits = 0;
+
+    for(i = 0; i < count; i++) {
+        entries[i].id = i;
+        order[i] = i;
+    }
+    for(i = count - 1; i > 0; i--) {
+        int j = random() % (i + 1);
+        uint32_t tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+
+    start = os_time_monotonic();
+    for(i = 0; i < count; i++) {
+        test_hashtable_insert(chained, &entries[order[i]]);
+    }
+    insert_us[0] = os_time_monotonic() - start;
+
+    start = os_time_monotonic();
+    for(i = 0; i < count; i++) {
+        hits += test_hashtable_first(chained, &order[i]) != NULL;
+    }
+    hit_us[0] = os_time_monotonic() - start;
+
+    start = os_time_monotonic();
+    for(i = 0; i < count; i++) {
+        key = order[i] + count;
+        hits += test_hashtable_first(chained, &key) != NULL;
+    }
+    miss_us[0] = os_time_monotonic() - start;
+
+    start = os_time_monotonic();
+    for(i = 0; i < count; i += BIGHASH_BATCH_SIZE) {
+        int j, n = count - i < BIGHASH_BATCH_SIZE ? count - i : BIGHASH_BATCH_SIZE;
+        for(j = 0; j < n; j++) {
+            keys[j] = &order[i + j];
+        }
+        test_hashtable_lookup_batch(chained, keys, objs, n);
+        for(j = 0; j < n; j++) {
+            hits += objs[j] != NULL;
+        }
+    }
+    batch_us = os_time_monotonic() - start;
+
+    start = os_time_monotonic();
+    for(i = 0; i < count; i++) {
+        test_oa_hashtable_insert(oa, &entries[order[i]]);
+    }
+    insert_us[1] = os_time_monotonic() - start;
+
+    start = os_time_monotonic();
+    for(i = 0; i < count; i++) {
+        hits += test_oa_hashtable_first(oa, &order[i]) != NULL;
+    }
+    hit_us[1] = os_time_monotonic() - start;
+
+    start = os_time_monotonic();
+    for(i = 0; i < count; i++) {
+        key = order[i] + count;
+        hits += test_oa_hashtable_first(oa, &key) != NULL;
+    }
+    miss_us[1] = os_time_monotonic() - start;
+
+    AIM_ASSERT(hits == count*3);
+
+    aim_printf(&aim_pvs_stdout, "%d entries (ns/op)  insert    hit   miss\n", count);
+    for(i = 0; i < 2; i++) {
+        aim_printf(&aim_pvs_stdout, "  %-18s %6.1f %6.1f %6.1f\n",
+                   i ? "open addressing" : "chained",
+                   insert_us[i]*1000.0/count, hit_us[i]*1000.0/count,
+                   miss_us[i]*1000.0/count);
+    }
+    aim_printf(&aim_pvs_stdout, "  %-18s %6s %6.1f\n", "chained batch", "",
+               batch_us*1000.0/count);
+
+    bighash_table_destroy(chained, NULL);
+    bighash_oa_table_destroy(oa, NULL);
+    aim_free(order);
+    aim_free(entries);
+}
+
+/*
+ * Reader scaling, lock-free readers against a mutex around a plain
+ * table. A writer replaces one entry every millisecond in both cases.
+ */
+typedef struct rcu_perf_s {
+    bighash_rcu_table_t *rcu;
+    bighash_table_t *plain;
+    pthread_mutex_t mutex;
+    int count;
+    int stop;
+    uint64_t lookups;
+} rcu_perf_t;
+
+static void *
+rcu_perf_reader__(void *arg)
+{
+    rcu_perf_t *p = arg;
+    bighash_rcu_reader_t reader;
+    uint64_t lookups = 0;
+    uint32_t r = (uintptr_t)&reader;
+
+    if(p->rcu) {
+        bighash_rcu_reader_register(p->rcu, &reader);
+    }
+    while(!__atomic_load_n(&p->stop, __ATOMIC_RELAXED)) {
+        uint32_t id;
+        r = r * 1103515245 + 12345;
+        id = (r >> 8) % p->count;
+        if(p->rcu) {
+            bighash_rcu_read_lock(p->rcu, &reader);
+            rcu_find__(p->rcu, id);
+            bighash_rcu_read_unlock(p->rcu, &reader);
+        }
+        else {
+            pthread_mutex_lock(&p->mutex);
+            find_by_id(p->plain, id);
+            pthread_mutex_unlock(&p->mutex);
+        }
+        lookups++;
+    }
+    if(p->rcu) {
+        bighash_rcu_reader_unregister(p->rcu, &reader);
+    }
+
+    __atomic_add_fetch(&p->lookups, lookups, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+static double
+rcu_perf_run__(rcu_perf_t *p, test_entry_t *entries, int nthreads)
+{
+    pthread_t threads[16];
+    uint64_t start, elapsed;
+    int i, j;
+
+    p->stop = 0;
+    p->lookups = 0;
+    for(i = 0; i < nthreads; i++) {
+        AIM_ASSERT(pthread_create(&threads[i], NULL, rcu_perf_reader__, p) == 0);
+    }
+
+    start = os_time_monotonic();
+    for(j = 0; j < 200; j++) {
+        test_entry_t *te = &entries[j % p->count];
+        usleep(1000);
+        if(p->rcu) {
+            bighash_rcu_remove(p->rcu, &te->hash_entry);
+            bighash_rcu_synchronize(p->rcu);
+            bighash_rcu_insert(p->rcu, &te->hash_entry, hash_id(te->id));
+        }
+        else {
+            pthread_mutex_lock(&p->mutex);
+            bighash_remove(p->plain, &te->hash_entry);
+            bighash_insert(p->plain, &te->hash_entry, hash_id(te->id));
+            pthread_mutex_unlock(&p->mutex);
+        }
+    }
+    __atomic_store_n(&p->stop, 1, __ATOMIC_RELAXED);
+    for(i = 0; i < nthreads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    elapsed = os_time_monotonic() - start;
+
+    return (double)p->lookups/elapsed;
+}
+
+static void
+perftest_rcu(int count)
+{
+    rcu_perf_t p = { 0 };
+    test_entry_t *entries = aim_zmalloc(sizeof(*entries) * count);
+    int i, nthreads;
+
+    pthread_mutex_init(&p.mutex, NULL);
+    p.count = count;
+
+    aim_printf(&aim_pvs_stdout, "%d entries (Mlookups/s)  mutex    rcu\n", count);
+    for(nthreads = 1; nthreads <= 16; nthreads *= 2) {
+        double rate[2];
+
+        p.plain = bighash_table_create(BIGHASH_AUTOGROW);
+        for(i = 0; i < count; i++) {
+            entries[i].id = i;
+            bighash_insert(p.plain, &entries[i].hash_entry, hash_id(i));
+        }
+        rate[0] = rcu_perf_run__(&p, entries, nthreads);
+        bighash_table_destroy(p.plain, NULL);
+        p.plain = NULL;
+
+        p.rcu = bighash_rcu_table_create(BIGHASH_AUTOGROW);
+        for(i = 0; i < count; i++) {
+            bighash_rcu_insert(p.rcu, &entries[i].hash_entry, hash_id(i));
+        }
+        rate[1] = rcu_perf_run__(&p, entries, nthreads);
+        bighash_rcu_table_destroy(p.rcu, NULL);
+        p.rcu = NULL;
+
+        aim_printf(&aim_pvs_stdout, "  %2d readers %18.2f %6.2f\n",
+                   nthreads, rate[0], rate[1]);
+    }
+
+    pthread_mutex_destroy(&p.mutex);
+    aim_free(entries);
+}
+
+/*
+ * Write throughput of a sharded table against a single locked table,
+ * with each thread inserting, finding and removing its own entries.
+ */
+static double
+perftest_sharded_run__(int shard_count, int nthreads, test_entry_t *entries, int per_thread)
+{
+    bighash_sharded_table_t *table = bighash_sharded_table_create(shard_count, BIGHASH_AUTOGROW);
+    sharded_worker_t workers[16];
+    pthread_t threads[16];
+    uint64_t start, elapsed, ops = 0;
+    int i;
+
+    start = os_time_monotonic();
+    for(i = 0; i < nthreads; i++) {
+        workers[i].ops = 0;
+        workers[i].table = table;
+        workers[i].entries = &entries[i * per_thread];
+        workers[i].count = per_thread;
+        workers[i].rounds = 4;
+        AIM_ASSERT(pthread_create(&threads[i], NULL, sharded_worker__, &workers[i]) == 0);
+    }
+    for(i = 0; i < nthreads; i++) {
+        pthread_join(threads[i], NULL);
+        ops += workers[i].ops;
+    }
+    elapsed = os_time_monotonic() - start;
+
+    bighash_sharded_table_destroy(table, NULL);
+
+    return (double)ops/elapsed;
+}
+
+static void
+perftest_sharded(int per_thread)
+{
+    test_entry_t *entries = aim_zmalloc(sizeof(*entries) * per_thread * 16);
+    int i, nthreads;
+
+    for(i = 0; i < per_thread * 16; i++) {
+        entries[i].id = i;
+    }
+
+    aim_printf(&aim_pvs_stdout, "%d entries/thread (Mops/s)  1 shard  64 shards\n", per_thread);
+    for(nthreads = 1; nthreads <= 16; nthreads *= 2) {
+        double single = perftest_sharded_run__(1, nthreads, entries, per_thread);
+        double sharded = perftest_sharded_run__(64, nthreads, entries, per_thread);
+        aim_printf(&aim_pvs_stdout, "  %2d threads %20.2f %10.2f\n",
+                   nthreads, single, sharded);
+    }
+
+    aim_free(entries);
+}
+
+/*
+ * Moving all entries into an empty autogrow table, one remove and
+ * insert at a time against bighash_entries_move.
+ */
+static void
+perftest_move(int count)
+{
+    test_entry_t *entries = aim_zmalloc(sizeof(*entries) * count);
+    bighash_table_t *tables[3];
+    bighash_iter_t iter;
+    bighash_entry_t *e;
+    uint64_t start, single_us, bulk_us;
+    int i;
+
+    for(i = 0; i < 3; i++) {
+        tables[i] = bighash_table_create(BIGHASH_AUTOGROW);
+    }
+    for(i = 0; i < count; i++) {
+        entries[i].id = i;
+        bighash_insert(tables[0], &entries[i].hash_entry, hash_id(i));
+    }
+
+    start = os_time_monotonic();
+    for(e = bighash_iter_start(tables[0], &iter); e; e = bighash_iter_next(&iter)) {
+        bighash_remove(tables[0], e);
+        bighash_insert(tables[1], e, e->hash);
+    }
+    single_us = os_time_monotonic() - start;
+
+    start = os_time_monotonic();
+    bighash_entries_move(tables[2], tables[1]);
+    bulk_us = os_time_monotonic() - start;
+    AIM_ASSERT(bighash_entry_count(tables[2]) == count);
+
+    aim_printf(&aim_pvs_stdout, "%d entries move (ms)  per entry %8.2f  bulk %8.2f\n",
+               count, single_us/1000.0, bulk_us/1000.0);
+
+    for(i = 0; i < 3; i++) {
+        bighash_table_destroy(tables[i], NULL);
+    }
+    aim_free(entries);
+}
+
 int main(int argc, char *argv[])
 {
+    if(argc > 1 && !strcmp(argv[1], "perf")) {
+        int count;
+        for(count = 1000; count <= 4*1000*1000; count *= 4) {
+            perftest(count);
+        }
+        perftest_rcu(100000);
+        perftest_sharded(20000);
+        perftest_move(500000);
+        return 0;
+    }
+
     biglist_t *entries = NULL;
 
     /** Basic Hashing -- statically allocated table */
@@ -310,9 +1451,21 @@ int main(int argc, char *argv[])
     bighash_table_destroy(&static_table, free_test_entry);
 
     test_template();
+    test_key_hooks();
 
     test_autogrow();
 
+    test_incremental();
+
+    test_autoshrink();
+    test_entries_move();
+    test_lookup_batch();
+    test_stats();
+
+    test_oa();
+    test_rcu();
+    test_sharded();
+
     return 0;
 }
 
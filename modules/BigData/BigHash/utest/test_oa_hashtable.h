@@ -0,0 +1,28 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+#ifndef TEST_OA_HASHTABLE_H
+#define TEST_OA_HASHTABLE_H
+
+#define TEMPLATE_NAME test_oa_hashtable
+#define TEMPLATE_OBJ_TYPE test_entry_t
+#define TEMPLATE_KEY_FIELD id
+#define TEMPLATE_ENTRY_FIELD hash_entry
+#include <BigHash/bighash_oa_template.h>
+
+#endif
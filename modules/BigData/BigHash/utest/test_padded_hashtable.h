@@ -0,0 +1,54 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+#ifndef TEST_PADDED_HASHTABLE_H
+#define TEST_PADDED_HASHTABLE_H
+
+/* Key with padding after 'proto', so it needs its own hash and compare */
+typedef struct test_padded_key_s {
+    uint8_t proto;
+    uint32_t addr;
+} test_padded_key_t;
+
+typedef struct test_padded_entry_s {
+    test_padded_key_t key;
+    bighash_entry_t hash_entry;
+} test_padded_entry_t;
+
+static inline uint32_t
+test_padded_key_hash(const test_padded_key_t *key, uint32_t seed)
+{
+    return murmur_finish(murmur_round(murmur_round(seed, key->proto), key->addr), 8);
+}
+
+static inline int
+test_padded_key_equal(const test_padded_key_t *a, const test_padded_key_t *b)
+{
+    return a->proto == b->proto && a->addr == b->addr;
+}
+
+#define TEMPLATE_NAME test_padded_hashtable
+#define TEMPLATE_OBJ_TYPE test_padded_entry_t
+#define TEMPLATE_KEY_FIELD key
+#define TEMPLATE_ENTRY_FIELD hash_entry
+#define TEMPLATE_HASH_FUNC test_padded_key_hash
+#define TEMPLATE_EQUAL_FUNC test_padded_key_equal
+#define TEMPLATE_HASH_SEED 42
+#include <BigHash/bighash_template.h>
+
+#endif
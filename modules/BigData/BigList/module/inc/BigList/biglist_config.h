@@ -115,6 +115,36 @@
 #define BIGLIST_CONFIG_INCLUDE_LOCKED 1
 #endif
 
+/**
+ * BIGLIST_CONFIG_NODE_POOL
+ *
+ * Allocate list elements from a pool with per-thread free lists instead of the heap. */
+
+
+#ifndef BIGLIST_CONFIG_NODE_POOL
+#define BIGLIST_CONFIG_NODE_POOL 0
+#endif
+
+/**
+ * BIGLIST_CONFIG_NODE_POOL_BATCH
+ *
+ * Elements moved between a thread's free list and the shared pool at a time. */
+
+
+#ifndef BIGLIST_CONFIG_NODE_POOL_BATCH
+#define BIGLIST_CONFIG_NODE_POOL_BATCH 64
+#endif
+
+/**
+ * BIGLIST_CONFIG_NODE_POOL_THREAD_MAX
+ *
+ * Free elements a thread keeps before returning a batch to the shared pool. */
+
+
+#ifndef BIGLIST_CONFIG_NODE_POOL_THREAD_MAX
+#define BIGLIST_CONFIG_NODE_POOL_THREAD_MAX 256
+#endif
+
 
 
 /**
@@ -0,0 +1,211 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ****************************************************************/
+
+/*************************************************************//**
+ *
+ * module/inc/biglist_mpsc.h
+ *
+ * @file
+ * @brief Lock-free Multi Producer, Single Consumer Queue
+ *
+ * An intrusive FIFO: callers embed a biglist_mpsc_node_t in their own
+ * objects, so pushing allocates nothing. Any number of threads may push
+ * concurrently with a single atomic exchange each. Only one thread may
+ * pop at a time; use a lock if several threads consume.
+ *
+ * A pop can briefly see the queue as empty while a push that has
+ * already swapped the head is linking its node; the node becomes
+ * visible as soon as that push returns.
+ *
+ * With BIGLIST_CONFIG_INCLUDE_LOCKED the consumer can block in
+ * biglist_mpsc_wait. Producers only post the semaphore when the
+ * consumer is asleep, so they never contend on a lock.
+ *
+ * @addtogroup biglist-locked
+ * @{
+ *
+ ****************************************************************/
+
+#ifndef __BIGLIST_MPSC_H__
+#define __BIGLIST_MPSC_H__
+
+#include <BigList/biglist_config.h>
+#include <AIM/aim.h>
+
+#if BIGLIST_CONFIG_INCLUDE_LOCKED == 1
+#include <OS/os_sem.h>
+#endif
+
+/**
+ * Queue link, embedded in the queued object.
+ */
+typedef struct biglist_mpsc_node_s {
+    /** Next (newer) node */
+    struct biglist_mpsc_node_s* next;
+} biglist_mpsc_node_t;
+
+/**
+ * Queue head. Must not be moved or copied after biglist_mpsc_init.
+ *
+ * Padding on both sides of head keeps it on a cache line of its own,
+ * away from the consumer's fields and whatever the queue is embedded
+ * in, without requiring an aligned allocation.
+ */
+typedef struct biglist_mpsc_s {
+    char pad0[64 - sizeof(biglist_mpsc_node_t*)];
+    /** Newest node, swapped by producers */
+    biglist_mpsc_node_t* head;
+    char pad1[64 - sizeof(biglist_mpsc_node_t*)];
+    /** Oldest node. Only the consumer writes it. */
+    biglist_mpsc_node_t* tail;
+    /** Placeholder that keeps the list non-empty */
+    biglist_mpsc_node_t stub;
+#if BIGLIST_CONFIG_INCLUDE_LOCKED == 1
+    /** Set while the consumer sleeps on available */
+    int waiting;
+    /** Posted by the producer that clears waiting */
+    os_sem_t available;
+#endif
+} biglist_mpsc_t;
+
+/**
+ * @brief Initialize a queue.
+ * @param q The queue.
+ */
+void biglist_mpsc_init(biglist_mpsc_t* q);
+
+/**
+ * @brief Release a queue's resources.
+ * @param q The queue.
+ * @note Nodes still in the queue are not touched.
+ */
+void biglist_mpsc_destroy(biglist_mpsc_t* q);
+
+#if BIGLIST_CONFIG_INCLUDE_LOCKED == 1
+/* Wake the consumer after a push. Only called when it is waiting. */
+void biglist_mpsc_wake__(biglist_mpsc_t* q);
+#endif
+
+/**
+ * @brief Add a node to the queue. Any thread.
+ * @param q The queue.
+ * @param node The node.
+ */
+static inline void
+biglist_mpsc_push(biglist_mpsc_t* q, biglist_mpsc_node_t* node)
+{
+    biglist_mpsc_node_t* prev;
+
+    node->next = NULL;
+    prev = __atomic_exchange_n(&q->head, node, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+
+#if BIGLIST_CONFIG_INCLUDE_LOCKED == 1
+    /* The exchange above orders the push before this load */
+    if(__atomic_load_n(&q->waiting, __ATOMIC_SEQ_CST)) {
+        biglist_mpsc_wake__(q);
+    }
+#endif
+}
+
+/**
+ * @brief Remove the oldest node. Consumer only.
+ * @param q The queue.
+ * @returns The node, or NULL if the queue is empty.
+ */
+static inline biglist_mpsc_node_t*
+biglist_mpsc_pop(biglist_mpsc_t* q)
+{
+    biglist_mpsc_node_t* tail = q->tail;
+    biglist_mpsc_node_t* next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+
+    if(tail == &q->stub) {
+        if(next == NULL) {
+            return NULL;
+        }
+        __atomic_store_n(&q->tail, next, __ATOMIC_RELAXED);
+        tail = next;
+        next = __atomic_load_n(&next->next, __ATOMIC_ACQUIRE);
+    }
+
+    if(next) {
+        __atomic_store_n(&q->tail, next, __ATOMIC_RELAXED);
+        return tail;
+    }
+
+    /* tail is the newest node unless a push is half way done */
+    if(tail != __atomic_load_n(&q->head, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+
+    /* Put the stub behind it so it can be unlinked */
+    biglist_mpsc_push(q, &q->stub);
+    next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if(next) {
+        __atomic_store_n(&q->tail, next, __ATOMIC_RELAXED);
+        return tail;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Remove up to max of the oldest nodes. Consumer only.
+ * @param q The queue.
+ * @param nodes Receives the nodes, oldest first.
+ * @param max The maximum number of nodes.
+ * @returns The number of nodes removed.
+ */
+static inline int
+biglist_mpsc_pop_n(biglist_mpsc_t* q, biglist_mpsc_node_t** nodes, int max)
+{
+    int n = 0;
+    while(n < max && (nodes[n] = biglist_mpsc_pop(q)) != NULL) {
+        n++;
+    }
+    return n;
+}
+
+/**
+ * @brief Check whether the queue is empty.
+ * @param q The queue.
+ * @returns Non-zero if no push has completed or is in progress.
+ * @note Exact in the consumer. Other threads may call it too, but the
+ * consumer can pop concurrently, so for them the result is only a hint.
+ */
+static inline int
+biglist_mpsc_empty(biglist_mpsc_t* q)
+{
+    return __atomic_load_n(&q->tail, __ATOMIC_RELAXED) == &q->stub &&
+        __atomic_load_n(&q->head, __ATOMIC_SEQ_CST) == &q->stub;
+}
+
+#if BIGLIST_CONFIG_INCLUDE_LOCKED == 1
+/**
+ * @brief Wait until the queue is not empty. Consumer only.
+ * @param q The queue.
+ * @param usecs Timeout in usecs, or 0 to wait forever.
+ * @returns 0 if the queue is not empty, -1 on timeout.
+ * @note biglist_mpsc_pop can still return NULL for a moment after this
+ * returns, while the waking push finishes linking its node.
+ */
+int biglist_mpsc_wait(biglist_mpsc_t* q, uint64_t usecs);
+#endif
+
+#endif /* __BIGLIST_MPSC_H__ */
+/* @} */
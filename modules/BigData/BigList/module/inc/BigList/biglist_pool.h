@@ -0,0 +1,81 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ****************************************************************/
+/*************************************************************//**
+ *
+ * module/inc/biglist_pool.h
+ *
+ * @file
+ * @brief List Element Pool Statistics
+ *
+ * With BIGLIST_CONFIG_NODE_POOL, list elements come from a process
+ * wide pool instead of the heap. Each thread keeps its own free list
+ * and exchanges batches of BIGLIST_CONFIG_NODE_POOL_BATCH elements with
+ * a shared pool when it runs dry or holds more than
+ * BIGLIST_CONFIG_NODE_POOL_THREAD_MAX. Elements are carved from the
+ * heap a batch at a time and are never returned to it.
+ *
+ * @addtogroup biglist-biglist
+ * @{
+ *
+ ****************************************************************/
+
+#ifndef __BIGLIST_POOL_H__
+#define __BIGLIST_POOL_H__
+
+#include <BigList/biglist_config.h>
+
+#if BIGLIST_CONFIG_NODE_POOL == 1
+
+#include <AIM/aim.h>
+
+/**
+ * Pool statistics, summed over all threads.
+ */
+typedef struct biglist_pool_stats_s {
+    /** Elements allocated */
+    uint64_t allocs;
+    /** Allocations served from the thread's own free list */
+    uint64_t hits;
+    /** Batches taken from the shared pool */
+    uint64_t refills;
+    /** Batches returned to the shared pool */
+    uint64_t flushes;
+    /** Batches carved from the heap */
+    uint64_t slabs;
+    /** Elements freed */
+    uint64_t frees;
+} biglist_pool_stats_t;
+
+/**
+ * @brief Get the pool statistics.
+ * @param stats Receives the statistics.
+ * @note Counters of running threads are read without stopping them.
+ */
+void biglist_pool_stats_get(biglist_pool_stats_t* stats);
+
+/**
+ * @brief Show the pool statistics, including the hit rate.
+ * @param pvs The output pvs.
+ */
+void biglist_pool_stats_show(aim_pvs_t* pvs);
+
+#endif /* BIGLIST_CONFIG_NODE_POOL */
+
+#endif /* __BIGLIST_POOL_H__ */
+/* @} */
@@ -22,7 +22,7 @@
 biglist_t*
 biglist_alloc(void* data, biglist_t* p, biglist_t* n)
 {
-    biglist_t* ble = aim_malloc(sizeof(*ble));
+    biglist_t* ble = biglist_node_alloc__();
     if(ble) {
         ble->previous = p;
         ble->next = n;
@@ -64,6 +64,21 @@ biglist_config_settings_t biglist_config_settings[] =
     { __biglist_config_STRINGIFY_NAME(BIGLIST_CONFIG_INCLUDE_LOCKED), __biglist_config_STRINGIFY_VALUE(BIGLIST_CONFIG_INCLUDE_LOCKED) },
 #else
 { BIGLIST_CONFIG_INCLUDE_LOCKED(__biglist_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef BIGLIST_CONFIG_NODE_POOL
+    { __biglist_config_STRINGIFY_NAME(BIGLIST_CONFIG_NODE_POOL), __biglist_config_STRINGIFY_VALUE(BIGLIST_CONFIG_NODE_POOL) },
+#else
+{ BIGLIST_CONFIG_NODE_POOL(__biglist_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef BIGLIST_CONFIG_NODE_POOL_BATCH
+    { __biglist_config_STRINGIFY_NAME(BIGLIST_CONFIG_NODE_POOL_BATCH), __biglist_config_STRINGIFY_VALUE(BIGLIST_CONFIG_NODE_POOL_BATCH) },
+#else
+{ BIGLIST_CONFIG_NODE_POOL_BATCH(__biglist_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef BIGLIST_CONFIG_NODE_POOL_THREAD_MAX
+    { __biglist_config_STRINGIFY_NAME(BIGLIST_CONFIG_NODE_POOL_THREAD_MAX), __biglist_config_STRINGIFY_VALUE(BIGLIST_CONFIG_NODE_POOL_THREAD_MAX) },
+#else
+{ BIGLIST_CONFIG_NODE_POOL_THREAD_MAX(__biglist_config_STRINGIFY_NAME), "__undefined__" },
 #endif
     { NULL, NULL }
 };
@@ -32,7 +32,7 @@ biglist_free_all(biglist_t* bl, void (*free_function)(void*))
             if(free_function) {
                 free_function(blfree->data);
             }
-            aim_free(blfree);
+            biglist_node_free__(blfree);
             count++;
         } while(bl);
     }
@@ -23,6 +23,19 @@
 #include <BigList/biglist_config.h>
 #include <BigList/biglist.h>
 #include <BigList/biglist_locked.h>
+#include <BigList/biglist_mpsc.h>
+
+/*
+ * Element allocation. These come from the pool in biglist_pool.c
+ * when BIGLIST_CONFIG_NODE_POOL is set, and from the heap otherwise.
+ */
+#if BIGLIST_CONFIG_NODE_POOL == 1
+biglist_t* biglist_node_alloc__(void);
+void biglist_node_free__(biglist_t* ble);
+#else
+#define biglist_node_alloc__() ((biglist_t*)aim_malloc(sizeof(biglist_t)))
+#define biglist_node_free__(_ble) aim_free(_ble)
+#endif
 
 
 #endif /* __BIGLIST_INT_H__ */
@@ -0,0 +1,73 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ****************************************************************/
+
+#include "biglist_int.h"
+
+#if BIGLIST_CONFIG_INCLUDE_LOCKED == 1
+
+#include <OS/os_time.h>
+
+void
+biglist_mpsc_wake__(biglist_mpsc_t* q)
+{
+    /* Only one of several racing producers posts */
+    if(__atomic_exchange_n(&q->waiting, 0, __ATOMIC_SEQ_CST)) {
+        os_sem_give(q->available);
+    }
+}
+
+int
+biglist_mpsc_wait(biglist_mpsc_t* q, uint64_t usecs)
+{
+    uint64_t deadline = usecs ? os_time_monotonic() + usecs : 0;
+    uint64_t remaining = 0;
+    int rv;
+
+    while(biglist_mpsc_empty(q)) {
+        /*
+         * Announce the wait, then look again. A producer swaps the head
+         * before it checks the flag, so either we see its node here or
+         * it sees the flag and posts. The fence keeps the recheck from
+         * being ordered before the store.
+         */
+        __atomic_store_n(&q->waiting, 1, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if(!biglist_mpsc_empty(q)) {
+            __atomic_store_n(&q->waiting, 0, __ATOMIC_RELAXED);
+            break;
+        }
+
+        if(deadline) {
+            uint64_t now = os_time_monotonic();
+            /* 0 would wait forever, so an expired deadline still polls */
+            remaining = now < deadline ? deadline - now : 1;
+        }
+        rv = os_sem_take_timeout(q->available, remaining);
+        __atomic_store_n(&q->waiting, 0, __ATOMIC_RELAXED);
+
+        if(rv < 0) {
+            return biglist_mpsc_empty(q) ? -1 : 0;
+        }
+        /* Posts left over from an earlier wait just loop around */
+    }
+
+    return 0;
+}
+
+#endif /* BIGLIST_CONFIG_INCLUDE_LOCKED */
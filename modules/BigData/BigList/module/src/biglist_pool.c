@@ -0,0 +1,267 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ****************************************************************/
+
+#include "biglist_int.h"
+
+#if BIGLIST_CONFIG_NODE_POOL == 1
+
+#include <BigList/biglist_pool.h>
+#include <pthread.h>
+
+/* A flush moves a whole batch, so a full cache must hold at least one */
+#if BIGLIST_CONFIG_NODE_POOL_THREAD_MAX < BIGLIST_CONFIG_NODE_POOL_BATCH
+#error "BIGLIST_CONFIG_NODE_POOL_THREAD_MAX must be at least BIGLIST_CONFIG_NODE_POOL_BATCH"
+#endif
+
+/*
+ * A thread's cache. The owner is the only writer of every field but
+ * 'next', which the registry lock protects.
+ */
+typedef struct biglist_pool_cache_s {
+    /** Free elements, linked through next */
+    biglist_t* free;
+    int count;
+    biglist_pool_stats_t stats;
+    struct biglist_pool_cache_s* next;
+} biglist_pool_cache_t;
+
+/*
+ * Shared pool of batches. A batch is a chain of free elements linked
+ * through next; its first element holds the chain length in data and
+ * the next batch in previous.
+ */
+static struct {
+    pthread_mutex_t lock;
+    biglist_t* batches;
+    /** Registered thread caches */
+    biglist_pool_cache_t* caches;
+    /** Counters of exited threads, and of the shared pool */
+    biglist_pool_stats_t stats;
+} pool__ = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static pthread_key_t pool_key__;
+static pthread_once_t pool_once__ = PTHREAD_ONCE_INIT;
+static __thread biglist_pool_cache_t* pool_cache__;
+
+/* Readers in other threads only want a recent value */
+#define STAT_INC(_c, _field)                                            \
+    __atomic_store_n(&(_c)->stats._field, (_c)->stats._field + 1, __ATOMIC_RELAXED)
+
+static void
+biglist_pool_stats_add__(biglist_pool_stats_t* dst, biglist_pool_stats_t* src)
+{
+    dst->allocs += __atomic_load_n(&src->allocs, __ATOMIC_RELAXED);
+    dst->hits += __atomic_load_n(&src->hits, __ATOMIC_RELAXED);
+    dst->refills += __atomic_load_n(&src->refills, __ATOMIC_RELAXED);
+    dst->flushes += __atomic_load_n(&src->flushes, __ATOMIC_RELAXED);
+    dst->slabs += __atomic_load_n(&src->slabs, __ATOMIC_RELAXED);
+    dst->frees += __atomic_load_n(&src->frees, __ATOMIC_RELAXED);
+}
+
+/* Push a chain of 'count' elements onto the shared pool. Called with the lock held. */
+static void
+biglist_pool_batch_put__(biglist_t* head, int count)
+{
+    head->data = (void*)(intptr_t)count;
+    head->previous = pool__.batches;
+    pool__.batches = head;
+}
+
+/* Return a thread's free list to the shared pool when the thread exits */
+static void
+biglist_pool_cache_destroy__(void* arg)
+{
+    biglist_pool_cache_t* cache = arg;
+    biglist_pool_cache_t** prev;
+
+    pthread_mutex_lock(&pool__.lock);
+    if(cache->free) {
+        biglist_pool_batch_put__(cache->free, cache->count);
+    }
+    for(prev = &pool__.caches; *prev; prev = &(*prev)->next) {
+        if(*prev == cache) {
+            *prev = cache->next;
+            break;
+        }
+    }
+    biglist_pool_stats_add__(&pool__.stats, &cache->stats);
+    pthread_mutex_unlock(&pool__.lock);
+
+    pool_cache__ = NULL;
+    aim_free(cache);
+}
+
+static void
+biglist_pool_key_create__(void)
+{
+    pthread_key_create(&pool_key__, biglist_pool_cache_destroy__);
+}
+
+static biglist_pool_cache_t*
+biglist_pool_cache__(void)
+{
+    biglist_pool_cache_t* cache = pool_cache__;
+
+    if(cache == NULL) {
+        pthread_once(&pool_once__, biglist_pool_key_create__);
+        cache = aim_zmalloc(sizeof(*cache));
+        if(cache == NULL) {
+            return NULL;
+        }
+        pthread_mutex_lock(&pool__.lock);
+        cache->next = pool__.caches;
+        pool__.caches = cache;
+        pthread_mutex_unlock(&pool__.lock);
+        pthread_setspecific(pool_key__, cache);
+        pool_cache__ = cache;
+    }
+    return cache;
+}
+
+/* Fill an empty free list from the shared pool, or from the heap */
+static int
+biglist_pool_refill__(biglist_pool_cache_t* cache)
+{
+    biglist_t* slab;
+    int i;
+
+    pthread_mutex_lock(&pool__.lock);
+    if(pool__.batches) {
+        biglist_t* head = pool__.batches;
+        pool__.batches = head->previous;
+        pthread_mutex_unlock(&pool__.lock);
+
+        cache->free = head;
+        cache->count = (intptr_t)head->data;
+        STAT_INC(cache, refills);
+        return 0;
+    }
+    pthread_mutex_unlock(&pool__.lock);
+
+    slab = aim_malloc(sizeof(*slab) * BIGLIST_CONFIG_NODE_POOL_BATCH);
+    if(slab == NULL) {
+        return -1;
+    }
+    for(i = 0; i < BIGLIST_CONFIG_NODE_POOL_BATCH - 1; i++) {
+        slab[i].next = &slab[i + 1];
+    }
+    slab[i].next = NULL;
+    cache->free = slab;
+    cache->count = BIGLIST_CONFIG_NODE_POOL_BATCH;
+    STAT_INC(cache, slabs);
+    return 0;
+}
+
+/* Move a batch from the head of a full free list to the shared pool */
+static void
+biglist_pool_flush__(biglist_pool_cache_t* cache)
+{
+    biglist_t* head = cache->free;
+    biglist_t* last = head;
+    int i;
+
+    for(i = 1; i < BIGLIST_CONFIG_NODE_POOL_BATCH; i++) {
+        last = last->next;
+    }
+    cache->free = last->next;
+    cache->count -= BIGLIST_CONFIG_NODE_POOL_BATCH;
+    last->next = NULL;
+
+    pthread_mutex_lock(&pool__.lock);
+    biglist_pool_batch_put__(head, BIGLIST_CONFIG_NODE_POOL_BATCH);
+    pthread_mutex_unlock(&pool__.lock);
+    STAT_INC(cache, flushes);
+}
+
+biglist_t*
+biglist_node_alloc__(void)
+{
+    biglist_pool_cache_t* cache = biglist_pool_cache__();
+    biglist_t* ble;
+
+    if(cache == NULL) {
+        return NULL;
+    }
+
+    STAT_INC(cache, allocs);
+    if(cache->free) {
+        STAT_INC(cache, hits);
+    }
+    else if(biglist_pool_refill__(cache) < 0) {
+        return NULL;
+    }
+
+    ble = cache->free;
+    cache->free = ble->next;
+    cache->count--;
+    return ble;
+}
+
+void
+biglist_node_free__(biglist_t* ble)
+{
+    biglist_pool_cache_t* cache = biglist_pool_cache__();
+
+    if(cache == NULL) {
+        /* Slab elements can't go back to the heap, so pool it as a batch of one */
+        ble->next = NULL;
+        pthread_mutex_lock(&pool__.lock);
+        biglist_pool_batch_put__(ble, 1);
+        pool__.stats.frees++;
+        pthread_mutex_unlock(&pool__.lock);
+        return;
+    }
+
+    STAT_INC(cache, frees);
+    ble->next = cache->free;
+    cache->free = ble;
+    if(++cache->count >= BIGLIST_CONFIG_NODE_POOL_THREAD_MAX) {
+        biglist_pool_flush__(cache);
+    }
+}
+
+void
+biglist_pool_stats_get(biglist_pool_stats_t* stats)
+{
+    biglist_pool_cache_t* cache;
+
+    pthread_mutex_lock(&pool__.lock);
+    *stats = pool__.stats;
+    for(cache = pool__.caches; cache; cache = cache->next) {
+        biglist_pool_stats_add__(stats, &cache->stats);
+    }
+    pthread_mutex_unlock(&pool__.lock);
+}
+
+void
+biglist_pool_stats_show(aim_pvs_t* pvs)
+{
+    biglist_pool_stats_t stats;
+
+    biglist_pool_stats_get(&stats);
+    aim_printf(pvs, "allocs %"PRIu64", hit rate %.1f%%, in use %"PRId64"\n",
+               stats.allocs,
+               stats.allocs ? stats.hits * 100.0 / stats.allocs : 0.0,
+               (int64_t)(stats.allocs - stats.frees));
+    aim_printf(pvs, "refills %"PRIu64", flushes %"PRIu64", slabs %"PRIu64" (%"PRIu64" elements)\n",
+               stats.refills, stats.flushes, stats.slabs,
+               stats.slabs * BIGLIST_CONFIG_NODE_POOL_BATCH);
+}
+
+#endif /* BIGLIST_CONFIG_NODE_POOL */
@@ -29,7 +29,7 @@ biglist_remove(biglist_t* bl, const void* data)
 
     if(ble != NULL) {
         bl = biglist_remove_link(bl, ble);
-        aim_free(ble);
+        biglist_node_free__(ble);
     }
     return bl;
 }
@@ -22,6 +22,13 @@
 #include <string.h>
 
 #include <BigList/biglist.h>
+#include <BigList/biglist_pool.h>
+#include <BigList/biglist_mpsc.h>
+#include <AIM/aim_list.h> /* for container_of */
+
+#if BIGLIST_CONFIG_NODE_POOL == 1 || BIGLIST_CONFIG_INCLUDE_LOCKED == 1
+#include <pthread.h>
+#endif
 
 #define FAIL(list, fmt, ...)                                        \
     do {                                                            \
@@ -320,6 +327,198 @@ int utest_BigList(void)
     return 0;
 }
 
+#if BIGLIST_CONFIG_NODE_POOL == 1
+#define POOL_THREADS 4
+#define POOL_ROUNDS 1000
+
+/* Build and tear down lists, freeing some elements on another thread */
+static void*
+__poolWorker(void* arg)
+{
+    biglist_t** handoff = arg;
+    biglist_t* bl;
+    int r, i;
+
+    for(r = 0; r < POOL_ROUNDS; r++) {
+        bl = NULL;
+        for(i = 0; i < 100; i++) {
+            bl = biglist_prepend(bl, IP(i));
+        }
+        for(i = 0; i < 50; i++) {
+            bl = biglist_remove(bl, IP(i));
+        }
+        if(biglist_length(bl) != 50 || bl->data != IP(99)) {
+            printf("pool worker: list corrupt\n");
+            abort();
+        }
+        if(r == POOL_ROUNDS - 1) {
+            *handoff = bl;
+        }
+        else {
+            biglist_free(bl);
+        }
+    }
+    return NULL;
+}
+
+int utest_pool(void)
+{
+    biglist_pool_stats_t before, after;
+    biglist_t* handoff[POOL_THREADS];
+    pthread_t threads[POOL_THREADS];
+    biglist_t* bl;
+    void* first;
+    int i;
+
+    /* A freed element is reused by the next allocation */
+    bl = biglist_prepend(NULL, IP(1));
+    first = bl;
+    BLFREE(bl, 1);
+    bl = biglist_prepend(NULL, IP(2));
+    if((void*)bl != first) {
+        FAIL(bl, "element %p was not reused", first);
+    }
+    BLFREE(bl, 1);
+
+    /* Steady state churn is served from the thread's free list */
+    biglist_pool_stats_get(&before);
+    for(i = 0; i < 100; i++) {
+        bl = __makeList(0, 200, 1);
+        BLFREE(bl, 200);
+    }
+    biglist_pool_stats_get(&after);
+    if(after.allocs - before.allocs != 20000 || after.frees - before.frees != 20000) {
+        FATAL("pool counted %d allocs and %d frees, expected 20000",
+              (int)(after.allocs - before.allocs), (int)(after.frees - before.frees));
+    }
+    if(after.allocs - after.hits > 20000/100) {
+        FATAL("pool hit rate too low: %d misses", (int)(after.allocs - after.hits));
+    }
+
+    /* Threads exit with elements allocated and cached; nothing is lost */
+    for(i = 0; i < POOL_THREADS; i++) {
+        pthread_create(&threads[i], NULL, __poolWorker, &handoff[i]);
+    }
+    for(i = 0; i < POOL_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    for(i = 0; i < POOL_THREADS; i++) {
+        BLFREE(handoff[i], 50);
+    }
+    biglist_pool_stats_get(&after);
+    if(after.allocs != after.frees) {
+        FATAL("pool has %d elements in use after all lists were freed",
+              (int)(after.allocs - after.frees));
+    }
+    biglist_pool_stats_show(&aim_pvs_stdout);
+    return 0;
+}
+#endif
+
+#if BIGLIST_CONFIG_INCLUDE_LOCKED == 1
+#define MPSC_PRODUCERS 4
+#define MPSC_ITEMS 50000
+
+typedef struct mpsc_item_s {
+    biglist_mpsc_node_t node;
+    int producer;
+    int seq;
+} mpsc_item_t;
+
+typedef struct mpsc_producer_s {
+    biglist_mpsc_t* q;
+    int id;
+    mpsc_item_t* items;
+} mpsc_producer_t;
+
+static void*
+__mpscProducer(void* arg)
+{
+    mpsc_producer_t* p = arg;
+    int i;
+    for(i = 0; i < MPSC_ITEMS; i++) {
+        p->items[i].producer = p->id;
+        p->items[i].seq = i;
+        biglist_mpsc_push(p->q, &p->items[i].node);
+    }
+    return NULL;
+}
+
+int utest_mpsc(void)
+{
+    biglist_mpsc_t q;
+    mpsc_item_t items[8];
+    biglist_mpsc_node_t* nodes[8];
+    mpsc_producer_t producers[MPSC_PRODUCERS];
+    pthread_t threads[MPSC_PRODUCERS];
+    int next[MPSC_PRODUCERS] = { 0 };
+    int i, n, received;
+
+    biglist_mpsc_init(&q);
+
+    /* Single thread FIFO */
+    if(!biglist_mpsc_empty(&q) || biglist_mpsc_pop(&q) != NULL) {
+        FATAL("new queue is not empty%s", "");
+    }
+    if(biglist_mpsc_wait(&q, 1000) != -1) {
+        FATAL("wait on an empty queue did not time out%s", "");
+    }
+    for(i = 0; i < 8; i++) {
+        items[i].seq = i;
+        biglist_mpsc_push(&q, &items[i].node);
+    }
+    if(biglist_mpsc_empty(&q) || biglist_mpsc_wait(&q, 0) != 0) {
+        FATAL("queue with 8 items is empty%s", "");
+    }
+    for(i = 0; i < 3; i++) {
+        biglist_mpsc_node_t* node = biglist_mpsc_pop(&q);
+        if(node != &items[i].node) {
+            FATAL("pop %d returned %p, expected %p", i, node, &items[i].node);
+        }
+    }
+    n = biglist_mpsc_pop_n(&q, nodes, 8);
+    if(n != 5) {
+        FATAL("pop_n returned %d, expected 5", n);
+    }
+    for(i = 0; i < n; i++) {
+        if(container_of(nodes[i], node, mpsc_item_t)->seq != i + 3) {
+            FATAL("pop_n item %d out of order", i);
+        }
+    }
+    if(!biglist_mpsc_empty(&q) || biglist_mpsc_pop(&q) != NULL) {
+        FATAL("drained queue is not empty%s", "");
+    }
+
+    /* Producer threads with a blocking consumer; per-producer order holds */
+    for(i = 0; i < MPSC_PRODUCERS; i++) {
+        producers[i].q = &q;
+        producers[i].id = i;
+        producers[i].items = aim_zmalloc(sizeof(mpsc_item_t) * MPSC_ITEMS);
+        pthread_create(&threads[i], NULL, __mpscProducer, &producers[i]);
+    }
+    for(received = 0; received < MPSC_PRODUCERS * MPSC_ITEMS; received += n) {
+        biglist_mpsc_wait(&q, 0);
+        n = biglist_mpsc_pop_n(&q, nodes, 8);
+        for(i = 0; i < n; i++) {
+            mpsc_item_t* item = container_of(nodes[i], node, mpsc_item_t);
+            if(item->seq != next[item->producer]++) {
+                FATAL("producer %d item %d out of order", item->producer, item->seq);
+            }
+        }
+    }
+    for(i = 0; i < MPSC_PRODUCERS; i++) {
+        pthread_join(threads[i], NULL);
+        aim_free(producers[i].items);
+    }
+    if(biglist_mpsc_pop(&q) != NULL) {
+        FATAL("extra items in queue%s", "");
+    }
+
+    biglist_mpsc_destroy(&q);
+    return 0;
+}
+#endif
+
 int main(int argc, char* argv[])
 {
     int rc;
@@ -331,6 +530,18 @@ int main(int argc, char* argv[])
     if(rc < 0) {
         return rc;
     }
+#if BIGLIST_CONFIG_NODE_POOL == 1
+    rc = utest_pool();
+    if(rc < 0) {
+        return rc;
+    }
+#endif
+#if BIGLIST_CONFIG_INCLUDE_LOCKED == 1
+    rc = utest_mpsc();
+    if(rc < 0) {
+        return rc;
+    }
+#endif
     printf("PASS\n");
     return 0;
 }
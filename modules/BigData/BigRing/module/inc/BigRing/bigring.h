@@ -132,6 +132,32 @@ void bigring_iter_start(bigring_t* br, int* iter);
  */
 void* bigring_iter_next(bigring_t* br, int* iter);
 
+#if BIGRING_CONFIG_INCLUDE_EVENTFD == 1
+
+/**
+ * @brief Get an eventfd that is readable while the ring has entries.
+ * @param br The bigring object.
+ * @returns The eventfd, created on first use and owned by the ring.
+ * @note Add it to a poll or epoll set and call bigring_shift when it
+ * is readable. Do not read it; shifting the last entry clears it.
+ * Pushes to a non-empty ring don't touch it, so a burst of pushes
+ * costs a single write.
+ */
+int bigring_eventfd(bigring_t* br);
+
+/**
+ * @brief Wait until the ring has entries.
+ * @param br The bigring object.
+ * @param usecs Timeout in usecs, or 0 to wait forever.
+ * @returns 0 if the ring has entries, -1 on timeout.
+ * @note With several consumers, another one may shift the entries
+ * first. bigring_shift still returns NULL in that case.
+ * @note Pushing from another thread requires BIGRING_CONFIG_INCLUDE_LOCKING.
+ */
+int bigring_wait(bigring_t* br, uint64_t usecs);
+
+#endif /* BIGRING_CONFIG_INCLUDE_EVENTFD */
+
 
 #endif /* __BIGRING_H__ */
 /* @} */
@@ -117,6 +117,26 @@
 #define BIGRING_CONFIG_INCLUDE_LOCKING 1
 #endif
 
+/**
+ * BIGRING_CONFIG_INCLUDE_EVENTFD
+ *
+ * Include the eventfd based wait and notification interface. */
+
+
+#ifndef BIGRING_CONFIG_INCLUDE_EVENTFD
+#define BIGRING_CONFIG_INCLUDE_EVENTFD 0
+#endif
+
+/**
+ * BIGRING_CONFIG_INCLUDE_SHM
+ *
+ * Include the shared memory packet ring. */
+
+
+#ifndef BIGRING_CONFIG_INCLUDE_SHM
+#define BIGRING_CONFIG_INCLUDE_SHM 0
+#endif
+
 
 
 /**
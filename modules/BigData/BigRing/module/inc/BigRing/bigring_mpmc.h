@@ -0,0 +1,94 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+/************************************************************//**
+ *
+ * @file
+ * @brief Lock-free multi producer, multi consumer BigRing.
+ *
+ * Any number of threads may push and shift concurrently. Each slot
+ * carries a sequence number that says whether it is ready to be
+ * written or read for the current lap of the ring, so producers and
+ * consumers only contend on the index they advance, with a single
+ * compare and swap per operation.
+ *
+ * Like bigring_spsc_push, pushing to a full ring fails rather than
+ * dropping the oldest entry. Entries must not be NULL.
+ *
+ * @addtogroup bigring-bigring
+ * @{
+ *
+ ***************************************************************/
+#ifndef __BIGRING_MPMC_H__
+#define __BIGRING_MPMC_H__
+
+#include <BigRing/bigring.h>
+
+/**
+ * MPMC BigRing object.
+ */
+typedef struct bigring_mpmc_s bigring_mpmc_t;
+
+/**
+ * @brief Create an MPMC ring.
+ * @param size The minimum number of entries, rounded up to a power of 2
+ * (at least 2).
+ * @param free_entry The entry deallocator, used by bigring_mpmc_destroy.
+ * @note If free_entry is NULL, the entries will not be freed.
+ * @note pass bigring_aim_free_entry() if you want normal deallocation.
+ */
+bigring_mpmc_t* bigring_mpmc_create(int size, bigring_free_entry_f free_entry);
+
+/**
+ * @brief Destroy an MPMC ring.
+ * @param br The ring.
+ * @note Entries still in the ring are freed. No thread may be using
+ * the ring.
+ */
+void bigring_mpmc_destroy(bigring_mpmc_t* br);
+
+/**
+ * @brief Get the maximum number of entries in the ring.
+ * @param br The ring.
+ */
+int bigring_mpmc_size(bigring_mpmc_t* br);
+
+/**
+ * @brief Get the number of entries in the ring.
+ * @param br The ring.
+ * @note Approximate while other threads are pushing or shifting.
+ */
+int bigring_mpmc_count(bigring_mpmc_t* br);
+
+/**
+ * @brief Add an entry to the ring.
+ * @param br The ring.
+ * @param entry The entry to add.
+ * @returns 0 on success, -1 if the ring is full.
+ */
+int bigring_mpmc_push(bigring_mpmc_t* br, void* entry);
+
+/**
+ * @brief Remove the next entry from the ring.
+ * @param br The ring.
+ * @returns The entry, or NULL if the ring is empty.
+ */
+void* bigring_mpmc_shift(bigring_mpmc_t* br);
+
+#endif /* __BIGRING_MPMC_H__ */
+/* @} */
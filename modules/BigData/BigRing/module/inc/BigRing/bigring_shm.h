@@ -0,0 +1,167 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+/************************************************************//**
+ *
+ * @file
+ * @brief Shared memory packet ring between two processes.
+ *
+ * The ring lives in a named POSIX shared memory segment. Slots hold
+ * packet data inline, up to a fixed slot size, so one producer process
+ * and one consumer process can exchange packets without syscalls: like
+ * bigring_spsc_t, each side owns one index and publishes it with a
+ * release store.
+ *
+ * A slot only becomes visible once it is fully written, so the ring
+ * stays consistent when either side crashes, and a restarted process
+ * can simply attach again. A process that dies while initializing the
+ * segment is detected on the next attach, which initializes it again.
+ *
+ * Packets may be copied in and out, or written and read in place:
+ *
+ *     void* p = bigring_shm_reserve(ring);
+ *     if(p) {
+ *         len = build_packet(p, bigring_shm_slot_size(ring));
+ *         bigring_shm_commit(ring, len);
+ *     }
+ *
+ * @addtogroup bigring-bigring
+ * @{
+ *
+ ***************************************************************/
+#ifndef __BIGRING_SHM_H__
+#define __BIGRING_SHM_H__
+
+#include <BigRing/bigring_config.h>
+
+#if BIGRING_CONFIG_INCLUDE_SHM == 1
+
+#include <stdint.h>
+
+/**
+ * A process's attachment to a shared memory ring.
+ */
+typedef struct bigring_shm_s bigring_shm_t;
+
+/**
+ * Discard the segment's contents and initialize it again with the
+ * given geometry. Only use this while the peer process is stopped.
+ */
+#define BIGRING_SHM_F_RESET 0x1
+
+/**
+ * @brief Attach to a shared memory ring, creating it if needed.
+ * @param name The segment name, as for shm_open ("/name").
+ * @param slot_size Maximum packet size in bytes.
+ * @param slot_count Number of slots, rounded up to a power of 2.
+ * @param flags BIGRING_SHM_F_*
+ * @returns The attachment, or NULL with errno set. An existing segment
+ * with a different geometry fails with EINVAL unless
+ * BIGRING_SHM_F_RESET is given.
+ */
+bigring_shm_t* bigring_shm_attach(const char* name, int slot_size,
+                                  int slot_count, uint32_t flags);
+
+/**
+ * @brief Detach from a shared memory ring.
+ * @param ring The attachment.
+ * @note The segment and its contents remain until bigring_shm_unlink.
+ */
+void bigring_shm_detach(bigring_shm_t* ring);
+
+/**
+ * @brief Remove a shared memory ring's name.
+ * @param name The segment name.
+ * @returns 0 on success, -1 with errno set.
+ * @note Processes still attached keep using the segment.
+ */
+int bigring_shm_unlink(const char* name);
+
+/**
+ * @brief Get the maximum packet size.
+ * @param ring The attachment.
+ */
+int bigring_shm_slot_size(bigring_shm_t* ring);
+
+/**
+ * @brief Get the number of slots.
+ * @param ring The attachment.
+ */
+int bigring_shm_size(bigring_shm_t* ring);
+
+/**
+ * @brief Get the number of packets in the ring.
+ * @param ring The attachment.
+ */
+int bigring_shm_count(bigring_shm_t* ring);
+
+/**
+ * @brief Copy a packet into the ring. Producer only.
+ * @param ring The attachment.
+ * @param data The packet.
+ * @param len The packet length.
+ * @returns 0 on success, -1 if the ring is full or len is larger than
+ * the slot size.
+ */
+int bigring_shm_push(bigring_shm_t* ring, const void* data, int len);
+
+/**
+ * @brief Copy the next packet out of the ring. Consumer only.
+ * @param ring The attachment.
+ * @param data Receives the packet.
+ * @param max_len Size of the data buffer. Longer packets are truncated.
+ * @returns The packet length, or -1 if the ring is empty.
+ */
+int bigring_shm_shift(bigring_shm_t* ring, void* data, int max_len);
+
+/**
+ * @brief Get the next free slot to write a packet in place. Producer only.
+ * @param ring The attachment.
+ * @returns The slot data, or NULL if the ring is full.
+ * @note Publish the packet with bigring_shm_commit.
+ */
+void* bigring_shm_reserve(bigring_shm_t* ring);
+
+/**
+ * @brief Publish the packet written to the slot from bigring_shm_reserve.
+ * @param ring The attachment.
+ * @param len The packet length, at most the slot size.
+ * @returns 0 on success, -1 if len is out of range, in which case the
+ * slot stays reserved.
+ */
+int bigring_shm_commit(bigring_shm_t* ring, int len);
+
+/**
+ * @brief Get the next packet to read it in place. Consumer only.
+ * @param ring The attachment.
+ * @param len Receives the packet length.
+ * @returns The packet data, or NULL if the ring is empty.
+ * @note Free the slot with bigring_shm_release.
+ */
+const void* bigring_shm_peek(bigring_shm_t* ring, int* len);
+
+/**
+ * @brief Free the slot returned by bigring_shm_peek.
+ * @param ring The attachment.
+ */
+void bigring_shm_release(bigring_shm_t* ring);
+
+#endif /* BIGRING_CONFIG_INCLUDE_SHM */
+
+#endif /* __BIGRING_SHM_H__ */
+/* @} */
@@ -0,0 +1,113 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+/************************************************************//**
+ *
+ * @file
+ * @brief Lock-free single producer, single consumer BigRing.
+ *
+ * Exactly one thread may push and exactly one thread may shift. Neither
+ * takes a lock: the producer owns the tail index, the consumer owns the
+ * head index, and each publishes its index with a release store that the
+ * other side reads with an acquire load. The two indices live on
+ * separate cache lines.
+ *
+ * Unlike bigring_push, pushing to a full ring fails rather than
+ * dropping the oldest entry, since only the consumer may advance the
+ * head. Entries must not be NULL.
+ *
+ * @addtogroup bigring-bigring
+ * @{
+ *
+ ***************************************************************/
+#ifndef __BIGRING_SPSC_H__
+#define __BIGRING_SPSC_H__
+
+#include <BigRing/bigring.h>
+
+/**
+ * SPSC BigRing object.
+ */
+typedef struct bigring_spsc_s bigring_spsc_t;
+
+/**
+ * @brief Create an SPSC ring.
+ * @param size The minimum number of entries, rounded up to a power of 2.
+ * @param free_entry The entry deallocator, used by bigring_spsc_destroy.
+ * @note If free_entry is NULL, the entries will not be freed.
+ */
+bigring_spsc_t* bigring_spsc_create(int size, bigring_free_entry_f free_entry);
+
+/**
+ * @brief Destroy an SPSC ring.
+ * @param br The ring.
+ * @note Entries still in the ring are freed. Neither thread may be
+ * using the ring.
+ */
+void bigring_spsc_destroy(bigring_spsc_t* br);
+
+/**
+ * @brief Get the maximum number of entries in the ring.
+ * @param br The ring.
+ */
+int bigring_spsc_size(bigring_spsc_t* br);
+
+/**
+ * @brief Get the number of entries in the ring.
+ * @param br The ring.
+ * @note Exact only when called by the producer or consumer while the
+ * other side is idle.
+ */
+int bigring_spsc_count(bigring_spsc_t* br);
+
+/**
+ * @brief Add an entry to the ring. Producer only.
+ * @param br The ring.
+ * @param entry The entry to add.
+ * @returns 0 on success, -1 if the ring is full.
+ */
+int bigring_spsc_push(bigring_spsc_t* br, void* entry);
+
+/**
+ * @brief Add up to n entries to the ring. Producer only.
+ * @param br The ring.
+ * @param entries The entries to add.
+ * @param n The number of entries.
+ * @returns The number of entries added, which is less than n if the
+ * ring filled up.
+ */
+int bigring_spsc_push_n(bigring_spsc_t* br, void** entries, int n);
+
+/**
+ * @brief Remove the next entry from the ring. Consumer only.
+ * @param br The ring.
+ * @returns The entry, or NULL if the ring is empty.
+ */
+void* bigring_spsc_shift(bigring_spsc_t* br);
+
+/**
+ * @brief Remove up to n entries from the ring. Consumer only.
+ * @param br The ring.
+ * @param entries Receives the entries.
+ * @param n The maximum number of entries.
+ * @returns The number of entries removed.
+ */
+int bigring_spsc_shift_n(bigring_spsc_t* br, void** entries, int n);
+
+#endif /* __BIGRING_SPSC_H__ */
+/* @} */
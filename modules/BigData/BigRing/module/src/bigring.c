@@ -25,6 +25,15 @@
 #include <OS/os_sem.h>
 #endif
 
+#if BIGRING_CONFIG_INCLUDE_EVENTFD == 1
+#include <OS/os_time.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#include <limits.h>
+#endif
+
 
 struct bigring_s {
     /** The ring buffer size */
@@ -39,6 +48,13 @@ struct bigring_s {
     /** Entry deallocator - optional */
     bigring_free_entry_f free_entry;
 
+#if BIGRING_CONFIG_INCLUDE_EVENTFD == 1
+    /** Readable while signaled, -1 until requested */
+    int efd;
+    /** The eventfd has been written since the ring was last empty */
+    int signaled;
+#endif
+
 #if BIGRING_CONFIG_INCLUDE_LOCKING == 1
     os_sem_t lock;
 #define BIGRING_LOCK(_br) bigring_lock(_br)
@@ -78,6 +94,9 @@ bigring_create(int size, bigring_free_entry_f free_entry)
     br->head = 0;
     br->tail = 0;
 
+#if BIGRING_CONFIG_INCLUDE_EVENTFD == 1
+    br->efd = -1;
+#endif
 #if BIGRING_CONFIG_INCLUDE_LOCKING == 1
     br->lock = os_sem_create(1);
 #endif
@@ -109,6 +128,11 @@ bigring_destroy(bigring_t* br)
     }
     BIGRING_UNLOCK(br);
 
+#if BIGRING_CONFIG_INCLUDE_EVENTFD == 1
+    if(br->efd >= 0) {
+        close(br->efd);
+    }
+#endif
 #if BIGRING_CONFIG_INCLUDE_LOCKING == 1
     os_sem_destroy(br->lock);
 #endif
@@ -160,6 +184,36 @@ bigring_count(bigring_t* br)
 
 #define RING_INCREMENT(_br, _index) (_index = (_index + 1) % (_br->size))
 
+#if BIGRING_CONFIG_INCLUDE_EVENTFD == 1
+/*
+ * The eventfd is written once when the ring becomes non-empty and read
+ * once when it is drained, so a burst of pushes costs one syscall and
+ * the eventfd is readable exactly while the ring holds entries.
+ * Must be called under lock.
+ */
+static void
+bigring_notify_locked__(bigring_t* br)
+{
+    if(br->efd >= 0 && !br->signaled) {
+        eventfd_write(br->efd, 1);
+        br->signaled = 1;
+    }
+}
+
+static void
+bigring_notify_clear_locked__(bigring_t* br)
+{
+    if(br->signaled && br->head == br->tail) {
+        eventfd_t v;
+        eventfd_read(br->efd, &v);
+        br->signaled = 0;
+    }
+}
+#else
+#define bigring_notify_locked__(_br)
+#define bigring_notify_clear_locked__(_br)
+#endif
+
 static void
 bigring_push_locked__(bigring_t* br, void* entry)
 {
@@ -172,6 +226,7 @@ bigring_push_locked__(bigring_t* br, void* entry)
         bigring_entry_free_locked__(br, br->head);
         RING_INCREMENT(br, br->head);
     }
+    bigring_notify_locked__(br);
 }
 
 void
@@ -192,6 +247,7 @@ bigring_shift_locked__(bigring_t* br)
         br->ring[br->head] = NULL;
         RING_INCREMENT(br, br->head);
     }
+    bigring_notify_clear_locked__(br);
     return rv;
 }
 void*
@@ -237,3 +293,75 @@ bigring_size(bigring_t* br)
     /* Account for empty slot */
     return br->size-1;
 }
+
+#if BIGRING_CONFIG_INCLUDE_EVENTFD == 1
+
+int
+bigring_eventfd(bigring_t* br)
+{
+    int efd;
+    BIGRING_LOCK(br);
+    if(br->efd < 0) {
+        br->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if(br->efd < 0) {
+            AIM_DIE("eventfd() failed - %s", strerror(errno));
+        }
+        if(br->head != br->tail) {
+            bigring_notify_locked__(br);
+        }
+    }
+    efd = br->efd;
+    BIGRING_UNLOCK(br);
+    return efd;
+}
+
+/* Round a timeout up to poll() milliseconds, clamped to INT_MAX */
+static int
+bigring_poll_timeout__(uint64_t usecs)
+{
+    uint64_t ms = usecs / 1000 + (usecs % 1000 != 0);
+    return ms > INT_MAX ? INT_MAX : (int)ms;
+}
+
+int
+bigring_wait(bigring_t* br, uint64_t usecs)
+{
+    struct pollfd fds;
+    uint64_t t_start = os_time_monotonic();
+    int timeout_ms = usecs ? bigring_poll_timeout__(usecs) : -1;
+
+    fds.fd = bigring_eventfd(br);
+    fds.events = POLLIN;
+
+    for(;;) {
+        int rv;
+
+        /*
+         * The eventfd can only be readable while the ring is
+         * non-empty, so a push after this check wakes the poll.
+         */
+        if(bigring_count(br) > 0) {
+            return 0;
+        }
+
+        fds.revents = 0;
+        /*
+         * A timeout clamped to INT_MAX can expire early, so a poll
+         * timeout falls through to the elapsed time check.
+         */
+        rv = poll(&fds, 1, timeout_ms);
+        if(rv < 0 && errno != EINTR) {
+            AIM_DIE("Unexpected return value from poll(): %s", strerror(errno));
+        }
+
+        if(timeout_ms != -1) {
+            uint64_t now = os_time_monotonic();
+            if(now - t_start >= usecs) {
+                return bigring_count(br) > 0 ? 0 : -1;
+            }
+            timeout_ms = bigring_poll_timeout__(usecs - (now - t_start));
+        }
+    }
+}
+
+#endif /* BIGRING_CONFIG_INCLUDE_EVENTFD */
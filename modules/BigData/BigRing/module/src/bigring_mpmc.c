@@ -0,0 +1,172 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+
+#include <BigRing/bigring_config.h>
+#include <BigRing/bigring_mpmc.h>
+#include <AIM/aim.h>
+
+#define CACHE_LINE 64
+
+#define LOAD(_p) __atomic_load_n(_p, __ATOMIC_ACQUIRE)
+#define STORE(_p, _v) __atomic_store_n(_p, _v, __ATOMIC_RELEASE)
+#define LOAD_RELAXED(_p) __atomic_load_n(_p, __ATOMIC_RELAXED)
+
+/*
+ * Slot i starts with seq i. A producer at position pos may write the
+ * slot when seq == pos and then sets seq = pos + 1. A consumer at pos
+ * may read it when seq == pos + 1 and then sets seq = pos + size, which
+ * makes it writable on the producers' next lap.
+ */
+typedef struct bigring_mpmc_slot_s {
+    uint32_t seq;
+    void* entry;
+} bigring_mpmc_slot_t;
+
+struct bigring_mpmc_s {
+    /** The slots, a power of 2 of them */
+    bigring_mpmc_slot_t* slots;
+    /** Slot count - 1 */
+    uint32_t mask;
+    /** Entry deallocator - optional */
+    bigring_free_entry_f free_entry;
+    char pad0[CACHE_LINE];
+
+    /** Next position to push */
+    uint32_t tail;
+    char pad1[CACHE_LINE];
+
+    /** Next position to shift */
+    uint32_t head;
+    char pad2[CACHE_LINE];
+}; /* bigring_mpmc_t */
+
+
+bigring_mpmc_t*
+bigring_mpmc_create(int size, bigring_free_entry_f free_entry)
+{
+    bigring_mpmc_t* br = aim_zmalloc(sizeof(*br));
+    uint32_t count = 2;
+    uint32_t i;
+
+    /* One slot can't tell a written slot from one free for the next lap */
+    while(count < (uint32_t)size) {
+        count *= 2;
+    }
+
+    br->slots = aim_zmalloc(sizeof(br->slots[0])*count);
+    for(i = 0; i < count; i++) {
+        br->slots[i].seq = i;
+    }
+    br->mask = count - 1;
+    br->free_entry = free_entry;
+    return br;
+}
+
+void
+bigring_mpmc_destroy(bigring_mpmc_t* br)
+{
+    uint32_t pos;
+    for(pos = br->head; pos != br->tail; pos++) {
+        if(br->free_entry) {
+            br->free_entry(br->slots[pos & br->mask].entry);
+        }
+    }
+    aim_free(br->slots);
+    aim_free(br);
+}
+
+int
+bigring_mpmc_size(bigring_mpmc_t* br)
+{
+    return br->mask + 1;
+}
+
+int
+bigring_mpmc_count(bigring_mpmc_t* br)
+{
+    uint32_t head = LOAD(&br->head);
+    int32_t count = LOAD(&br->tail) - head;
+
+    /* Pushes and shifts between the two loads can skew the difference */
+    if(count < 0) {
+        return 0;
+    }
+    return count > (int32_t)br->mask + 1 ? (int)br->mask + 1 : count;
+}
+
+int
+bigring_mpmc_push(bigring_mpmc_t* br, void* entry)
+{
+    uint32_t pos = LOAD_RELAXED(&br->tail);
+    bigring_mpmc_slot_t* slot;
+
+    for(;;) {
+        int32_t dif;
+        slot = &br->slots[pos & br->mask];
+        dif = (int32_t)(LOAD(&slot->seq) - pos);
+        if(dif == 0) {
+            if(__atomic_compare_exchange_n(&br->tail, &pos, pos + 1, 1,
+                                           __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        }
+        else if(dif < 0) {
+            /* Still holds an entry from the previous lap */
+            return -1;
+        }
+        else {
+            pos = LOAD_RELAXED(&br->tail);
+        }
+    }
+
+    slot->entry = entry;
+    STORE(&slot->seq, pos + 1);
+    return 0;
+}
+
+void*
+bigring_mpmc_shift(bigring_mpmc_t* br)
+{
+    uint32_t pos = LOAD_RELAXED(&br->head);
+    bigring_mpmc_slot_t* slot;
+    void* rv;
+
+    for(;;) {
+        int32_t dif;
+        slot = &br->slots[pos & br->mask];
+        dif = (int32_t)(LOAD(&slot->seq) - (pos + 1));
+        if(dif == 0) {
+            if(__atomic_compare_exchange_n(&br->head, &pos, pos + 1, 1,
+                                           __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        }
+        else if(dif < 0) {
+            /* Not written yet */
+            return NULL;
+        }
+        else {
+            pos = LOAD_RELAXED(&br->head);
+        }
+    }
+
+    rv = slot->entry;
+    STORE(&slot->seq, pos + br->mask + 1);
+    return rv;
+}
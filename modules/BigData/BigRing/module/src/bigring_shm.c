@@ -0,0 +1,325 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+
+#include <BigRing/bigring_config.h>
+
+#if BIGRING_CONFIG_INCLUDE_SHM == 1
+
+#include <BigRing/bigring_shm.h>
+#include <AIM/aim.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#define CACHE_LINE 64
+#define ROUND_UP(_x, _align) (((_x) + (_align) - 1) / (_align) * (_align))
+
+#define LOAD(_p) __atomic_load_n(_p, __ATOMIC_ACQUIRE)
+#define STORE(_p, _v) __atomic_store_n(_p, _v, __ATOMIC_RELEASE)
+
+#define BIGRING_SHM_MAGIC 0x42524e47
+#define BIGRING_SHM_VERSION 2
+
+/*
+ * Segment layout: this header, then slot_count slots of 'stride'
+ * bytes. Each slot is a bigring_shm_slot_t followed by its data.
+ */
+typedef struct bigring_shm_hdr_s {
+    /** BIGRING_SHM_MAGIC once the rest of the header is initialized */
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_size;
+    uint32_t slot_count;
+    char pad0[CACHE_LINE];
+
+    /** Next slot the producer writes */
+    uint32_t tail;
+    char pad1[CACHE_LINE];
+
+    /** Next slot the consumer reads */
+    uint32_t head;
+    char pad2[CACHE_LINE];
+} bigring_shm_hdr_t;
+
+typedef struct bigring_shm_slot_s {
+    uint32_t len;
+    uint32_t reserved;
+} bigring_shm_slot_t;
+
+#define SLOTS_OFFSET ROUND_UP(sizeof(bigring_shm_hdr_t), CACHE_LINE)
+
+/*
+ * Everything but the shared header is private to the process, so the
+ * geometry can't be changed under us and each side's cached copy of
+ * the other's index costs no shared writes.
+ */
+struct bigring_shm_s {
+    bigring_shm_hdr_t* hdr;
+    uint8_t* slots;
+    size_t map_size;
+    int fd;
+    uint32_t slot_size;
+    uint32_t mask;
+    uint32_t stride;
+    /** Producer: last head seen */
+    uint32_t head_cache;
+    /** Consumer: last tail seen */
+    uint32_t tail_cache;
+};
+
+static inline bigring_shm_slot_t*
+bigring_shm_slot__(bigring_shm_t* ring, uint32_t index)
+{
+    return (bigring_shm_slot_t*)(ring->slots + (size_t)(index & ring->mask)*ring->stride);
+}
+
+/*
+ * Check the header, or initialize it if it isn't. Called with the
+ * segment's flock held. The magic is written last, so a crashed
+ * initializer leaves it unset and the next attacher initializes the
+ * header again. Process liveness is never guessed from a pid.
+ */
+static int
+bigring_shm_init__(bigring_shm_t* ring, uint32_t flags)
+{
+    bigring_shm_hdr_t* hdr = ring->hdr;
+
+    if(LOAD(&hdr->magic) == BIGRING_SHM_MAGIC && !(flags & BIGRING_SHM_F_RESET)) {
+        if(hdr->version != BIGRING_SHM_VERSION ||
+           hdr->slot_size != ring->slot_size ||
+           hdr->slot_count != ring->mask + 1) {
+            return -1;
+        }
+        return 0;
+    }
+
+    STORE(&hdr->magic, 0);
+    hdr->version = BIGRING_SHM_VERSION;
+    hdr->slot_size = ring->slot_size;
+    hdr->slot_count = ring->mask + 1;
+    hdr->tail = 0;
+    hdr->head = 0;
+    STORE(&hdr->magic, BIGRING_SHM_MAGIC);
+    return 0;
+}
+
+bigring_shm_t*
+bigring_shm_attach(const char* name, int slot_size, int slot_count,
+                   uint32_t flags)
+{
+    bigring_shm_t* ring;
+    uint32_t count = 1;
+    struct stat st;
+    void* map;
+    int fd;
+
+    if(slot_size <= 0 || slot_count <= 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    while(count < (uint32_t)slot_count) {
+        count *= 2;
+    }
+
+    ring = aim_zmalloc(sizeof(*ring));
+    ring->slot_size = slot_size;
+    ring->mask = count - 1;
+    ring->stride = ROUND_UP(sizeof(bigring_shm_slot_t) + slot_size, CACHE_LINE);
+    ring->map_size = SLOTS_OFFSET + (size_t)ring->stride*count;
+
+    fd = shm_open(name, O_RDWR | O_CREAT, 0600);
+    if(fd < 0) {
+        aim_free(ring);
+        return NULL;
+    }
+
+    /*
+     * Attachers serialize on an flock of the segment, which the kernel
+     * drops if the holder dies. It is taken before looking at the size
+     * so a peer's ftruncate can't land between the check and the map.
+     */
+    while(flock(fd, LOCK_EX) < 0) {
+        if(errno != EINTR) {
+            goto error;
+        }
+    }
+
+    /* A new segment is empty; a mismatched one can only be reset */
+    if(fstat(fd, &st) < 0) {
+        goto error;
+    }
+    if((size_t)st.st_size != ring->map_size) {
+        if(st.st_size != 0 && !(flags & BIGRING_SHM_F_RESET)) {
+            errno = EINVAL;
+            goto error;
+        }
+        if(ftruncate(fd, ring->map_size) < 0) {
+            goto error;
+        }
+    }
+
+    map = mmap(NULL, ring->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(map == MAP_FAILED) {
+        goto error;
+    }
+    ring->fd = fd;
+    ring->hdr = map;
+    ring->slots = (uint8_t*)map + SLOTS_OFFSET;
+
+    if(bigring_shm_init__(ring, flags) < 0) {
+        bigring_shm_detach(ring);
+        errno = EINVAL;
+        return NULL;
+    }
+    flock(fd, LOCK_UN);
+
+    ring->head_cache = LOAD(&ring->hdr->head);
+    ring->tail_cache = LOAD(&ring->hdr->tail);
+    return ring;
+
+ error:
+    {
+        int err = errno;
+        close(fd);
+        aim_free(ring);
+        errno = err;
+    }
+    return NULL;
+}
+
+void
+bigring_shm_detach(bigring_shm_t* ring)
+{
+    munmap(ring->hdr, ring->map_size);
+    close(ring->fd);
+    aim_free(ring);
+}
+
+int
+bigring_shm_unlink(const char* name)
+{
+    return shm_unlink(name);
+}
+
+int
+bigring_shm_slot_size(bigring_shm_t* ring)
+{
+    return ring->slot_size;
+}
+
+int
+bigring_shm_size(bigring_shm_t* ring)
+{
+    return ring->mask + 1;
+}
+
+int
+bigring_shm_count(bigring_shm_t* ring)
+{
+    uint32_t head = LOAD(&ring->hdr->head);
+    return LOAD(&ring->hdr->tail) - head;
+}
+
+void*
+bigring_shm_reserve(bigring_shm_t* ring)
+{
+    uint32_t tail = ring->hdr->tail;
+
+    if(tail - ring->head_cache > ring->mask) {
+        ring->head_cache = LOAD(&ring->hdr->head);
+        if(tail - ring->head_cache > ring->mask) {
+            return NULL;
+        }
+    }
+    return bigring_shm_slot__(ring, tail) + 1;
+}
+
+int
+bigring_shm_commit(bigring_shm_t* ring, int len)
+{
+    uint32_t tail = ring->hdr->tail;
+
+    if(len < 0 || (uint32_t)len > ring->slot_size) {
+        return -1;
+    }
+    bigring_shm_slot__(ring, tail)->len = len;
+    STORE(&ring->hdr->tail, tail + 1);
+    return 0;
+}
+
+int
+bigring_shm_push(bigring_shm_t* ring, const void* data, int len)
+{
+    void* slot;
+
+    if(len < 0 || (uint32_t)len > ring->slot_size) {
+        return -1;
+    }
+    if((slot = bigring_shm_reserve(ring)) == NULL) {
+        return -1;
+    }
+    memcpy(slot, data, len);
+    return bigring_shm_commit(ring, len);
+}
+
+const void*
+bigring_shm_peek(bigring_shm_t* ring, int* len)
+{
+    uint32_t head = ring->hdr->head;
+    bigring_shm_slot_t* slot;
+
+    if(ring->tail_cache == head) {
+        ring->tail_cache = LOAD(&ring->hdr->tail);
+        if(ring->tail_cache == head) {
+            return NULL;
+        }
+    }
+
+    /* Don't trust the other process with our buffer sizes */
+    slot = bigring_shm_slot__(ring, head);
+    *len = slot->len < ring->slot_size ? slot->len : ring->slot_size;
+    return slot + 1;
+}
+
+void
+bigring_shm_release(bigring_shm_t* ring)
+{
+    STORE(&ring->hdr->head, ring->hdr->head + 1);
+}
+
+int
+bigring_shm_shift(bigring_shm_t* ring, void* data, int max_len)
+{
+    const void* slot;
+    int len;
+
+    if((slot = bigring_shm_peek(ring, &len)) == NULL) {
+        return -1;
+    }
+    memcpy(data, slot, len < max_len ? len : max_len);
+    bigring_shm_release(ring);
+    return len;
+}
+
+#endif /* BIGRING_CONFIG_INCLUDE_SHM */
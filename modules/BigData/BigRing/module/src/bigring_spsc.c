@@ -0,0 +1,179 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+
+#include <BigRing/bigring_config.h>
+#include <BigRing/bigring_spsc.h>
+#include <AIM/aim.h>
+
+#define CACHE_LINE 64
+
+#define LOAD(_p) __atomic_load_n(_p, __ATOMIC_ACQUIRE)
+#define STORE(_p, _v) __atomic_store_n(_p, _v, __ATOMIC_RELEASE)
+
+/*
+ * The indices run freely and are masked on access, so every slot is
+ * usable and count is always tail - head. Each side keeps a private
+ * copy of the other's index and only reloads it when the copy says the
+ * ring is full (or empty), which keeps the shared lines from bouncing
+ * on every operation.
+ */
+struct bigring_spsc_s {
+    /** The ring, a power of 2 number of slots */
+    void** ring;
+    /** Slot count - 1 */
+    uint32_t mask;
+    /** Entry deallocator - optional */
+    bigring_free_entry_f free_entry;
+    char pad0[CACHE_LINE];
+
+    /** Producer: next slot to write */
+    uint32_t tail;
+    /** Producer: last head seen */
+    uint32_t head_cache;
+    char pad1[CACHE_LINE];
+
+    /** Consumer: next slot to read */
+    uint32_t head;
+    /** Consumer: last tail seen */
+    uint32_t tail_cache;
+    char pad2[CACHE_LINE];
+}; /* bigring_spsc_t */
+
+
+bigring_spsc_t*
+bigring_spsc_create(int size, bigring_free_entry_f free_entry)
+{
+    bigring_spsc_t* br = aim_zmalloc(sizeof(*br));
+    uint32_t slots = 1;
+
+    while(slots < (uint32_t)size) {
+        slots *= 2;
+    }
+
+    br->ring = aim_zmalloc(sizeof(void*)*slots);
+    br->mask = slots - 1;
+    br->free_entry = free_entry;
+    return br;
+}
+
+void
+bigring_spsc_destroy(bigring_spsc_t* br)
+{
+    uint32_t i;
+    for(i = br->head; i != br->tail; i++) {
+        if(br->free_entry) {
+            br->free_entry(br->ring[i & br->mask]);
+        }
+    }
+    aim_free(br->ring);
+    aim_free(br);
+}
+
+int
+bigring_spsc_size(bigring_spsc_t* br)
+{
+    return br->mask + 1;
+}
+
+int
+bigring_spsc_count(bigring_spsc_t* br)
+{
+    /* Load head first so a concurrent shift can't make this negative */
+    uint32_t head = LOAD(&br->head);
+    return LOAD(&br->tail) - head;
+}
+
+/* Free slots the producer can fill, reloading head only when needed */
+static inline uint32_t
+bigring_spsc_space__(bigring_spsc_t* br, uint32_t n)
+{
+    uint32_t space = br->mask + 1 - (br->tail - br->head_cache);
+    if(space < n) {
+        br->head_cache = LOAD(&br->head);
+        space = br->mask + 1 - (br->tail - br->head_cache);
+    }
+    return space;
+}
+
+/* Entries the consumer can take, reloading tail only when needed */
+static inline uint32_t
+bigring_spsc_avail__(bigring_spsc_t* br, uint32_t n)
+{
+    uint32_t avail = br->tail_cache - br->head;
+    if(avail < n) {
+        br->tail_cache = LOAD(&br->tail);
+        avail = br->tail_cache - br->head;
+    }
+    return avail;
+}
+
+int
+bigring_spsc_push(bigring_spsc_t* br, void* entry)
+{
+    if(bigring_spsc_space__(br, 1) == 0) {
+        return -1;
+    }
+    br->ring[br->tail & br->mask] = entry;
+    STORE(&br->tail, br->tail + 1);
+    return 0;
+}
+
+int
+bigring_spsc_push_n(bigring_spsc_t* br, void** entries, int n)
+{
+    uint32_t space = bigring_spsc_space__(br, n);
+    uint32_t i;
+
+    if(space > (uint32_t)n) {
+        space = n;
+    }
+    for(i = 0; i < space; i++) {
+        br->ring[(br->tail + i) & br->mask] = entries[i];
+    }
+    STORE(&br->tail, br->tail + space);
+    return space;
+}
+
+void*
+bigring_spsc_shift(bigring_spsc_t* br)
+{
+    void* rv;
+    if(bigring_spsc_avail__(br, 1) == 0) {
+        return NULL;
+    }
+    rv = br->ring[br->head & br->mask];
+    STORE(&br->head, br->head + 1);
+    return rv;
+}
+
+int
+bigring_spsc_shift_n(bigring_spsc_t* br, void** entries, int n)
+{
+    uint32_t avail = bigring_spsc_avail__(br, n);
+    uint32_t i;
+
+    if(avail > (uint32_t)n) {
+        avail = n;
+    }
+    for(i = 0; i < avail; i++) {
+        entries[i] = br->ring[(br->head + i) & br->mask];
+    }
+    STORE(&br->head, br->head + avail);
+    return avail;
+}
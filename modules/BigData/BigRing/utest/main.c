@@ -19,11 +19,30 @@
 
 #include <BigRing/bigring_config.h>
 #include <BigRing/bigring.h>
+#include <BigRing/bigring_spsc.h>
+#include <BigRing/bigring_mpmc.h>
+#include <BigRing/bigring_shm.h>
 #include <AIM/aim.h>
+#include <OS/os_time.h>
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#if BIGRING_CONFIG_INCLUDE_SHM == 1
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <errno.h>
+#endif
+#if BIGRING_CONFIG_INCLUDE_EVENTFD == 1
+#include <OS/os_sleep.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <poll.h>
+#endif
 #include <AIM/aim.h>
 
 #define AIM_LOG_MODULE_NAME BigRingTest
@@ -223,12 +242,849 @@ bigring_str_test(int size, bigring_free_entry_f fef)
 }
 
 
+static int spsc_free_count__ = 0;
+static void
+spsc_free_entry__(void* p)
+{
+    spsc_free_count__++;
+}
+
+static void
+bigring_spsc_test(int size)
+{
+    bigring_spsc_t* br = bigring_spsc_create(size, spsc_free_entry__);
+    void* entries[256];
+    intptr_t next_in = 1, next_out = 1;
+    int slots, i, n;
+
+    slots = bigring_spsc_size(br);
+    if(slots < size || (slots & (slots - 1)) || slots >= size*2) {
+        AIM_LOG_ERROR("spsc size %d is not the power of 2 above %d", slots, size);
+        abort();
+    }
+
+    /* Fill, then check that the ring refuses more */
+    for(i = 0; i < slots; i++) {
+        if(bigring_spsc_push(br, (void*)next_in++) != 0) {
+            AIM_LOG_ERROR("spsc push failed at %d of %d", i, slots);
+            abort();
+        }
+    }
+    if(bigring_spsc_push(br, (void*)next_in) != -1 ||
+       bigring_spsc_push_n(br, entries, 1) != 0 ||
+       bigring_spsc_count(br) != slots) {
+        AIM_LOG_ERROR("spsc ring of %d accepted an entry when full", slots);
+        abort();
+    }
+
+    /* Bursts of varying size wrap the indices around the ring many times */
+    for(n = 1; n <= 256; n += 7) {
+        int want = n < slots ? n : slots;
+        int got = bigring_spsc_shift_n(br, entries, n);
+        if(got != want) {
+            AIM_LOG_ERROR("spsc shift_n(%d) returned %d, expected %d", n, got, want);
+            abort();
+        }
+        for(i = 0; i < got; i++) {
+            if((intptr_t)entries[i] != next_out++) {
+                AIM_LOG_ERROR("spsc entry mismatch, expected %d", (int)next_out - 1);
+                abort();
+            }
+        }
+        for(i = 0; i < n; i++) {
+            entries[i] = (void*)(next_in + i);
+        }
+        got = bigring_spsc_push_n(br, entries, n);
+        if(got != want) {
+            AIM_LOG_ERROR("spsc push_n(%d) returned %d, expected %d", n, got, want);
+            abort();
+        }
+        next_in += got;
+    }
+
+    /* Drain one at a time */
+    while(bigring_spsc_count(br) > slots/2) {
+        if((intptr_t)bigring_spsc_shift(br) != next_out++) {
+            AIM_LOG_ERROR("spsc entry mismatch, expected %d", (int)next_out - 1);
+            abort();
+        }
+    }
+
+    /* Destroy frees what is left */
+    spsc_free_count__ = 0;
+    n = bigring_spsc_count(br);
+    bigring_spsc_destroy(br);
+    if(spsc_free_count__ != n) {
+        AIM_LOG_ERROR("spsc destroy freed %d entries, expected %d", spsc_free_count__, n);
+        abort();
+    }
+
+    br = bigring_spsc_create(size, NULL);
+    if(bigring_spsc_shift(br) != NULL || bigring_spsc_shift_n(br, entries, 4) != 0) {
+        AIM_LOG_ERROR("spsc shift from an empty ring returned an entry");
+        abort();
+    }
+    bigring_spsc_destroy(br);
+}
+
+#define SPSC_THREAD_COUNT 200000
+
+static void*
+spsc_producer__(void* arg)
+{
+    bigring_spsc_t* br = arg;
+    void* entries[32];
+    intptr_t next = 1;
+    int i, n;
+
+    while(next <= SPSC_THREAD_COUNT) {
+        n = next % 32 + 1;
+        if(n > SPSC_THREAD_COUNT - next + 1) {
+            n = SPSC_THREAD_COUNT - next + 1;
+        }
+        for(i = 0; i < n; i++) {
+            entries[i] = (void*)(next + i);
+        }
+        if(n == 1) {
+            n = bigring_spsc_push(br, entries[0]) == 0;
+        }
+        else {
+            n = bigring_spsc_push_n(br, entries, n);
+        }
+        if(n == 0) {
+            sched_yield();
+        }
+        next += n;
+    }
+    return NULL;
+}
+
+/* Entries must arrive once each and in order across threads */
+static void
+bigring_spsc_thread_test(void)
+{
+    bigring_spsc_t* br = bigring_spsc_create(64, NULL);
+    pthread_t producer;
+    void* entries[16];
+    intptr_t next = 1;
+    int i, n;
+
+    pthread_create(&producer, NULL, spsc_producer__, br);
+    while(next <= SPSC_THREAD_COUNT) {
+        if(next & 1) {
+            entries[0] = bigring_spsc_shift(br);
+            n = entries[0] != NULL;
+        }
+        else {
+            n = bigring_spsc_shift_n(br, entries, 16);
+        }
+        if(n == 0) {
+            sched_yield();
+        }
+        for(i = 0; i < n; i++) {
+            if((intptr_t)entries[i] != next++) {
+                AIM_LOG_ERROR("spsc thread entry mismatch, expected %d got %d",
+                              (int)next - 1, (int)(intptr_t)entries[i]);
+                abort();
+            }
+        }
+    }
+    pthread_join(producer, NULL);
+    bigring_spsc_destroy(br);
+}
+
+static void
+bigring_mpmc_test(int size)
+{
+    bigring_mpmc_t* br = bigring_mpmc_create(size, spsc_free_entry__);
+    intptr_t next_in = 1, next_out = 1;
+    int slots, i, lap;
+
+    slots = bigring_mpmc_size(br);
+    if(slots < size || slots < 2 || (slots & (slots - 1))) {
+        AIM_LOG_ERROR("mpmc size %d is not the power of 2 above %d", slots, size);
+        abort();
+    }
+
+    /* Fill and drain a few laps, checking full and empty each time */
+    for(lap = 0; lap < 3; lap++) {
+        for(i = 0; i < slots; i++) {
+            if(bigring_mpmc_push(br, (void*)next_in++) != 0) {
+                AIM_LOG_ERROR("mpmc push failed at %d of %d", i, slots);
+                abort();
+            }
+        }
+        if(bigring_mpmc_push(br, (void*)next_in) != -1 ||
+           bigring_mpmc_count(br) != slots) {
+            AIM_LOG_ERROR("mpmc ring of %d accepted an entry when full", slots);
+            abort();
+        }
+        for(i = 0; i < slots - lap; i++) {
+            if((intptr_t)bigring_mpmc_shift(br) != next_out++) {
+                AIM_LOG_ERROR("mpmc entry mismatch, expected %d", (int)next_out - 1);
+                abort();
+            }
+        }
+        if(lap == 0 && bigring_mpmc_shift(br) != NULL) {
+            AIM_LOG_ERROR("mpmc shift from an empty ring returned an entry");
+            abort();
+        }
+        /* Leave lap entries behind so the next lap starts mid ring */
+        for(i = 0; i < lap; i++) {
+            if((intptr_t)bigring_mpmc_shift(br) != next_out++) {
+                AIM_LOG_ERROR("mpmc entry mismatch, expected %d", (int)next_out - 1);
+                abort();
+            }
+        }
+        bigring_mpmc_push(br, (void*)next_in++);
+        bigring_mpmc_push(br, (void*)next_in++);
+        if((intptr_t)bigring_mpmc_shift(br) != next_out++ ||
+           (intptr_t)bigring_mpmc_shift(br) != next_out++) {
+            AIM_LOG_ERROR("mpmc entry mismatch after wrap");
+            abort();
+        }
+    }
+
+    /* Destroy frees what is left */
+    for(i = 0; i < slots/2; i++) {
+        bigring_mpmc_push(br, (void*)next_in++);
+    }
+    spsc_free_count__ = 0;
+    bigring_mpmc_destroy(br);
+    if(spsc_free_count__ != slots/2) {
+        AIM_LOG_ERROR("mpmc destroy freed %d entries, expected %d",
+                      spsc_free_count__, slots/2);
+        abort();
+    }
+}
+
+#define MPMC_PRODUCERS 4
+#define MPMC_CONSUMERS 2
+#define MPMC_PER_PRODUCER 50000
+
+typedef struct mpmc_thread_s {
+    bigring_mpmc_t* br;
+    int id;
+    int* remaining;
+    int counts[MPMC_PRODUCERS];
+} mpmc_thread_t;
+
+static void*
+mpmc_producer__(void* arg)
+{
+    mpmc_thread_t* t = arg;
+    intptr_t seq;
+
+    for(seq = 1; seq <= MPMC_PER_PRODUCER; seq++) {
+        while(bigring_mpmc_push(t->br, (void*)(((intptr_t)t->id << 24) | seq)) != 0) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+/* Each consumer must see every producer's entries in order */
+static void*
+mpmc_consumer__(void* arg)
+{
+    mpmc_thread_t* t = arg;
+    intptr_t last[MPMC_PRODUCERS] = { 0 };
+
+    while(__atomic_load_n(t->remaining, __ATOMIC_RELAXED) > 0) {
+        intptr_t v = (intptr_t)bigring_mpmc_shift(t->br);
+        int producer = v >> 24;
+        if(v == 0) {
+            sched_yield();
+            continue;
+        }
+        if((v & 0xffffff) <= last[producer]) {
+            AIM_LOG_ERROR("mpmc producer %d entry %d after %d", producer,
+                          (int)(v & 0xffffff), (int)last[producer]);
+            abort();
+        }
+        last[producer] = v & 0xffffff;
+        t->counts[producer]++;
+        __atomic_sub_fetch(t->remaining, 1, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+static void
+bigring_mpmc_thread_test(void)
+{
+    bigring_mpmc_t* br = bigring_mpmc_create(64, NULL);
+    mpmc_thread_t threads[MPMC_PRODUCERS + MPMC_CONSUMERS];
+    pthread_t tids[MPMC_PRODUCERS + MPMC_CONSUMERS];
+    int remaining = MPMC_PRODUCERS * MPMC_PER_PRODUCER;
+    int i, p, total;
+
+    memset(threads, 0, sizeof(threads));
+    for(i = 0; i < MPMC_PRODUCERS + MPMC_CONSUMERS; i++) {
+        threads[i].br = br;
+        threads[i].id = i;
+        threads[i].remaining = &remaining;
+        pthread_create(&tids[i], NULL,
+                       i < MPMC_PRODUCERS ? mpmc_producer__ : mpmc_consumer__,
+                       &threads[i]);
+    }
+    for(i = 0; i < MPMC_PRODUCERS + MPMC_CONSUMERS; i++) {
+        pthread_join(tids[i], NULL);
+    }
+
+    for(p = 0; p < MPMC_PRODUCERS; p++) {
+        for(i = MPMC_PRODUCERS, total = 0; i < MPMC_PRODUCERS + MPMC_CONSUMERS; i++) {
+            total += threads[i].counts[p];
+        }
+        if(total != MPMC_PER_PRODUCER) {
+            AIM_LOG_ERROR("mpmc producer %d delivered %d entries, expected %d",
+                          p, total, MPMC_PER_PRODUCER);
+            abort();
+        }
+    }
+    if(bigring_mpmc_count(br) != 0) {
+        AIM_LOG_ERROR("mpmc ring not empty after the thread test");
+        abort();
+    }
+    bigring_mpmc_destroy(br);
+}
+
+#if BIGRING_CONFIG_INCLUDE_EVENTFD == 1
+static int
+eventfd_readable__(int efd)
+{
+    struct pollfd fds = { efd, POLLIN, 0 };
+    return poll(&fds, 1, 0) == 1;
+}
+
+static void*
+eventfd_producer__(void* arg)
+{
+    bigring_t* br = arg;
+    os_sleep_usecs(20000);
+    bigring_push(br, (void*)1);
+    return NULL;
+}
+
+static void
+bigring_eventfd_test(void)
+{
+    bigring_t* br = bigring_create(8, NULL);
+    pthread_t producer;
+    eventfd_t v;
+    uint64_t start;
+    int efd;
+    intptr_t c;
+
+    /* Readable exactly while the ring has entries */
+    efd = bigring_eventfd(br);
+    if(efd < 0 || bigring_eventfd(br) != efd || eventfd_readable__(efd)) {
+        AIM_LOG_ERROR("eventfd %d is invalid or readable on an empty ring", efd);
+        abort();
+    }
+    for(c = 1; c <= 20; c++) {
+        bigring_push(br, (void*)c);
+    }
+    if(!eventfd_readable__(efd) || bigring_wait(br, 1000) != 0) {
+        AIM_LOG_ERROR("eventfd not readable after push");
+        abort();
+    }
+    while(bigring_count(br) > 1) {
+        bigring_shift(br);
+        if(!eventfd_readable__(efd)) {
+            AIM_LOG_ERROR("eventfd cleared while the ring has entries");
+            abort();
+        }
+    }
+    bigring_shift(br);
+    if(eventfd_readable__(efd)) {
+        AIM_LOG_ERROR("eventfd readable after the ring was drained");
+        abort();
+    }
+
+    /* Timeouts */
+    start = os_time_monotonic();
+    if(bigring_wait(br, 20000) != -1 || os_time_monotonic() - start < 20000) {
+        AIM_LOG_ERROR("bigring_wait on an empty ring didn't time out");
+        abort();
+    }
+
+    /* Wake a blocked consumer */
+    pthread_create(&producer, NULL, eventfd_producer__, br);
+    if(bigring_wait(br, 0) != 0 || bigring_shift(br) != (void*)1) {
+        AIM_LOG_ERROR("bigring_wait didn't return the pushed entry");
+        abort();
+    }
+    pthread_join(producer, NULL);
+
+    /* A timeout beyond INT_MAX milliseconds still waits */
+    pthread_create(&producer, NULL, eventfd_producer__, br);
+    if(bigring_wait(br, UINT64_MAX) != 0 || bigring_shift(br) != (void*)1) {
+        AIM_LOG_ERROR("bigring_wait with a long timeout didn't return the pushed entry");
+        abort();
+    }
+    pthread_join(producer, NULL);
+
+    /* A burst of pushes is a single write */
+    for(c = 1; c <= 20; c++) {
+        bigring_push(br, (void*)c);
+    }
+    if(eventfd_read(efd, &v) != 0 || v != 1) {
+        AIM_LOG_ERROR("burst of pushes wrote the eventfd %d times", (int)v);
+        abort();
+    }
+    bigring_destroy(br);
+
+    /* Created after entries were pushed */
+    br = bigring_create(8, NULL);
+    bigring_push(br, (void*)1);
+    if(!eventfd_readable__(bigring_eventfd(br))) {
+        AIM_LOG_ERROR("eventfd created on a non-empty ring is not readable");
+        abort();
+    }
+    bigring_destroy(br);
+}
+#endif
+
+#if BIGRING_CONFIG_INCLUDE_SHM == 1
+#define SHM_SLOT_SIZE 200
+#define SHM_PACKETS 100000
+
+static void
+shm_packet_fill__(uint8_t* data, int i)
+{
+    int j, len = i % SHM_SLOT_SIZE;
+    for(j = 0; j < len; j++) {
+        data[j] = i + j;
+    }
+}
+
+static void
+shm_packet_check__(const uint8_t* data, int len, int i)
+{
+    int j;
+    if(len != i % SHM_SLOT_SIZE) {
+        AIM_LOG_ERROR("shm packet %d has length %d", i, len);
+        abort();
+    }
+    for(j = 0; j < len; j++) {
+        if(data[j] != (uint8_t)(i + j)) {
+            AIM_LOG_ERROR("shm packet %d corrupt at byte %d", i, j);
+            abort();
+        }
+    }
+}
+
+/*
+ * Die halfway through initializing the segment: holding the init lock,
+ * with the header not ready. The init word comes first.
+ */
+static void
+shm_die_initializing__(const char* name)
+{
+    int fd = shm_open(name, O_RDWR, 0);
+    uint64_t* init = mmap(NULL, sizeof(*init), PROT_READ | PROT_WRITE,
+                          MAP_SHARED, fd, 0);
+    flock(fd, LOCK_EX);
+    *init = 0;
+    _exit(0);
+}
+
+static void
+bigring_shm_test(void)
+{
+    char name[64];
+    uint8_t buf[SHM_SLOT_SIZE];
+    bigring_shm_t* ring;
+    bigring_shm_t* peer;
+    pid_t pid;
+    int i, len, status;
+    void* slot;
+    const void* data;
+
+    aim_snprintf(name, sizeof(name), "/bigring_utest_%d", (int)getpid());
+    bigring_shm_unlink(name);
+
+    ring = bigring_shm_attach(name, SHM_SLOT_SIZE, 100, 0);
+    if(ring == NULL || bigring_shm_size(ring) != 128 ||
+       bigring_shm_slot_size(ring) != SHM_SLOT_SIZE) {
+        AIM_LOG_ERROR("shm attach failed: %s", strerror(errno));
+        abort();
+    }
+
+    /* Copy in, fill, copy out */
+    for(i = 0; i < 128; i++) {
+        shm_packet_fill__(buf, i);
+        if(bigring_shm_push(ring, buf, i % SHM_SLOT_SIZE) != 0) {
+            AIM_LOG_ERROR("shm push %d failed", i);
+            abort();
+        }
+    }
+    if(bigring_shm_push(ring, buf, 1) != -1 || bigring_shm_reserve(ring) != NULL ||
+       bigring_shm_count(ring) != 128) {
+        AIM_LOG_ERROR("shm ring accepted a packet when full");
+        abort();
+    }
+
+    /* A second attachment sees the same packets */
+    peer = bigring_shm_attach(name, SHM_SLOT_SIZE, 128, 0);
+    if(peer == NULL || bigring_shm_count(peer) != 128) {
+        AIM_LOG_ERROR("shm second attach doesn't see the packets");
+        abort();
+    }
+    for(i = 0; i < 128; i++) {
+        memset(buf, 0, sizeof(buf));
+        len = bigring_shm_shift(peer, buf, sizeof(buf));
+        shm_packet_check__(buf, len, i);
+    }
+    if(bigring_shm_shift(peer, buf, sizeof(buf)) != -1 ||
+       bigring_shm_peek(peer, &len) != NULL) {
+        AIM_LOG_ERROR("shm shift from an empty ring returned a packet");
+        abort();
+    }
+
+    /* In place, and the rejected cases */
+    slot = bigring_shm_reserve(ring);
+    shm_packet_fill__(slot, 150);
+    bigring_shm_commit(ring, 150);
+    data = bigring_shm_peek(peer, &len);
+    if(data == NULL) {
+        AIM_LOG_ERROR("shm peek found no packet");
+        abort();
+    }
+    shm_packet_check__(data, len, 150);
+    bigring_shm_release(peer);
+    if(bigring_shm_reserve(ring) == NULL ||
+       bigring_shm_commit(ring, SHM_SLOT_SIZE + 1) != -1 ||
+       bigring_shm_count(peer) != 0) {
+        AIM_LOG_ERROR("shm commit accepted an oversized packet");
+        abort();
+    }
+    if(bigring_shm_push(ring, buf, SHM_SLOT_SIZE + 1) != -1) {
+        AIM_LOG_ERROR("shm push accepted an oversized packet");
+        abort();
+    }
+    bigring_shm_push(ring, buf, 100);
+    if(bigring_shm_shift(peer, buf, 10) != 100) {
+        AIM_LOG_ERROR("shm shift into a short buffer lost the packet length");
+        abort();
+    }
+    bigring_shm_detach(peer);
+
+    /* A different geometry needs a reset, which empties the ring */
+    bigring_shm_push(ring, buf, 1);
+    if(bigring_shm_attach(name, SHM_SLOT_SIZE, 64, 0) != NULL || errno != EINVAL ||
+       bigring_shm_attach(name, SHM_SLOT_SIZE/2, 128, 0) != NULL) {
+        AIM_LOG_ERROR("shm attach with a different geometry succeeded");
+        abort();
+    }
+    peer = bigring_shm_attach(name, SHM_SLOT_SIZE, 128, BIGRING_SHM_F_RESET);
+    if(peer == NULL || bigring_shm_count(peer) != 0) {
+        AIM_LOG_ERROR("shm reset didn't empty the ring");
+        abort();
+    }
+    bigring_shm_detach(peer);
+    bigring_shm_detach(ring);
+
+    /* An initializer that died is taken over by the next attach */
+    if((pid = fork()) == 0) {
+        shm_die_initializing__(name);
+    }
+    waitpid(pid, &status, 0);
+    ring = bigring_shm_attach(name, SHM_SLOT_SIZE, 128, 0);
+    if(ring == NULL || bigring_shm_count(ring) != 0) {
+        AIM_LOG_ERROR("shm attach didn't recover from a dead initializer");
+        abort();
+    }
+
+    /* Packets cross processes intact and in order */
+    if((pid = fork()) == 0) {
+        bigring_shm_t* producer = bigring_shm_attach(name, SHM_SLOT_SIZE, 128, 0);
+        for(i = 0; i < SHM_PACKETS; i++) {
+            while((slot = bigring_shm_reserve(producer)) == NULL) {
+                sched_yield();
+            }
+            shm_packet_fill__(slot, i);
+            bigring_shm_commit(producer, i % SHM_SLOT_SIZE);
+        }
+        bigring_shm_detach(producer);
+        _exit(0);
+    }
+    for(i = 0; i < SHM_PACKETS; i++) {
+        while((data = bigring_shm_peek(ring, &len)) == NULL) {
+            sched_yield();
+        }
+        shm_packet_check__(data, len, i);
+        bigring_shm_release(ring);
+    }
+    waitpid(pid, &status, 0);
+    if(!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        AIM_LOG_ERROR("shm producer process failed");
+        abort();
+    }
+
+    bigring_shm_detach(ring);
+    bigring_shm_unlink(name);
+}
+
+/* Packets per second between two processes, copied in and out */
+static void
+bigring_shm_perftest(int count, int packet_size)
+{
+    char name[64];
+    uint8_t buf[2048];
+    bigring_shm_t* ring;
+    uint64_t start;
+    pid_t pid;
+    int i, status;
+
+    aim_snprintf(name, sizeof(name), "/bigring_perf_%d", (int)getpid());
+    ring = bigring_shm_attach(name, sizeof(buf), 1024, BIGRING_SHM_F_RESET);
+    memset(buf, 0x5a, sizeof(buf));
+
+    start = os_time_monotonic();
+    if((pid = fork()) == 0) {
+        bigring_shm_t* producer = bigring_shm_attach(name, sizeof(buf), 1024, 0);
+        for(i = 0; i < count; i++) {
+            while(bigring_shm_push(producer, buf, packet_size) != 0) {
+                sched_yield();
+            }
+        }
+        _exit(0);
+    }
+    for(i = 0; i < count; i++) {
+        while(bigring_shm_shift(ring, buf, sizeof(buf)) < 0) {
+            sched_yield();
+        }
+    }
+    waitpid(pid, &status, 0);
+
+    aim_printf(&aim_pvs_stdout, "%d packets of %d bytes between processes (Mpps) %6.2f\n",
+               count, packet_size, count / (double)(os_time_monotonic() - start));
+
+    bigring_shm_detach(ring);
+    bigring_shm_unlink(name);
+}
+#endif
+
+/*
+ * Ping-pong throughput. Entries travel to a worker on one ring and
+ * back on another, with a fixed number in flight. The locked rings
+ * use bigring_push and bigring_shift; the window stays below the ring
+ * size so they never overwrite.
+ */
+#define PERF_RING_SIZE 1024
+#define PERF_WINDOW 512
+#define PERF_BURST 32
+
+typedef struct perf_rings_s {
+    bigring_t* locked[2];
+    bigring_spsc_t* spsc[2];
+    int burst;
+    int count;
+} perf_rings_t;
+
+static int
+perf_pass__(perf_rings_t* p, int from, int to, void** entries, int max)
+{
+    int i, n;
+
+    if(p->spsc[0] == NULL) {
+        for(n = 0; n < max && (entries[n] = bigring_shift(p->locked[from])); n++);
+        for(i = 0; i < n; i++) {
+            bigring_push(p->locked[to], entries[i]);
+        }
+    }
+    else if(p->burst) {
+        n = bigring_spsc_shift_n(p->spsc[from], entries, max);
+        /* Room is guaranteed by the window */
+        bigring_spsc_push_n(p->spsc[to], entries, n);
+    }
+    else {
+        for(n = 0; n < max && (entries[n] = bigring_spsc_shift(p->spsc[from])); n++);
+        for(i = 0; i < n; i++) {
+            bigring_spsc_push(p->spsc[to], entries[i]);
+        }
+    }
+
+    if(n == 0) {
+        sched_yield();
+    }
+    return n;
+}
+
+static void*
+perf_worker__(void* arg)
+{
+    perf_rings_t* p = arg;
+    void* entries[PERF_BURST];
+    int done = 0;
+
+    while(done < p->count) {
+        done += perf_pass__(p, 0, 1, entries, PERF_BURST);
+    }
+    return NULL;
+}
+
+static double
+perf_run__(perf_rings_t* p)
+{
+    void* entries[PERF_BURST];
+    pthread_t worker;
+    uint64_t start;
+    intptr_t i;
+    int done = 0;
+
+    /* Prime the forward ring with the window, then keep it circulating */
+    for(i = 1; i <= PERF_WINDOW; i++) {
+        if(p->spsc[0]) {
+            bigring_spsc_push(p->spsc[0], (void*)i);
+        }
+        else {
+            bigring_push(p->locked[0], (void*)i);
+        }
+    }
+
+    start = os_time_monotonic();
+    pthread_create(&worker, NULL, perf_worker__, p);
+    while(done < p->count) {
+        int max = p->count - done < PERF_BURST ? p->count - done : PERF_BURST;
+        done += perf_pass__(p, 1, 0, entries, max);
+    }
+    pthread_join(worker, NULL);
+    return p->count / (double)(os_time_monotonic() - start);
+}
+
+/*
+ * Fan-in throughput, several producers feeding one consumer. The rings
+ * hold every entry so the locked ring never overwrites and the MPMC
+ * ring never refuses a push.
+ */
+typedef struct fanin_s {
+    bigring_t* locked;
+    bigring_mpmc_t* mpmc;
+    int per_producer;
+} fanin_t;
+
+static void*
+fanin_producer__(void* arg)
+{
+    fanin_t* f = arg;
+    intptr_t i;
+
+    for(i = 1; i <= f->per_producer; i++) {
+        if(f->mpmc) {
+            bigring_mpmc_push(f->mpmc, (void*)i);
+        }
+        else {
+            bigring_push(f->locked, (void*)i);
+        }
+    }
+    return NULL;
+}
+
+static double
+fanin_run__(fanin_t* f, int nproducers)
+{
+    pthread_t tids[16];
+    uint64_t start = os_time_monotonic();
+    int total = f->per_producer * nproducers;
+    int done = 0, i;
+
+    for(i = 0; i < nproducers; i++) {
+        pthread_create(&tids[i], NULL, fanin_producer__, f);
+    }
+    while(done < total) {
+        void* e = f->mpmc ? bigring_mpmc_shift(f->mpmc) : bigring_shift(f->locked);
+        if(e == NULL) {
+            sched_yield();
+            continue;
+        }
+        done++;
+    }
+    for(i = 0; i < nproducers; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    return total / (double)(os_time_monotonic() - start);
+}
+
+static void
+bigring_fanin_perftest(int per_producer)
+{
+    fanin_t f;
+    int nproducers;
+
+    aim_printf(&aim_pvs_stdout, "%d entries/producer (Mops/s)  locked    mpmc\n",
+               per_producer);
+    for(nproducers = 1; nproducers <= 16; nproducers *= 2) {
+        double locked = 0, mpmc;
+
+        memset(&f, 0, sizeof(f));
+        f.per_producer = per_producer;
+#if BIGRING_CONFIG_INCLUDE_LOCKING == 1
+        f.locked = bigring_create(per_producer * nproducers, NULL);
+        locked = fanin_run__(&f, nproducers);
+        bigring_destroy(f.locked);
+        f.locked = NULL;
+#endif
+        f.mpmc = bigring_mpmc_create(per_producer * nproducers, NULL);
+        mpmc = fanin_run__(&f, nproducers);
+        bigring_mpmc_destroy(f.mpmc);
+
+        aim_printf(&aim_pvs_stdout, "  %2d producers %18.2f %7.2f\n",
+                   nproducers, locked, mpmc);
+    }
+}
+
+static void
+bigring_perftest(int count)
+{
+    perf_rings_t p;
+    double locked = 0, spsc, spsc_burst;
+
+    memset(&p, 0, sizeof(p));
+    p.count = count;
+
+#if BIGRING_CONFIG_INCLUDE_LOCKING == 1
+    p.locked[0] = bigring_create(PERF_RING_SIZE, NULL);
+    p.locked[1] = bigring_create(PERF_RING_SIZE, NULL);
+    locked = perf_run__(&p);
+    bigring_destroy(p.locked[0]);
+    bigring_destroy(p.locked[1]);
+#endif
+
+    p.spsc[0] = bigring_spsc_create(PERF_RING_SIZE, NULL);
+    p.spsc[1] = bigring_spsc_create(PERF_RING_SIZE, NULL);
+    spsc = perf_run__(&p);
+    bigring_spsc_destroy(p.spsc[0]);
+    bigring_spsc_destroy(p.spsc[1]);
+
+    p.burst = 1;
+    p.spsc[0] = bigring_spsc_create(PERF_RING_SIZE, NULL);
+    p.spsc[1] = bigring_spsc_create(PERF_RING_SIZE, NULL);
+    spsc_burst = perf_run__(&p);
+    bigring_spsc_destroy(p.spsc[0]);
+    bigring_spsc_destroy(p.spsc[1]);
+
+    aim_printf(&aim_pvs_stdout, "%d round trips (Mops/s)  locked %6.2f  spsc %6.2f  spsc burst %6.2f\n",
+               count, locked, spsc, spsc_burst);
+}
+
 int aim_main(int argc, char* argv[])
 {
     int size_min = 1, size_max = 65;
     int count_min = 1, count_max = 129;
     int s, c;
 
+    if(argc > 1 && !strcmp(argv[1], "perf")) {
+        bigring_perftest(2*1000*1000);
+        bigring_fanin_perftest(200000);
+#if BIGRING_CONFIG_INCLUDE_SHM == 1
+        bigring_shm_perftest(2*1000*1000, 64);
+        bigring_shm_perftest(1000*1000, 1500);
+#endif
+        return 0;
+    }
+
     bigring_config_show(&aim_pvs_stdout);
     for(s = size_min; s <= size_max; s++) {
         for(c = count_min; c <= count_max; c++) {
@@ -244,6 +1100,22 @@ int aim_main(int argc, char* argv[])
         AIM_LOG_MSG("StrTest(%d, default)", s);
         bigring_str_test(s, bigring_aim_free_entry);
     }
+    for(s = 1; s <= 130; s++) {
+        AIM_LOG_MSG("SpscTest(%d)", s);
+        bigring_spsc_test(s);
+    }
+    bigring_spsc_thread_test();
+    for(s = 1; s <= 130; s++) {
+        AIM_LOG_MSG("MpmcTest(%d)", s);
+        bigring_mpmc_test(s);
+    }
+    bigring_mpmc_thread_test();
+#if BIGRING_CONFIG_INCLUDE_EVENTFD == 1
+    bigring_eventfd_test();
+#endif
+#if BIGRING_CONFIG_INCLUDE_SHM == 1
+    bigring_shm_test();
+#endif
     bigring_config_show(&aim_pvs_stdout);
     return 0;
 }
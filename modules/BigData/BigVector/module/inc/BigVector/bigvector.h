@@ -0,0 +1,215 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+/************************************************************//**
+ *
+ * @file
+ * @brief Growable array of data pointers.
+ *
+ * A bigvector_t keeps its data pointers in one contiguous array, so
+ * length, indexing and the last element are O(1), and iteration and
+ * sorting touch memory sequentially instead of chasing list links.
+ *
+ * Compare, iterator and free functions have the BigList signatures and
+ * receive the data pointers, so functions written for a biglist_t work
+ * unchanged. bigvector_from_biglist and bigvector_to_biglist convert
+ * between the two, keeping the order.
+ *
+ * The vector does no locking.
+ *
+ * @addtogroup bigvector-bigvector
+ * @{
+ *
+ ***************************************************************/
+#ifndef __BIGVECTOR_H__
+#define __BIGVECTOR_H__
+
+#include <BigVector/bigvector_config.h>
+#include <BigList/biglist.h>
+
+/**
+ * Vector head.
+ */
+typedef struct bigvector_s {
+    /** Data pointers */
+    void** data;
+    /** Number of elements in use */
+    int count;
+    /** Number of elements allocated */
+    int size;
+} bigvector_t;
+
+/**
+ * @brief Create a vector.
+ * @param size Initial number of elements to allocate, or 0.
+ * @returns The new, empty vector.
+ */
+bigvector_t* bigvector_create(int size);
+
+/**
+ * @brief Destroy a vector.
+ * @param bv The vector.
+ * @param free The data free function (optional).
+ */
+void bigvector_destroy(bigvector_t* bv, biglist_free_f free);
+
+/**
+ * @brief Make room for at least size elements.
+ * @param bv The vector.
+ * @param size The number of elements.
+ */
+void bigvector_reserve(bigvector_t* bv, int size);
+
+/**
+ * @brief Remove all elements. The data is not freed.
+ * @param bv The vector.
+ */
+static inline void
+bigvector_clear(bigvector_t* bv)
+{
+    bv->count = 0;
+}
+
+/**
+ * @brief Get the number of elements.
+ * @param bv The vector.
+ */
+static inline int
+bigvector_length(bigvector_t* bv)
+{
+    return bv->count;
+}
+
+/**
+ * @brief Get the data at an index.
+ * @param bv The vector.
+ * @param index The index, which must be less than the length.
+ */
+static inline void*
+bigvector_get(bigvector_t* bv, int index)
+{
+    return bv->data[index];
+}
+
+/**
+ * @brief Get the last data pointer.
+ * @param bv The vector.
+ * @returns The data, or NULL if the vector is empty.
+ */
+static inline void*
+bigvector_last(bigvector_t* bv)
+{
+    return bv->count ? bv->data[bv->count - 1] : NULL;
+}
+
+/**
+ * @brief Append data to the vector.
+ * @param bv The vector.
+ * @param data The data.
+ * @returns The index of the new element.
+ */
+int bigvector_append(bigvector_t* bv, void* data);
+
+/**
+ * @brief Remove an element by moving the last element into its place.
+ * @param bv The vector.
+ * @param index The index of the element.
+ * @returns The removed data.
+ * @note This does not keep the order of the remaining elements.
+ */
+void* bigvector_remove_swap(bigvector_t* bv, int index);
+
+/**
+ * @brief Find data by pointer.
+ * @param bv The vector.
+ * @param data The data.
+ * @returns The index of the first matching element, or -1.
+ */
+int bigvector_find(bigvector_t* bv, void* data);
+
+/**
+ * @brief Find and remove data, as with bigvector_remove_swap.
+ * @param bv The vector.
+ * @param data The data.
+ * @returns 0 if the data was found and removed, -1 otherwise.
+ */
+int bigvector_remove(bigvector_t* bv, void* data);
+
+/**
+ * @brief Insert data into a sorted vector.
+ * @param bv The vector, sorted by cmp.
+ * @param data The data.
+ * @param cmp The compare function.
+ * @returns The index of the new element.
+ * @note The data is inserted after any elements that compare equal.
+ */
+int bigvector_insert_sorted(bigvector_t* bv, void* data, biglist_compare_f cmp);
+
+/**
+ * @brief Binary search a sorted vector.
+ * @param bv The vector, sorted by cmp.
+ * @param key The data to compare against.
+ * @param cmp The compare function.
+ * @returns The index of the first element equal to key, or -1.
+ */
+int bigvector_find_sorted(bigvector_t* bv, const void* key, biglist_compare_f cmp);
+
+/**
+ * @brief Sort the vector.
+ * @param bv The vector.
+ * @param cmp The compare function.
+ * @note The sort is stable, as is biglist_sort.
+ */
+void bigvector_sort(bigvector_t* bv, biglist_compare_f cmp);
+
+/**
+ * @brief Iterate over all elements in order.
+ * @param bv The vector.
+ * @param iter The iteration function.
+ * @param cookie Cookie passed to your iterator.
+ * @returns 0 if all elements were processed, or the negative value
+ * returned by iter that stopped the iteration, as biglist_foreach.
+ */
+int bigvector_foreach(bigvector_t* bv, biglist_iter_f iter, void* cookie);
+
+/**
+ * @brief Create a vector with the data of a list, in list order.
+ * @param bl The list, which is not modified.
+ * @returns The new vector.
+ */
+bigvector_t* bigvector_from_biglist(biglist_t* bl);
+
+/**
+ * @brief Create a list with the data of a vector, in vector order.
+ * @param bv The vector, which is not modified.
+ * @returns The new list. Free it with biglist_free.
+ */
+biglist_t* bigvector_to_biglist(bigvector_t* bv);
+
+/**
+ * Iterate over all data pointers in the vector.
+ * The vector must not be changed during the iteration.
+ */
+#define BIGVECTOR_FOREACH(_index, _bigvector, _data)                    \
+    for(_index = 0;                                                     \
+        _index < (_bigvector)->count &&                                 \
+            ((_data = (_bigvector)->data[_index]), 1);                  \
+        _index++)
+
+#endif /* __BIGVECTOR_H__ */
+/* @} */
@@ -0,0 +1,135 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+/************************************************************//**
+ *
+ * @file
+ * @brief BigVector Configuration Header
+ *
+ * @addtogroup bigvector-config
+ * @{
+ *
+ ***************************************************************/
+#ifndef __BIGVECTOR_CONFIG_H__
+#define __BIGVECTOR_CONFIG_H__
+
+#ifdef GLOBAL_INCLUDE_CUSTOM_CONFIG
+#include <global_custom_config.h>
+#endif
+#ifdef BIGVECTOR_INCLUDE_CUSTOM_CONFIG
+#include <bigvector_custom_config.h>
+#endif
+
+/* <auto.start.cdefs(BIGVECTOR_CONFIG_HEADER).header> */
+#include <AIM/aim.h>
+/**
+ * BIGVECTOR_CONFIG_INCLUDE_LOGGING
+ *
+ * Include or exclude logging. */
+
+
+#ifndef BIGVECTOR_CONFIG_INCLUDE_LOGGING
+#define BIGVECTOR_CONFIG_INCLUDE_LOGGING 1
+#endif
+
+/**
+ * BIGVECTOR_CONFIG_LOG_OPTIONS_DEFAULT
+ *
+ * Default enabled log options. */
+
+
+#ifndef BIGVECTOR_CONFIG_LOG_OPTIONS_DEFAULT
+#define BIGVECTOR_CONFIG_LOG_OPTIONS_DEFAULT AIM_LOG_OPTIONS_DEFAULT
+#endif
+
+/**
+ * BIGVECTOR_CONFIG_LOG_BITS_DEFAULT
+ *
+ * Default enabled log bits. */
+
+
+#ifndef BIGVECTOR_CONFIG_LOG_BITS_DEFAULT
+#define BIGVECTOR_CONFIG_LOG_BITS_DEFAULT AIM_LOG_BITS_DEFAULT
+#endif
+
+/**
+ * BIGVECTOR_CONFIG_LOG_CUSTOM_BITS_DEFAULT
+ *
+ * Default enabled custom log bits. */
+
+
+#ifndef BIGVECTOR_CONFIG_LOG_CUSTOM_BITS_DEFAULT
+#define BIGVECTOR_CONFIG_LOG_CUSTOM_BITS_DEFAULT 0
+#endif
+
+/**
+ * BIGVECTOR_CONFIG_PORTING_STDLIB
+ *
+ * Default all porting macros to use the C standard libraries. */
+
+
+#ifndef BIGVECTOR_CONFIG_PORTING_STDLIB
+#define BIGVECTOR_CONFIG_PORTING_STDLIB 1
+#endif
+
+/**
+ * BIGVECTOR_CONFIG_PORTING_INCLUDE_STDLIB_HEADERS
+ *
+ * Include standard library headers for stdlib porting macros. */
+
+
+#ifndef BIGVECTOR_CONFIG_PORTING_INCLUDE_STDLIB_HEADERS
+#define BIGVECTOR_CONFIG_PORTING_INCLUDE_STDLIB_HEADERS BIGVECTOR_CONFIG_PORTING_STDLIB
+#endif
+
+
+
+/**
+ * All compile time options can be queried or displayed
+ */
+
+/** Configuration settings structure. */
+typedef struct bigvector_config_settings_s {
+    /** name */
+    const char* name;
+    /** value */
+    const char* value;
+} bigvector_config_settings_t;
+
+/** Configuration settings table. */
+/** bigvector_config_settings table. */
+extern bigvector_config_settings_t bigvector_config_settings[];
+
+/**
+ * @brief Lookup a configuration setting.
+ * @param setting The name of the configuration option to lookup.
+ */
+const char* bigvector_config_lookup(const char* setting);
+
+/**
+ * @brief Show the compile-time configuration.
+ * @param pvs The output stream.
+ */
+int bigvector_config_show(struct aim_pvs_s* pvs);
+
+/* <auto.end.cdefs(BIGVECTOR_CONFIG_HEADER).header> */
+
+#include "bigvector_porting.h"
+
+#endif /* __BIGVECTOR_CONFIG_H__ */
+/* @} */
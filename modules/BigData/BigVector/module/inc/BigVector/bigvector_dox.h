@@ -0,0 +1,40 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+
+#ifndef __BIGVECTOR_DOX_H__
+#define __BIGVECTOR_DOX_H__
+
+/**
+ * @defgroup BigVector BigVector - BigVector Description
+ *
+
+Provides a growable array of data pointers.
+
+ *
+ * @{
+ *
+ * @defgroup bigvector-bigvector Public Interface
+ * @defgroup bigvector-config Compile Time Configuration
+ * @defgroup bigvector-porting Porting Macros
+ *
+ * @}
+ *
+ */
+
+#endif /* __BIGVECTOR_DOX_H__ */
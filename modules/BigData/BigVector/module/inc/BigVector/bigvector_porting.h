@@ -0,0 +1,95 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+/************************************************************//**
+ *
+ * @file
+ * @brief BigVector Porting Macros.
+ *
+ * @addtogroup bigvector_porting
+ * @{
+ *
+ ***************************************************************/
+#ifndef __BIGVECTOR_PORTING_H__
+#define __BIGVECTOR_PORTING_H__
+
+
+/* <auto.start.portingmacro(ALL).define> */
+#if BIGVECTOR_CONFIG_PORTING_INCLUDE_STDLIB_HEADERS == 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <memory.h>
+#endif
+
+#ifndef BIGVECTOR_MEMSET
+    #if defined(GLOBAL_MEMSET)
+        #define BIGVECTOR_MEMSET GLOBAL_MEMSET
+    #elif BIGVECTOR_CONFIG_PORTING_STDLIB == 1
+        #define BIGVECTOR_MEMSET memset
+    #else
+        #error The macro BIGVECTOR_MEMSET is required but cannot be defined.
+    #endif
+#endif
+
+#ifndef BIGVECTOR_MEMCPY
+    #if defined(GLOBAL_MEMCPY)
+        #define BIGVECTOR_MEMCPY GLOBAL_MEMCPY
+    #elif BIGVECTOR_CONFIG_PORTING_STDLIB == 1
+        #define BIGVECTOR_MEMCPY memcpy
+    #else
+        #error The macro BIGVECTOR_MEMCPY is required but cannot be defined.
+    #endif
+#endif
+
+#ifndef BIGVECTOR_MEMMOVE
+    #if defined(GLOBAL_MEMMOVE)
+        #define BIGVECTOR_MEMMOVE GLOBAL_MEMMOVE
+    #elif BIGVECTOR_CONFIG_PORTING_STDLIB == 1
+        #define BIGVECTOR_MEMMOVE memmove
+    #else
+        #error The macro BIGVECTOR_MEMMOVE is required but cannot be defined.
+    #endif
+#endif
+
+#ifndef BIGVECTOR_STRNCPY
+    #if defined(GLOBAL_STRNCPY)
+        #define BIGVECTOR_STRNCPY GLOBAL_STRNCPY
+    #elif BIGVECTOR_CONFIG_PORTING_STDLIB == 1
+        #define BIGVECTOR_STRNCPY strncpy
+    #else
+        #error The macro BIGVECTOR_STRNCPY is required but cannot be defined.
+    #endif
+#endif
+
+#ifndef BIGVECTOR_STRLEN
+    #if defined(GLOBAL_STRLEN)
+        #define BIGVECTOR_STRLEN GLOBAL_STRLEN
+    #elif BIGVECTOR_CONFIG_PORTING_STDLIB == 1
+        #define BIGVECTOR_STRLEN strlen
+    #else
+        #error The macro BIGVECTOR_STRLEN is required but cannot be defined.
+    #endif
+#endif
+
+/* <auto.end.portingmacro(ALL).define> */
+
+
+#endif /* __BIGVECTOR_PORTING_H__ */
+/* @} */
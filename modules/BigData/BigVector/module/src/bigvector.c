@@ -0,0 +1,261 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+
+#include <BigVector/bigvector.h>
+
+#define BIGVECTOR_MIN_SIZE 8
+
+/* Runs this short are insertion sorted before merging */
+#define BIGVECTOR_SORT_RUN 16
+
+bigvector_t*
+bigvector_create(int size)
+{
+    bigvector_t* bv = aim_zmalloc(sizeof(*bv));
+    if(size > 0) {
+        bigvector_reserve(bv, size);
+    }
+    return bv;
+}
+
+void
+bigvector_destroy(bigvector_t* bv, biglist_free_f free_data)
+{
+    int i;
+
+    if(bv == NULL) {
+        return;
+    }
+    if(free_data) {
+        for(i = 0; i < bv->count; i++) {
+            free_data(bv->data[i]);
+        }
+    }
+    aim_free(bv->data);
+    aim_free(bv);
+}
+
+void
+bigvector_reserve(bigvector_t* bv, int size)
+{
+    int new_size;
+
+    if(size <= bv->size) {
+        return;
+    }
+
+    new_size = bv->size ? bv->size : BIGVECTOR_MIN_SIZE;
+    while(new_size < size) {
+        new_size *= 2;
+    }
+
+    bv->data = aim_realloc(bv->data, sizeof(bv->data[0]) * new_size);
+    bv->size = new_size;
+}
+
+int
+bigvector_append(bigvector_t* bv, void* data)
+{
+    if(bv->count == bv->size) {
+        bigvector_reserve(bv, bv->count + 1);
+    }
+    bv->data[bv->count] = data;
+    return bv->count++;
+}
+
+void*
+bigvector_remove_swap(bigvector_t* bv, int index)
+{
+    void* data = bv->data[index];
+    bv->data[index] = bv->data[--bv->count];
+    return data;
+}
+
+int
+bigvector_find(bigvector_t* bv, void* data)
+{
+    int i;
+    for(i = 0; i < bv->count; i++) {
+        if(bv->data[i] == data) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int
+bigvector_remove(bigvector_t* bv, void* data)
+{
+    int i = bigvector_find(bv, data);
+    if(i < 0) {
+        return -1;
+    }
+    bigvector_remove_swap(bv, i);
+    return 0;
+}
+
+/*
+ * Index of the first element greater than key, or with upper == 0, of
+ * the first element not less than key.
+ */
+static int
+bigvector_bound__(bigvector_t* bv, const void* key, biglist_compare_f cmp,
+                  int upper)
+{
+    int lo = 0, hi = bv->count;
+
+    while(lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        int c = cmp(bv->data[mid], key);
+        if(c < 0 || (upper && c == 0)) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+int
+bigvector_insert_sorted(bigvector_t* bv, void* data, biglist_compare_f cmp)
+{
+    int i = bigvector_bound__(bv, data, cmp, 1);
+
+    if(bv->count == bv->size) {
+        bigvector_reserve(bv, bv->count + 1);
+    }
+    BIGVECTOR_MEMMOVE(&bv->data[i + 1], &bv->data[i],
+                      sizeof(bv->data[0]) * (bv->count - i));
+    bv->data[i] = data;
+    bv->count++;
+    return i;
+}
+
+int
+bigvector_find_sorted(bigvector_t* bv, const void* key, biglist_compare_f cmp)
+{
+    int i = bigvector_bound__(bv, key, cmp, 0);
+    if(i < bv->count && cmp(bv->data[i], key) == 0) {
+        return i;
+    }
+    return -1;
+}
+
+static void
+bigvector_insertion_sort__(void** data, int count, biglist_compare_f cmp)
+{
+    int i, j;
+    for(i = 1; i < count; i++) {
+        void* cur = data[i];
+        for(j = i; j > 0 && cmp(data[j - 1], cur) > 0; j--) {
+            data[j] = data[j - 1];
+        }
+        data[j] = cur;
+    }
+}
+
+/*
+ * Bottom up merge sort. Runs are insertion sorted in place, then merged
+ * back and forth between the vector and a scratch array. Taking from the
+ * left run on ties keeps the sort stable.
+ */
+void
+bigvector_sort(bigvector_t* bv, biglist_compare_f cmp)
+{
+    void** src = bv->data;
+    void** dst;
+    void** tmp;
+    int count = bv->count;
+    int width, i;
+
+    for(i = 0; i < count; i += BIGVECTOR_SORT_RUN) {
+        bigvector_insertion_sort__(&src[i], aim_imin(BIGVECTOR_SORT_RUN, count - i), cmp);
+    }
+    if(count <= BIGVECTOR_SORT_RUN) {
+        return;
+    }
+
+    tmp = aim_malloc(sizeof(src[0]) * count);
+    dst = tmp;
+
+    for(width = BIGVECTOR_SORT_RUN; width < count; width *= 2) {
+        for(i = 0; i < count; i += 2 * width) {
+            int l = i, mid = aim_imin(i + width, count);
+            int r = mid, end = aim_imin(i + 2 * width, count);
+            int o = i;
+
+            while(l < mid && r < end) {
+                dst[o++] = cmp(src[r], src[l]) < 0 ? src[r++] : src[l++];
+            }
+            while(l < mid) {
+                dst[o++] = src[l++];
+            }
+            while(r < end) {
+                dst[o++] = src[r++];
+            }
+        }
+        /* The merged runs become the source of the next pass */
+        dst = src;
+        src = (src == bv->data) ? tmp : bv->data;
+    }
+
+    if(src != bv->data) {
+        BIGVECTOR_MEMCPY(bv->data, src, sizeof(src[0]) * count);
+    }
+    aim_free(tmp);
+}
+
+int
+bigvector_foreach(bigvector_t* bv, biglist_iter_f iter, void* cookie)
+{
+    int i, rv;
+    for(i = 0; i < bv->count; i++) {
+        rv = iter(bv->data[i], cookie);
+        if(rv < 0) {
+            return rv;
+        }
+    }
+    return 0;
+}
+
+bigvector_t*
+bigvector_from_biglist(biglist_t* bl)
+{
+    bigvector_t* bv = bigvector_create(0);
+    biglist_t* ble;
+
+    BIGLIST_FOREACH(ble, bl) {
+        bigvector_append(bv, ble->data);
+    }
+    return bv;
+}
+
+biglist_t*
+bigvector_to_biglist(bigvector_t* bv)
+{
+    biglist_t* bl = NULL;
+    int i;
+
+    /* Prepend from the back so each step is O(1) */
+    for(i = bv->count - 1; i >= 0; i--) {
+        bl = biglist_prepend(bl, bv->data[i]);
+    }
+    return bl;
+}
@@ -0,0 +1,85 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+
+#include <BigVector/bigvector_config.h>
+
+/* <auto.start.cdefs(BIGVECTOR_CONFIG_HEADER).source> */
+#define __bigvector_config_STRINGIFY_NAME(_x) #_x
+#define __bigvector_config_STRINGIFY_VALUE(_x) __bigvector_config_STRINGIFY_NAME(_x)
+bigvector_config_settings_t bigvector_config_settings[] =
+{
+#ifdef BIGVECTOR_CONFIG_INCLUDE_LOGGING
+    { __bigvector_config_STRINGIFY_NAME(BIGVECTOR_CONFIG_INCLUDE_LOGGING), __bigvector_config_STRINGIFY_VALUE(BIGVECTOR_CONFIG_INCLUDE_LOGGING) },
+#else
+{ BIGVECTOR_CONFIG_INCLUDE_LOGGING(__bigvector_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef BIGVECTOR_CONFIG_LOG_OPTIONS_DEFAULT
+    { __bigvector_config_STRINGIFY_NAME(BIGVECTOR_CONFIG_LOG_OPTIONS_DEFAULT), __bigvector_config_STRINGIFY_VALUE(BIGVECTOR_CONFIG_LOG_OPTIONS_DEFAULT) },
+#else
+{ BIGVECTOR_CONFIG_LOG_OPTIONS_DEFAULT(__bigvector_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef BIGVECTOR_CONFIG_LOG_BITS_DEFAULT
+    { __bigvector_config_STRINGIFY_NAME(BIGVECTOR_CONFIG_LOG_BITS_DEFAULT), __bigvector_config_STRINGIFY_VALUE(BIGVECTOR_CONFIG_LOG_BITS_DEFAULT) },
+#else
+{ BIGVECTOR_CONFIG_LOG_BITS_DEFAULT(__bigvector_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef BIGVECTOR_CONFIG_LOG_CUSTOM_BITS_DEFAULT
+    { __bigvector_config_STRINGIFY_NAME(BIGVECTOR_CONFIG_LOG_CUSTOM_BITS_DEFAULT), __bigvector_config_STRINGIFY_VALUE(BIGVECTOR_CONFIG_LOG_CUSTOM_BITS_DEFAULT) },
+#else
+{ BIGVECTOR_CONFIG_LOG_CUSTOM_BITS_DEFAULT(__bigvector_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef BIGVECTOR_CONFIG_PORTING_STDLIB
+    { __bigvector_config_STRINGIFY_NAME(BIGVECTOR_CONFIG_PORTING_STDLIB), __bigvector_config_STRINGIFY_VALUE(BIGVECTOR_CONFIG_PORTING_STDLIB) },
+#else
+{ BIGVECTOR_CONFIG_PORTING_STDLIB(__bigvector_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef BIGVECTOR_CONFIG_PORTING_INCLUDE_STDLIB_HEADERS
+    { __bigvector_config_STRINGIFY_NAME(BIGVECTOR_CONFIG_PORTING_INCLUDE_STDLIB_HEADERS), __bigvector_config_STRINGIFY_VALUE(BIGVECTOR_CONFIG_PORTING_INCLUDE_STDLIB_HEADERS) },
+#else
+{ BIGVECTOR_CONFIG_PORTING_INCLUDE_STDLIB_HEADERS(__bigvector_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+    { NULL, NULL }
+};
+#undef __bigvector_config_STRINGIFY_VALUE
+#undef __bigvector_config_STRINGIFY_NAME
+
+const char*
+bigvector_config_lookup(const char* setting)
+{
+    int i;
+    for(i = 0; bigvector_config_settings[i].name; i++) {
+        if(!strcmp(bigvector_config_settings[i].name, setting)) {
+            return bigvector_config_settings[i].value;
+        }
+    }
+    return NULL;
+}
+
+int
+bigvector_config_show(struct aim_pvs_s* pvs)
+{
+    int i;
+    for(i = 0; bigvector_config_settings[i].name; i++) {
+        aim_printf(pvs, "%s = %s\n", bigvector_config_settings[i].name, bigvector_config_settings[i].value);
+    }
+    return i;
+}
+
+/* <auto.end.cdefs(BIGVECTOR_CONFIG_HEADER).source> */
+
@@ -0,0 +1,262 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+
+#include <BigVector/bigvector_config.h>
+#include <BigVector/bigvector.h>
+#include <AIM/aim.h>
+#include <OS/os_time.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define IP(i) ( (void*)(long)(i) )
+#define PI(i) ( (int)(long)(i) )
+
+/* Orders data by value and ignores the low bit, to check stability */
+static int
+compare_pair__(const void* a, const void* b)
+{
+    return (PI(a) >> 1) - (PI(b) >> 1);
+}
+
+static int
+compare_int__(const void* a, const void* b)
+{
+    return PI(a) < PI(b) ? -1 : PI(a) > PI(b);
+}
+
+static int
+sum__(void* data, void* cookie)
+{
+    *(long*)cookie += PI(data);
+    return 0;
+}
+
+static int
+stop_at_ten__(void* data, void* cookie)
+{
+    (void)cookie;
+    return PI(data) == 10 ? -2 : 0;
+}
+
+static void
+bigvector_basic_test(void)
+{
+    bigvector_t* bv = bigvector_create(0);
+    void* data;
+    long sum = 0;
+    int i;
+
+    AIM_TRUE_OR_DIE(bigvector_length(bv) == 0 && bigvector_last(bv) == NULL);
+
+    for(i = 0; i < 100; i++) {
+        AIM_TRUE_OR_DIE(bigvector_append(bv, IP(i)) == i);
+    }
+    AIM_TRUE_OR_DIE(bigvector_length(bv) == 100 && bv->size >= 100);
+    AIM_TRUE_OR_DIE(PI(bigvector_get(bv, 42)) == 42);
+    AIM_TRUE_OR_DIE(PI(bigvector_last(bv)) == 99);
+
+    BIGVECTOR_FOREACH(i, bv, data) {
+        AIM_TRUE_OR_DIE(PI(data) == i);
+    }
+    AIM_TRUE_OR_DIE(bigvector_foreach(bv, sum__, &sum) == 0 && sum == 4950);
+    AIM_TRUE_OR_DIE(bigvector_foreach(bv, stop_at_ten__, NULL) == -2);
+
+    /* Remove-swap moves the last element into the hole */
+    AIM_TRUE_OR_DIE(PI(bigvector_remove_swap(bv, 10)) == 10);
+    AIM_TRUE_OR_DIE(bigvector_length(bv) == 99 && PI(bigvector_get(bv, 10)) == 99);
+    AIM_TRUE_OR_DIE(bigvector_find(bv, IP(10)) == -1);
+    AIM_TRUE_OR_DIE(bigvector_remove(bv, IP(10)) == -1);
+    AIM_TRUE_OR_DIE(bigvector_remove(bv, IP(98)) == 0);
+    AIM_TRUE_OR_DIE(bigvector_find(bv, IP(98)) == -1 && bigvector_length(bv) == 98);
+    AIM_TRUE_OR_DIE(PI(bigvector_remove_swap(bv, bigvector_length(bv) - 1)) == 97);
+
+    bigvector_clear(bv);
+    AIM_TRUE_OR_DIE(bigvector_length(bv) == 0);
+    bigvector_destroy(bv, NULL);
+
+    /* Destroy frees the data */
+    bv = bigvector_create(4);
+    AIM_TRUE_OR_DIE(bv->size >= 4 && bv->count == 0);
+    bigvector_append(bv, aim_strdup("a"));
+    bigvector_append(bv, aim_strdup("b"));
+    bigvector_destroy(bv, aim_free);
+}
+
+static void
+bigvector_sort_test(int count)
+{
+    bigvector_t* bv = bigvector_create(0);
+    bigvector_t* sorted = bigvector_create(0);
+    int i;
+
+    /* Pairs 2k and 2k+1 compare equal; the odd one is added first */
+    for(i = 0; i < count; i++) {
+        int k = (i * 7919) % count;
+        bigvector_append(bv, IP(2*k + 1));
+        bigvector_append(bv, IP(2*k));
+    }
+    for(i = 0; i < bigvector_length(bv); i++) {
+        bigvector_insert_sorted(sorted, bigvector_get(bv, i), compare_pair__);
+    }
+    bigvector_sort(bv, compare_pair__);
+
+    AIM_TRUE_OR_DIE(bigvector_length(bv) == 2*count);
+    for(i = 0; i < count; i++) {
+        AIM_TRUE_OR_DIE(PI(bigvector_get(bv, 2*i)) == 2*i + 1);
+        AIM_TRUE_OR_DIE(PI(bigvector_get(bv, 2*i + 1)) == 2*i);
+        AIM_TRUE_OR_DIE(bigvector_get(sorted, 2*i) == bigvector_get(bv, 2*i));
+        AIM_TRUE_OR_DIE(bigvector_get(sorted, 2*i + 1) == bigvector_get(bv, 2*i + 1));
+    }
+
+    for(i = 0; i < count; i++) {
+        AIM_TRUE_OR_DIE(bigvector_find_sorted(bv, IP(2*i), compare_pair__) == 2*i);
+    }
+    AIM_TRUE_OR_DIE(bigvector_find_sorted(bv, IP(-2), compare_pair__) == -1);
+    AIM_TRUE_OR_DIE(bigvector_find_sorted(bv, IP(2*count), compare_pair__) == -1);
+
+    bigvector_destroy(bv, NULL);
+    bigvector_destroy(sorted, NULL);
+}
+
+static void
+bigvector_biglist_test(void)
+{
+    biglist_t* bl = NULL;
+    biglist_t* ble;
+    bigvector_t* bv;
+    void* data;
+    int i;
+
+    bv = bigvector_from_biglist(NULL);
+    AIM_TRUE_OR_DIE(bigvector_length(bv) == 0 && bigvector_to_biglist(bv) == NULL);
+    bigvector_destroy(bv, NULL);
+
+    for(i = 0; i < 50; i++) {
+        bl = biglist_append(bl, IP(i));
+    }
+    bv = bigvector_from_biglist(bl);
+    AIM_TRUE_OR_DIE(bigvector_length(bv) == 50);
+    BIGVECTOR_FOREACH(i, bv, data) {
+        AIM_TRUE_OR_DIE(PI(data) == i);
+    }
+    biglist_free(bl);
+
+    bl = bigvector_to_biglist(bv);
+    AIM_TRUE_OR_DIE(biglist_length(bl) == 50);
+    i = 0;
+    BIGLIST_FOREACH(ble, bl) {
+        AIM_TRUE_OR_DIE(PI(ble->data) == i);
+        AIM_TRUE_OR_DIE(ble->previous == NULL || PI(ble->previous->data) == i - 1);
+        i++;
+    }
+    biglist_free(bl);
+    bigvector_destroy(bv, NULL);
+}
+
+/*
+ * Iterate and sort the same data as a BigList and a BigVector. The list
+ * elements are allocated in shuffled order, as they are in a list built
+ * up over time, so walking the list jumps around memory.
+ */
+static void
+bigvector_perftest(int count, int rounds)
+{
+    biglist_t** elements = aim_malloc(sizeof(*elements) * count);
+    biglist_t* bl = NULL;
+    biglist_t* ble;
+    bigvector_t* bv;
+    uint64_t start, list_iter, vector_iter, list_sort, vector_sort;
+    volatile long sink;
+    long sum;
+    void* data;
+    int i, r;
+
+    for(i = 0; i < count; i++) {
+        elements[i] = biglist_alloc(IP(random() % count), NULL, NULL);
+    }
+    for(i = count - 1; i > 0; i--) {
+        int j = random() % (i + 1);
+        biglist_t* tmp = elements[i];
+        elements[i] = elements[j];
+        elements[j] = tmp;
+    }
+    bl = biglist_from_array(elements, count);
+    aim_free(elements);
+    bv = bigvector_from_biglist(bl);
+
+    start = os_time_monotonic();
+    for(r = 0; r < rounds; r++) {
+        sum = 0;
+        BIGLIST_FOREACH(ble, bl) {
+            sum += PI(ble->data);
+        }
+        sink = sum;
+    }
+    list_iter = os_time_monotonic() - start;
+
+    start = os_time_monotonic();
+    for(r = 0; r < rounds; r++) {
+        sum = 0;
+        BIGVECTOR_FOREACH(i, bv, data) {
+            sum += PI(data);
+        }
+        sink = sum;
+    }
+    vector_iter = os_time_monotonic() - start;
+    (void)sink;
+
+    start = os_time_monotonic();
+    bl = biglist_sort(bl, compare_int__);
+    list_sort = os_time_monotonic() - start;
+
+    start = os_time_monotonic();
+    bigvector_sort(bv, compare_int__);
+    vector_sort = os_time_monotonic() - start;
+
+    aim_printf(&aim_pvs_stdout, "%d elements: iterate (ns/element)  biglist %6.2f  bigvector %6.2f\n",
+               count, list_iter * 1000.0 / ((double)count * rounds),
+               vector_iter * 1000.0 / ((double)count * rounds));
+    aim_printf(&aim_pvs_stdout, "%d elements: sort (ms)             biglist %6.2f  bigvector %6.2f\n",
+               count, list_sort / 1000.0, vector_sort / 1000.0);
+
+    biglist_free(bl);
+    bigvector_destroy(bv, NULL);
+}
+
+int aim_main(int argc, char* argv[])
+{
+    int i;
+
+    if(argc > 1 && !strcmp(argv[1], "perf")) {
+        bigvector_perftest(1000, 10000);
+        bigvector_perftest(1000*1000, 10);
+        return 0;
+    }
+
+    bigvector_config_show(&aim_pvs_stdout);
+    bigvector_basic_test();
+    for(i = 1; i <= 100; i++) {
+        bigvector_sort_test(i);
+    }
+    bigvector_sort_test(10007);
+    bigvector_biglist_test();
+    return 0;
+}
@@ -39,13 +39,40 @@
  */
 typedef struct nwac_entry_header_s {
     /** This entry is valid */
-    uint32_t valid;
+    uint8_t valid;
+    /** Eviction policy state, see NWAC_USE_* */
+    uint8_t use;
+    /** Reserved */
+    uint16_t reserved;
     /** Eviction count */
     uint32_t evictions;
+#if NWAC_CONFIG_INCLUDE_TIMESTAMP == 1
     /** The last access time for this entry */
     uint64_t timestamp;
+#endif
 } nwac_entry_header_t;
 
+/** CLOCK reference bit, set on each hit */
+#define NWAC_USE_REF 0x1
+/** CLOCK hit count, saturating at 3 */
+#define NWAC_USE_FREQ(_use) ( ((_use) >> 1) & 0x3 )
+
+/**
+ * Eviction policy, chosen per cache with nwac_policy_set().
+ */
+typedef enum nwac_policy_e {
+    /** Evict the least recently used entry. Needs timestamps. */
+    NWAC_POLICY_LRU,
+    /**
+     * Second chance CLOCK with a reference bit and a hit count. New
+     * entries start with neither, so one-shot keys are evicted before
+     * entries that have been hit.
+     */
+    NWAC_POLICY_CLOCK,
+    /** Evict a pseudo-random entry */
+    NWAC_POLICY_RANDOM,
+} nwac_policy_t;
+
 /**
  * This structure is used to reference the entry and key data.
  */
@@ -76,6 +103,8 @@ typedef struct nwac_s {
 #define NWAC_F_NWAC_ALLOC   0x1
     /** The cache data was allocated */
 #define NWAC_F_CACHE_ALLOC  0x2
+    /** Keys may be placed in either of two blocks */
+#define NWAC_F_TWO_CHOICE   0x4
     /** NWAC flags */
     uint32_t flags;
 
@@ -86,6 +115,32 @@ typedef struct nwac_s {
 
     /** The number of blocks in the cache */
     uint32_t block_count;
+
+#if NWAC_CONFIG_INCLUDE_TAGS == 1
+    /**
+     * One hash tag byte per entry, stored contiguously for each block
+     * so a block's tags can be compared at once. A tag of 0 marks an
+     * entry that has never been handed out.
+     */
+    uint8_t* tags;
+    /** Distance between the tags of consecutive blocks */
+    uint32_t tag_stride;
+#endif
+
+#if NWAC_CONFIG_LOCK_STRIPES > 0
+    /** Block locks. Block b uses stripe b % NWAC_CONFIG_LOCK_STRIPES. */
+    struct nwac_stripe_s* stripes;
+#endif
+
+    /** Eviction policy */
+    nwac_policy_t policy;
+    /** Per block CLOCK hand or random state */
+    uint32_t* hands;
+
+#if NWAC_CONFIG_INCLUDE_STATS == 1
+    /** Search counters, one set per lock stripe. See nwac_stats.h. */
+    struct nwac_counters_s* counters;
+#endif
 } nwac_t;
 
 /**
@@ -109,6 +164,31 @@ nwac_t* nwac_create(uint32_t n, uint32_t key_size,
 int nwac_init(nwac_t* nwac, uint32_t n, uint32_t key_size,
               uint32_t entry_size, uint32_t entry_count);
 
+/**
+ * @brief Set the eviction policy.
+ * @param nwac The NWAC.
+ * @param policy The policy.
+ * @returns 0 on success, -1 if the policy needs timestamps and
+ * NWAC_CONFIG_INCLUDE_TIMESTAMP is 0.
+ * @note The default is LRU, or CLOCK without timestamps. Set the policy
+ * before the cache is used.
+ */
+int nwac_policy_set(nwac_t* nwac, nwac_policy_t policy);
+
+/**
+ * @brief Enable or disable two choice block placement.
+ * @param nwac The NWAC.
+ * @param enable Non-zero to enable.
+ * @note Each key gets a second candidate block from the other half of
+ * its hash. Searches look in both blocks, and a key that misses goes in
+ * the one with more unused entries, or if both are full, the one with
+ * the older LRU victim. This evens out block occupancy so that fewer
+ * live entries are evicted from crowded blocks, at the cost of a second
+ * block search on misses. Set this before the cache is used.
+ * nwac_search_block() always searches only the given block.
+ */
+void nwac_two_choice_set(nwac_t* nwac, int enable);
+
 /**
  * @brief Declare a static nwac.
  */
@@ -164,10 +244,15 @@ void nwac_unlock(nwac_t* nwac);
  * @param block The block number.
  * @param key The key data.
  * @param now The current time. Entries will be evicted based on LRU. Set this value
- * to zero to disable eviction.
+ * to zero to disable eviction. The CLOCK and RANDOM policies only check
+ * that it is non-zero.
  * @returns The entry pointer, if found in the cache (valid = 1)
  * @returns A new entry pointer, if not found in the cache (valid = 0)
  * @returns NULL if full and eviction is disabled.
+ *
+ * @note With NWAC_CONFIG_INCLUDE_TAGS, the cache tags the entry returned on
+ * a miss with the key's hash. The caller must only store that key in it.
+ * Entries must not be filled in without a search.
  */
 nwac_entry_t* nwac_search_block(nwac_t* nwac, uint32_t block, uint8_t* key,
                                 uint64_t now);
@@ -180,7 +265,8 @@ nwac_entry_t* nwac_search_block(nwac_t* nwac, uint32_t block, uint8_t* key,
  * @param key The key data.
  * @param now The current time. Entries will be evicted based on LRU. Set this value
  * to zero to disable eviction.
- * @note The block number will be calculated as (hash) % (block_count)
+ * @note The block number will be calculated as (hash) % (block_count). With
+ * two choice placement a second block also comes from the hash.
  * @returns See nwac_search_block()
  */
 nwac_entry_t* nwac_search_hash(nwac_t* nwac, uint32_t hash, uint8_t* key,
@@ -197,6 +283,93 @@ nwac_entry_t* nwac_search_hash(nwac_t* nwac, uint32_t hash, uint8_t* key,
  */
 nwac_entry_t* nwac_search(nwac_t* nwac, uint8_t* key, uint64_t now);
 
+/** Largest batch nwac_search_batch() resolves at once */
+#define NWAC_BATCH_SIZE 32
+
+/**
+ * @brief Search the NWAC for a batch of keys.
+ * @param nwac The NWAC.
+ * @param keys The keys.
+ * @param entries Output, the nwac_search() result for each resolved key.
+ * @param count Number of keys.
+ * @param now The current time, as for nwac_search().
+ * @returns The number of keys resolved, between 1 and NWAC_BATCH_SIZE
+ * (0 if count is 0).
+ *
+ * All keys are hashed and their blocks prefetched before any is searched,
+ * so the cache misses of the batch overlap.
+ *
+ * The results are those of calling nwac_search() for each key in order,
+ * with the caller filling in each new entry before the next call. The
+ * caller must therefore handle the entries in order: a key repeated
+ * after a miss gets the same entry, which the caller will already have
+ * filled by the time it reaches the repeat. A different key that misses
+ * in a block an earlier key of the batch also searched is not resolved:
+ * after an earlier miss its search depends on that fill, and after an
+ * earlier hit it could evict the entry returned for that key before the
+ * caller uses it. The batch stops there, and the caller continues from
+ * it after handling the resolved entries.
+ */
+int nwac_search_batch(nwac_t* nwac, uint8_t** keys, nwac_entry_t** entries,
+                      int count, uint64_t now);
+
+
+#if NWAC_CONFIG_LOCK_STRIPES > 0
+
+/**
+ * @brief Search the NWAC for the given key and lock the entry's block.
+ * @param nwac The NWAC.
+ * @param key The key data.
+ * @param now The current time, as for nwac_search().
+ * @returns See nwac_search_block(). Unless NULL is returned, the entry's
+ * block stays locked until nwac_entry_unlock() is called on it.
+ * @note Only the block's stripe lock is taken, so searches that land in
+ * other stripes run in parallel. Use this instead of nwac_lock() and
+ * nwac_search() when several threads share the cache.
+ */
+nwac_entry_t* nwac_search_lock(nwac_t* nwac, uint8_t* key, uint64_t now);
+
+/**
+ * @brief As nwac_search_lock(), using the given hash.
+ * @param nwac The NWAC.
+ * @param hash The hash value for the key.
+ * @param key The key data.
+ * @param now The current time, as for nwac_search().
+ */
+nwac_entry_t* nwac_search_hash_lock(nwac_t* nwac, uint32_t hash, uint8_t* key,
+                                    uint64_t now);
+
+/**
+ * @brief Unlock the block of an entry returned by a locking search.
+ * @param nwac The NWAC.
+ * @param entry The entry.
+ */
+void nwac_entry_unlock(nwac_t* nwac, nwac_entry_t* entry);
+
+#else
+
+/* Without striped locking these are the plain searches */
+static inline nwac_entry_t*
+nwac_search_lock(nwac_t* nwac, uint8_t* key, uint64_t now)
+{
+    return nwac_search(nwac, key, now);
+}
+
+static inline nwac_entry_t*
+nwac_search_hash_lock(nwac_t* nwac, uint32_t hash, uint8_t* key, uint64_t now)
+{
+    return nwac_search_hash(nwac, hash, key, now);
+}
+
+static inline void
+nwac_entry_unlock(nwac_t* nwac, nwac_entry_t* entry)
+{
+    (void)nwac;
+    (void)entry;
+}
+
+#endif /* NWAC_CONFIG_LOCK_STRIPES */
+
 
 /**
  * Custom entry dumper
@@ -227,6 +400,7 @@ void nwac_show(nwac_t* nwac, aim_pvs_t* pvs, nwac_entry_show_f custom);
 /**
  * @brief Clear all cache entries.
  * @param nwac The NWAC.
+ * @note With NWAC_CONFIG_LOCK_STRIPES, this takes every stripe lock.
  */
 void nwac_clear(nwac_t* nwac);
 
@@ -117,6 +117,46 @@
 #define NWAC_CONFIG_INCLUDE_LOCKING 1
 #endif
 
+/**
+ * NWAC_CONFIG_INCLUDE_TAGS
+ *
+ * Keep a per-block array of key hash tags so searches only compare keys on tag matches. */
+
+
+#ifndef NWAC_CONFIG_INCLUDE_TAGS
+#define NWAC_CONFIG_INCLUDE_TAGS 0
+#endif
+
+/**
+ * NWAC_CONFIG_LOCK_STRIPES
+ *
+ * Number of spinlocks striped over the cache blocks for nwac_search_lock, or 0 for no striped locking. */
+
+
+#ifndef NWAC_CONFIG_LOCK_STRIPES
+#define NWAC_CONFIG_LOCK_STRIPES 0
+#endif
+
+/**
+ * NWAC_CONFIG_INCLUDE_TIMESTAMP
+ *
+ * Include the 64 bit access timestamp in each entry header. Required for the LRU eviction policy. */
+
+
+#ifndef NWAC_CONFIG_INCLUDE_TIMESTAMP
+#define NWAC_CONFIG_INCLUDE_TIMESTAMP 1
+#endif
+
+/**
+ * NWAC_CONFIG_INCLUDE_STATS
+ *
+ * Include hit, fill and eviction counters and the stats API. Requires the debug_counter and histogram modules. */
+
+
+#ifndef NWAC_CONFIG_INCLUDE_STATS
+#define NWAC_CONFIG_INCLUDE_STATS 0
+#endif
+
 
 
 /**
@@ -0,0 +1,124 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+/************************************************************//**
+ *
+ * @file
+ * @brief NWAC search counters and occupancy.
+ *
+ * With NWAC_CONFIG_INCLUDE_STATS every search counts whether it hit,
+ * filled an unused entry, evicted one, or failed on a full block. The
+ * counters are kept per lock stripe and updated under the stripe lock,
+ * so they cost one increment per search.
+ *
+ * Caches registered with nwac_stats_register also publish their counters
+ * as debug counters named nwac.<name>.<counter>, and the number of
+ * valid entries per block as the histogram nwac.<name>.occupancy. These
+ * are refreshed by nwac_stats_sync, which the nwac uCli "stats" command
+ * calls.
+ *
+ * @addtogroup nwac-nwac
+ * @{
+ *
+ ***************************************************************/
+#ifndef __NWAC_STATS_H__
+#define __NWAC_STATS_H__
+
+#include <nwac/nwac.h>
+
+#if NWAC_CONFIG_INCLUDE_STATS == 1
+
+struct histogram;
+
+/**
+ * NWAC statistics.
+ */
+typedef struct nwac_stats_s {
+    /** Searches, the sum of the next four counters */
+    uint64_t lookups;
+    /** Searches that found their key */
+    uint64_t hits;
+    /** Misses given an unused entry */
+    uint64_t fills;
+    /** Misses given an evicted entry */
+    uint64_t evictions;
+    /** Misses on a full block with eviction disabled */
+    uint64_t full;
+    /** Number of valid entries */
+    uint32_t valid_entries;
+    /** Number of blocks with no valid entries */
+    uint32_t empty_blocks;
+    /** Number of blocks with every entry valid */
+    uint32_t full_blocks;
+} nwac_stats_t;
+
+/**
+ * @brief Collect statistics for a cache.
+ * @param nwac The NWAC.
+ * @param stats Filled in with the statistics.
+ * @param occupancy If not NULL, its counts are replaced with the number
+ * of valid entries in each block.
+ * @note Walks every block, taking each stripe lock in turn.
+ */
+void nwac_stats_get(nwac_t* nwac, nwac_stats_t* stats,
+                    struct histogram* occupancy);
+
+/**
+ * @brief Reset the search counters of a cache.
+ * @param nwac The NWAC.
+ */
+void nwac_stats_clear(nwac_t* nwac);
+
+/**
+ * @brief Show statistics.
+ * @param stats The statistics.
+ * @param pvs The output pvs.
+ */
+void nwac_stats_show(nwac_stats_t* stats, aim_pvs_t* pvs);
+
+/**
+ * @brief Register a cache's counters and occupancy histogram.
+ * @param nwac The NWAC.
+ * @param name The cache name, which is copied.
+ * @note nwac_destroy unregisters the cache.
+ */
+void nwac_stats_register(nwac_t* nwac, const char* name);
+
+/**
+ * @brief Unregister a cache.
+ * @param nwac The NWAC.
+ */
+void nwac_stats_unregister(nwac_t* nwac);
+
+/**
+ * @brief Refresh the debug counters and histograms of registered caches.
+ */
+void nwac_stats_sync(void);
+
+/**
+ * @brief Refresh and show the statistics of registered caches.
+ * @param prefix Only show caches whose name starts with this (optional).
+ * @param pvs The output pvs.
+ * @returns The number of caches shown.
+ */
+int nwac_stats_show_registered(const char* prefix, aim_pvs_t* pvs);
+
+#endif /* NWAC_CONFIG_INCLUDE_STATS */
+
+#endif /* __NWAC_STATS_H__ */
+/* @} */
@@ -23,6 +23,93 @@
 
 #include <murmur/murmur.h>
 
+#if NWAC_CONFIG_INCLUDE_STATS == 1
+#include <nwac/nwac_stats.h>
+#include <histogram/histogram.h>
+#endif
+
+#if NWAC_CONFIG_LOCK_STRIPES > 0
+#include <sched.h>
+
+/* A block stripe spinlock, on its own cache line */
+struct nwac_stripe_s {
+    uint32_t lock;
+    char pad[64 - sizeof(uint32_t)];
+};
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_RELAX() __builtin_ia32_pause()
+#else
+#define CPU_RELAX() __asm__ __volatile__("" ::: "memory")
+#endif
+
+/* Spin briefly, then give up the CPU in case the holder needs it */
+#define SPIN_LIMIT 1000
+
+static inline void
+nwac_stripe_lock__(struct nwac_stripe_s* stripe)
+{
+    int spins = 0;
+    while(__atomic_exchange_n(&stripe->lock, 1, __ATOMIC_ACQUIRE)) {
+        while(__atomic_load_n(&stripe->lock, __ATOMIC_RELAXED)) {
+            if(++spins < SPIN_LIMIT) {
+                CPU_RELAX();
+            }
+            else {
+                sched_yield();
+            }
+        }
+    }
+}
+
+static inline void
+nwac_stripe_unlock__(struct nwac_stripe_s* stripe)
+{
+    __atomic_store_n(&stripe->lock, 0, __ATOMIC_RELEASE);
+}
+
+#define NWAC_STRIPE(_nwac, _block)                              \
+    ( &(_nwac)->stripes[(_block) % NWAC_CONFIG_LOCK_STRIPES] )
+#endif
+
+#if NWAC_CONFIG_INCLUDE_STATS == 1
+/*
+ * Search counters. There is one set per stripe, covered by its lock,
+ * so the lookup count is the sum of the others rather than a counter.
+ */
+#if NWAC_CONFIG_LOCK_STRIPES > 0
+#define NWAC_COUNTER_SETS NWAC_CONFIG_LOCK_STRIPES
+#else
+#define NWAC_COUNTER_SETS 1
+#endif
+
+struct nwac_counters_s {
+    uint64_t hits;
+    uint64_t fills;
+    uint64_t evictions;
+    uint64_t full;
+    char pad[64 - 4*sizeof(uint64_t)];
+};
+
+#define NWAC_COUNT(_nwac, _block, _counter)                             \
+    ( (_nwac)->counters[(_block) % NWAC_COUNTER_SETS]._counter++ )
+#else
+#define NWAC_COUNT(_nwac, _block, _counter)
+#endif
+
+#if NWAC_CONFIG_INCLUDE_TAGS == 1
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/* Tags compared per step */
+#if defined(__AVX2__)
+#define NWAC_TAG_GROUP 32
+#else
+#define NWAC_TAG_GROUP 16
+#endif
+#endif
+
 static inline int
 cache_config_validate__(uint32_t n, uint32_t key_size,
                         uint32_t entry_size, uint32_t entry_count)
@@ -80,12 +167,69 @@ nwac_init(nwac_t* nwac, uint32_t n, uint32_t key_size,
     nwac->block_count = entry_count/n;
     nwac->key_size = key_size;
 
+#if NWAC_CONFIG_INCLUDE_TAGS == 1
+    /* Pad each block's tags so whole groups can be loaded; padding stays 0 */
+    nwac->tag_stride = (n + NWAC_TAG_GROUP - 1) / NWAC_TAG_GROUP * NWAC_TAG_GROUP;
+    if(nwac->tags) {
+        aim_free(nwac->tags);
+    }
+    nwac->tags = aim_zmalloc(nwac->tag_stride * nwac->block_count);
+#endif
+
+#if NWAC_CONFIG_LOCK_STRIPES > 0
+    if(nwac->stripes == NULL) {
+        nwac->stripes = aim_zmalloc(sizeof(nwac->stripes[0]) *
+                                    NWAC_CONFIG_LOCK_STRIPES);
+    }
+#endif
+
+    if(nwac->hands) {
+        aim_free(nwac->hands);
+    }
+    nwac->hands = aim_zmalloc(sizeof(nwac->hands[0]) * nwac->block_count);
+
+#if NWAC_CONFIG_INCLUDE_STATS == 1
+    if(nwac->counters == NULL) {
+        nwac->counters = aim_zmalloc(sizeof(nwac->counters[0]) *
+                                     NWAC_COUNTER_SETS);
+    }
+#endif
+#if NWAC_CONFIG_INCLUDE_TIMESTAMP == 0
+    if(nwac->policy == NWAC_POLICY_LRU) {
+        nwac->policy = NWAC_POLICY_CLOCK;
+    }
+#endif
+
 #if NWAC_CONFIG_INCLUDE_LOCKING == 1
     nwac->lock = os_sem_create(1);
 #endif
     return 0;
 }
 
+void
+nwac_two_choice_set(nwac_t* nwac, int enable)
+{
+    if(enable) {
+        nwac->flags |= NWAC_F_TWO_CHOICE;
+    }
+    else {
+        nwac->flags &= ~NWAC_F_TWO_CHOICE;
+    }
+}
+
+int
+nwac_policy_set(nwac_t* nwac, nwac_policy_t policy)
+{
+#if NWAC_CONFIG_INCLUDE_TIMESTAMP == 0
+    if(policy == NWAC_POLICY_LRU) {
+        AIM_LOG_ERROR("LRU eviction requires NWAC_CONFIG_INCLUDE_TIMESTAMP.");
+        return -1;
+    }
+#endif
+    nwac->policy = policy;
+    return 0;
+}
+
 int
 nwac_init_static(nwac_t* nwac)
 {
@@ -111,7 +255,7 @@ nwac_unlock(nwac_t* nwac)
 
 
 #define NWAC_ENTRY_FIRST(_nwac, _block)                                 \
-    ( (nwac_entry_t*) ( (_nwac->cache + nwac->block_size*block*nwac->entry_size) ))
+    ( (nwac_entry_t*) ( ((_nwac)->cache + (_nwac)->block_size*(_block)*(_nwac)->entry_size) ))
 #define NWAC_ENTRY_NEXT(_nwac, _ptr)                    \
     ( (nwac_entry_t*) ( ( ((uint8_t*)_ptr) + nwac->entry_size)))
 
@@ -133,80 +277,609 @@ nwac_block_first__(nwac_t* nwac, uint32_t block, nwac_entry_t** first)
         _counter < nwac->block_size;                            \
         _entry = NWAC_ENTRY_NEXT(_nwac, _entry), _counter++)
 
-nwac_entry_t*
-nwac_search_block(nwac_t* nwac, uint32_t block, uint8_t* key, uint64_t now)
+#define NWAC_ENTRY_AT(_nwac, _first, _index)                            \
+    ( (nwac_entry_t*) ( ((uint8_t*)_first) + (_index)*(_nwac)->entry_size) )
+
+/* The block an entry is in */
+#define NWAC_ENTRY_BLOCK(_nwac, _entry)                                 \
+    ( (uint32_t) ( (((uint8_t*)(_entry)) - (_nwac)->cache) /            \
+                   ((_nwac)->block_size*(_nwac)->entry_size) ) )
+
+/* Record a hit */
+static inline void
+nwac_entry_touch__(nwac_t* nwac, nwac_entry_t* entry, uint64_t now)
+{
+    uint8_t freq;
+
+    if(now == 0) {
+        return;
+    }
+    switch(nwac->policy) {
+    case NWAC_POLICY_LRU:
+#if NWAC_CONFIG_INCLUDE_TIMESTAMP == 1
+        entry->hdr.timestamp = now;
+#endif
+        break;
+    case NWAC_POLICY_CLOCK:
+        freq = NWAC_USE_FREQ(entry->hdr.use);
+        if(freq < 3) {
+            freq++;
+        }
+        entry->hdr.use = NWAC_USE_REF | (freq << 1);
+        break;
+    default:
+        break;
+    }
+}
+
+/*
+ * Reset the policy state of an entry handed out on a miss. New entries
+ * start without a reference bit, so keys that are never hit again are
+ * the first CLOCK victims.
+ */
+static inline nwac_entry_t*
+nwac_entry_claim__(nwac_entry_t* entry, uint64_t now)
+{
+    entry->hdr.use = 0;
+#if NWAC_CONFIG_INCLUDE_TIMESTAMP == 1
+    entry->hdr.timestamp = now;
+#endif
+    return entry;
+}
+
+/* Choose the entry to evict from a full block */
+static nwac_entry_t*
+nwac_victim__(nwac_t* nwac, uint32_t block, nwac_entry_t* first)
 {
-    nwac_entry_t* empty = NULL;
     nwac_entry_t* entry;
+    uint32_t hand;
+    uint8_t use;
+    int count;
+
+    switch(nwac->policy) {
+    case NWAC_POLICY_CLOCK:
+        /*
+         * Each pass clears an entry's reference bit, then counts down
+         * its hits. An entry with the bit set and 3 hits is at zero
+         * after four passes, so this ends within the fifth turn of the
+         * hand.
+         */
+        hand = nwac->hands[block];
+        for(;;) {
+            entry = NWAC_ENTRY_AT(nwac, first, hand);
+            if(++hand == nwac->block_size) {
+                hand = 0;
+            }
+            use = entry->hdr.use;
+            if(use & NWAC_USE_REF) {
+                entry->hdr.use = use & ~NWAC_USE_REF;
+            }
+            else if(NWAC_USE_FREQ(use)) {
+                entry->hdr.use = (NWAC_USE_FREQ(use) - 1) << 1;
+            }
+            else {
+                break;
+            }
+        }
+        nwac->hands[block] = hand;
+        return entry;
+
+    case NWAC_POLICY_RANDOM:
+        nwac->hands[block] = nwac->hands[block] * 1103515245 + 12345;
+        return NWAC_ENTRY_AT(nwac, first, (nwac->hands[block] >> 16) % nwac->block_size);
+
+    default:
+        break;
+    }
+
+    /* LRU */
+    (void)count;
+#if NWAC_CONFIG_INCLUDE_TIMESTAMP == 1
+    {
+        nwac_entry_t* oldest = first;
+        NWAC_BLOCK_ITER(nwac, count, first, entry) {
+            if(entry->hdr.timestamp < oldest->hdr.timestamp) {
+                oldest = entry;
+            }
+        }
+        return oldest;
+    }
+#else
+    return first;
+#endif
+}
+
+/* Flush an entry and hand it out */
+static inline nwac_entry_t*
+nwac_evict__(nwac_entry_t* entry, uint64_t now)
+{
+    entry->hdr.valid = 0;
+    entry->hdr.evictions++;
+    return nwac_entry_claim__(entry, now);
+}
+
+#if NWAC_CONFIG_INCLUDE_TAGS == 1
+
+/*
+ * Tag for a key hash. 0 is reserved for unused entries. The hash is
+ * mixed first because the keys of a block share the bits that chose
+ * it, which are the high bits for a second choice block.
+ */
+static inline uint8_t
+nwac_tag__(uint32_t hash)
+{
+    uint8_t tag = (hash * 0x9e3779b1U) >> 24;
+    return tag ? tag : 1;
+}
+
+/* Bitmask of the tags in a group that equal 'tag' */
+static inline uint32_t
+nwac_tag_match__(const uint8_t* tags, uint8_t tag)
+{
+#if defined(__AVX2__)
+    __m256i group = _mm256_loadu_si256((const __m256i*)tags);
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi8(group, _mm256_set1_epi8(tag)));
+#elif defined(__SSE2__)
+    __m128i group = _mm_loadu_si128((const __m128i*)tags);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(tag)));
+#else
+    uint32_t mask = 0;
+    int i;
+    for(i = 0; i < NWAC_TAG_GROUP; i++) {
+        mask |= (uint32_t)(tags[i] == tag) << i;
+    }
+    return mask;
+#endif
+}
+
+#endif /* NWAC_CONFIG_INCLUDE_TAGS */
+
+/* What a search of one block saw, for placing a key it missed */
+typedef struct nwac_probe_s {
+    /** First entry of the block */
     nwac_entry_t* first;
-    nwac_entry_t* oldest = NULL;
+    /** An unused entry, if one was seen */
+    nwac_entry_t* empty;
+    /** Number of unused entries seen */
+    uint32_t free;
+} nwac_probe_t;
+
+/**
+ * Look for a key in one block, touching it on a hit. On a miss the probe
+ * notes the unused entries. With tags only entries whose tag matches have
+ * their key compared, so a hit touches the tag group and the matching
+ * entry, and only never used entries are noted.
+ */
+static nwac_entry_t*
+nwac_find__(nwac_t* nwac, uint32_t block, uint8_t* key, uint64_t now,
+            uint8_t tag, nwac_probe_t* probe)
+{
+    nwac_entry_t* entry;
+#if NWAC_CONFIG_INCLUDE_TAGS == 1
+    uint8_t* tags = nwac->tags + block*nwac->tag_stride;
+    uint32_t base, mask;
+#else
     int count;
+#endif
 
-    if(nwac_block_first__(nwac, block, &first) < 0) {
-        return NULL;
+    probe->first = NWAC_ENTRY_FIRST(nwac, block);
+    probe->empty = NULL;
+    probe->free = 0;
+
+#if NWAC_CONFIG_INCLUDE_TAGS == 1
+    for(base = 0; base < nwac->block_size; base += NWAC_TAG_GROUP) {
+        mask = nwac_tag_match__(tags + base, tag);
+        while(mask) {
+            entry = NWAC_ENTRY_AT(nwac, probe->first, base + __builtin_ctz(mask));
+            if(entry->hdr.valid &&
+               NWAC_MEMCMP(entry->key, key, nwac->key_size) == 0) {
+                /* Found */
+                nwac_entry_touch__(nwac, entry, now);
+                NWAC_COUNT(nwac, block, hits);
+                return entry;
+            }
+            mask &= mask - 1;
+        }
     }
 
-    /**
-     * Search all entries in this block.
-     * Keep track of the first empty entry so we can return it
-     * in case we miss.
-     */
-    oldest = first;
-    NWAC_BLOCK_ITER(nwac, count, first, entry) {
+    /* Missed. Note the entries that have never been used. */
+    for(base = 0; base < nwac->block_size; base += NWAC_TAG_GROUP) {
+        mask = nwac_tag_match__(tags + base, 0);
+        if(nwac->block_size - base < 32) {
+            mask &= (1U << (nwac->block_size - base)) - 1;
+        }
+        if(mask && probe->empty == NULL) {
+            probe->empty = NWAC_ENTRY_AT(nwac, probe->first, base + __builtin_ctz(mask));
+        }
+        probe->free += __builtin_popcount(mask);
+    }
+#else
+    NWAC_BLOCK_ITER(nwac, count, probe->first, entry) {
         if(entry->hdr.valid) {
             if(NWAC_MEMCMP(entry->key, key, nwac->key_size) == 0) {
                 /* Found */
-                if(now) {
-                    entry->hdr.timestamp = now;
-                }
+                nwac_entry_touch__(nwac, entry, now);
+                NWAC_COUNT(nwac, block, hits);
                 return entry;
             }
-            else {
-                /* Keep track of the oldest entry in this block */
-                if(entry->hdr.timestamp < oldest->hdr.timestamp) {
-                    oldest = entry;
-                }
-            }
         }
         else {
-            if(empty == NULL) {
+            if(probe->empty == NULL) {
                 /* This is the first empty entry in this block */
-                empty = entry;
+                probe->empty = entry;
+            }
+            probe->free++;
+        }
+    }
+#endif
+    return NULL;
+}
+
+#if NWAC_CONFIG_INCLUDE_TAGS == 1
+/* Without never used entries, look for an invalidated one */
+static void
+nwac_find_invalid__(nwac_t* nwac, nwac_probe_t* probe)
+{
+    nwac_entry_t* entry;
+    int count;
+
+    if(probe->empty == NULL) {
+        NWAC_BLOCK_ITER(nwac, count, probe->first, entry) {
+            if(!entry->hdr.valid) {
+                probe->empty = entry;
+                probe->free = 1;
+                break;
             }
         }
     }
-    if(empty) {
+}
+#endif
+
+/* Hand out an entry of a block for a key that missed */
+static nwac_entry_t*
+nwac_place__(nwac_t* nwac, uint32_t block, nwac_probe_t* probe, uint64_t now,
+             uint8_t tag)
+{
+    nwac_entry_t* entry;
+
+#if NWAC_CONFIG_INCLUDE_TAGS == 1
+    nwac_find_invalid__(nwac, probe);
+#endif
+
+    if(probe->empty) {
         /** We didn't find the entry, but there was a free slot */
-        empty->hdr.timestamp = now;
-        return empty;
+        entry = nwac_entry_claim__(probe->empty, now);
+        NWAC_COUNT(nwac, block, fills);
+    }
+    else if(now) {
+        /** flush the policy's victim and return it */
+        entry = nwac_evict__(nwac_victim__(nwac, block, probe->first), now);
+        NWAC_COUNT(nwac, block, evictions);
+    }
+    else {
+        /** Full, but eviction disabled. */
+        NWAC_COUNT(nwac, block, full);
+        return NULL;
     }
 
-    if(now) {
-        /** flush the oldest and return it */
-        oldest->hdr.valid = 0;
-        oldest->hdr.timestamp = now;
-        oldest->hdr.evictions++;
-        return oldest;
+#if NWAC_CONFIG_INCLUDE_TAGS == 1
+    /* The caller stores this key in the entry */
+    nwac->tags[block*nwac->tag_stride +
+               ((uint8_t*)entry - (uint8_t*)probe->first) / nwac->entry_size] = tag;
+#endif
+    return entry;
+}
+
+/*
+ * Second choice block. The first choice is hash % block_count, which
+ * mostly depends on the low half of the hash, and this one on the high
+ * half.
+ */
+static inline uint32_t
+nwac_block2__(nwac_t* nwac, uint32_t hash, uint32_t block1)
+{
+    uint32_t block2 = ((uint64_t)hash * nwac->block_count) >> 32;
+    if(block2 == block1) {
+        block2 = (block1 + 1) % nwac->block_count;
     }
+    return block2;
+}
 
-    /** Full, but timestamp disabled. */
-    return NULL;
+/* Whether a key that missed both its blocks goes in the second */
+static int
+nwac_prefer_second__(nwac_t* nwac, uint32_t hash,
+                     uint32_t block1, nwac_probe_t* probe1,
+                     uint32_t block2, nwac_probe_t* probe2)
+{
+#if NWAC_CONFIG_INCLUDE_TAGS == 1
+    if(probe1->free == 0 && probe2->free == 0) {
+        nwac_find_invalid__(nwac, probe1);
+        nwac_find_invalid__(nwac, probe2);
+    }
+#endif
+    if(probe1->free || probe2->free) {
+        /* The emptier one */
+        return probe2->free > probe1->free;
+    }
+#if NWAC_CONFIG_INCLUDE_TIMESTAMP == 1
+    if(nwac->policy == NWAC_POLICY_LRU) {
+        /* The one with the older victim */
+        return nwac_victim__(nwac, block2, probe2->first)->hdr.timestamp <
+            nwac_victim__(nwac, block1, probe1->first)->hdr.timestamp;
+    }
+#endif
+    /* Other policies keep their state per block, so pick one by the hash */
+    return (hash >> 15) & 1;
+}
+
+/* Search the block, or with two choice placement both blocks, of a hash */
+static nwac_entry_t*
+nwac_search_hashed__(nwac_t* nwac, uint32_t hash, uint8_t* key, uint64_t now,
+                     uint8_t tag)
+{
+    uint32_t block1 = hash % nwac->block_count;
+    nwac_probe_t probe1;
+    nwac_entry_t* entry;
+
+    entry = nwac_find__(nwac, block1, key, now, tag, &probe1);
+    if(entry) {
+        return entry;
+    }
+
+    if(nwac->flags & NWAC_F_TWO_CHOICE) {
+        uint32_t block2 = nwac_block2__(nwac, hash, block1);
+        nwac_probe_t probe2;
+        if(block2 != block1) {
+            entry = nwac_find__(nwac, block2, key, now, tag, &probe2);
+            if(entry) {
+                return entry;
+            }
+            if(nwac_prefer_second__(nwac, hash, block1, &probe1, block2, &probe2)) {
+                return nwac_place__(nwac, block2, &probe2, now, tag);
+            }
+        }
+    }
+
+    return nwac_place__(nwac, block1, &probe1, now, tag);
+}
+
+#if NWAC_CONFIG_INCLUDE_TAGS == 1
+/* Tags always come from the key's murmur hash */
+#define NWAC_KEY_TAG(_nwac, _key) \
+    nwac_tag__(murmur_hash(_key, (_nwac)->key_size, 0))
+#define NWAC_HASH_TAG(_hash) nwac_tag__(_hash)
+#else
+#define NWAC_KEY_TAG(_nwac, _key) 0
+#define NWAC_HASH_TAG(_hash) 0
+#endif
+
+nwac_entry_t*
+nwac_search_block(nwac_t* nwac, uint32_t block, uint8_t* key, uint64_t now)
+{
+    nwac_entry_t* entry;
+    nwac_entry_t* first;
+    nwac_probe_t probe;
+    uint8_t tag;
+
+    if(nwac_block_first__(nwac, block, &first) < 0) {
+        return NULL;
+    }
+
+    tag = NWAC_KEY_TAG(nwac, key);
+    entry = nwac_find__(nwac, block, key, now, tag, &probe);
+    return entry ? entry : nwac_place__(nwac, block, &probe, now, tag);
 }
 
 nwac_entry_t*
 nwac_search_hash(nwac_t* nwac, uint32_t hash, uint8_t* key, uint64_t now)
 {
-    uint32_t block = hash % (nwac->block_count);
-    return nwac_search_block(nwac, block, key, now);
+    return nwac_search_hashed__(nwac, hash, key, now, NWAC_KEY_TAG(nwac, key));
 }
 
 nwac_entry_t*
 nwac_search(nwac_t* nwac, uint8_t* key, uint64_t now)
 {
     uint32_t hash = murmur_hash(key, nwac->key_size, 0);
-    return nwac_search_hash(nwac, hash, key, now);
+    /* Tags come from this hash, so it need not be computed again */
+    return nwac_search_hashed__(nwac, hash, key, now, NWAC_HASH_TAG(hash));
+}
+
+/* Whether a key is valid in a block, without touching anything */
+static int
+nwac_present__(nwac_t* nwac, uint32_t block, uint8_t* key)
+{
+    nwac_entry_t* entry;
+    int count;
+
+    NWAC_BLOCK_ITER(nwac, count, NWAC_ENTRY_FIRST(nwac, block), entry) {
+        if(entry->hdr.valid &&
+           NWAC_MEMCMP(entry->key, key, nwac->key_size) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Start loading a block */
+static inline void
+nwac_prefetch__(nwac_t* nwac, uint32_t block)
+{
+#if NWAC_CONFIG_INCLUDE_TAGS == 1
+    __builtin_prefetch(nwac->tags + block*nwac->tag_stride);
+#else
+    uint8_t* first = (uint8_t*)NWAC_ENTRY_FIRST(nwac, block);
+    int k;
+    for(k = 0; k < nwac->block_size; k++) {
+        __builtin_prefetch(first + k*nwac->entry_size);
+    }
+#endif
+}
+
+#if NWAC_CONFIG_INCLUDE_TAGS == 1
+/* Start loading the entry the first tag group of a block points to */
+static inline void
+nwac_prefetch_tagged__(nwac_t* nwac, uint32_t block, uint8_t tag)
+{
+    uint32_t mask = nwac_tag_match__(nwac->tags + block*nwac->tag_stride, tag);
+    if(mask) {
+        __builtin_prefetch(NWAC_ENTRY_AT(nwac, NWAC_ENTRY_FIRST(nwac, block),
+                                         __builtin_ctz(mask)));
+    }
+}
+#endif
+
+int
+nwac_search_batch(nwac_t* nwac, uint8_t** keys, nwac_entry_t** entries,
+                  int count, uint64_t now)
+{
+    uint32_t hashes[NWAC_BATCH_SIZE];
+    /* Both candidate blocks, the same one without two choice placement */
+    uint32_t blocks[NWAC_BATCH_SIZE][2];
+    uint8_t claimed[NWAC_BATCH_SIZE];
+    uint8_t tags[NWAC_BATCH_SIZE];
+    int i, j;
+
+    if(count > NWAC_BATCH_SIZE) {
+        count = NWAC_BATCH_SIZE;
+    }
+
+    /* Hash every key and start loading its blocks */
+    for(i = 0; i < count; i++) {
+        hashes[i] = murmur_hash(keys[i], nwac->key_size, 0);
+        tags[i] = NWAC_HASH_TAG(hashes[i]);
+        blocks[i][0] = blocks[i][1] = hashes[i] % nwac->block_count;
+        if(nwac->flags & NWAC_F_TWO_CHOICE) {
+            blocks[i][1] = nwac_block2__(nwac, hashes[i], blocks[i][0]);
+        }
+        nwac_prefetch__(nwac, blocks[i][0]);
+        if(blocks[i][1] != blocks[i][0]) {
+            nwac_prefetch__(nwac, blocks[i][1]);
+        }
+    }
+
+#if NWAC_CONFIG_INCLUDE_TAGS == 1
+    for(i = 0; i < count; i++) {
+        nwac_prefetch_tagged__(nwac, blocks[i][0], tags[i]);
+        if(blocks[i][1] != blocks[i][0]) {
+            nwac_prefetch_tagged__(nwac, blocks[i][1], tags[i]);
+        }
+    }
+#endif
+
+    /*
+     * Resolve in order. Searches into blocks no earlier key used are
+     * independent of the rest of the batch. Otherwise a repeated key
+     * gets what the earlier search would give it after the caller's
+     * fill, and a miss ends the batch: after an earlier miss it would
+     * depend on that fill, and after an earlier hit it could evict the
+     * entry already returned for it.
+     */
+    for(i = 0; i < count; i++) {
+        int shared = 0;
+
+        for(j = 0; j < i; j++) {
+            if(blocks[j][0] != blocks[i][0] && blocks[j][0] != blocks[i][1] &&
+               blocks[j][1] != blocks[i][0] && blocks[j][1] != blocks[i][1]) {
+                continue;
+            }
+            shared = 1;
+            if(NWAC_MEMCMP(keys[j], keys[i], nwac->key_size) == 0) {
+                break;
+            }
+        }
+
+        if(j < i && claimed[j]) {
+            /* Repeat of a key that missed, filled by now: a hit */
+            entries[i] = entries[j];
+            claimed[i] = 1;
+            nwac_entry_touch__(nwac, entries[i], now);
+            /* Either of the key's blocks, whichever the miss placed it in */
+            NWAC_COUNT(nwac, NWAC_ENTRY_BLOCK(nwac, entries[i]), hits);
+            continue;
+        }
+        if(j == i && shared &&
+           !nwac_present__(nwac, blocks[i][0], keys[i]) &&
+           !nwac_present__(nwac, blocks[i][1], keys[i])) {
+            return i;
+        }
+
+        entries[i] = nwac_search_hashed__(nwac, hashes[i], keys[i], now, tags[i]);
+        claimed[i] = (entries[i] != NULL && !entries[i]->hdr.valid);
+    }
+
+    return count;
+}
+
+#if NWAC_CONFIG_LOCK_STRIPES > 0
+
+/*
+ * Search with the stripes of the key's blocks locked, leaving only the
+ * returned entry's stripe locked. With two choice placement the two
+ * stripes are taken in address order.
+ */
+static nwac_entry_t*
+nwac_search_locked__(nwac_t* nwac, uint32_t hash, uint8_t* key, uint64_t now,
+                     uint8_t tag)
+{
+    uint32_t block1 = hash % nwac->block_count;
+    struct nwac_stripe_s* stripe1 = NWAC_STRIPE(nwac, block1);
+    struct nwac_stripe_s* stripe2 = stripe1;
+    nwac_entry_t* entry;
+
+    if(nwac->flags & NWAC_F_TWO_CHOICE) {
+        stripe2 = NWAC_STRIPE(nwac, nwac_block2__(nwac, hash, block1));
+    }
+
+    if(stripe2 == stripe1) {
+        nwac_stripe_lock__(stripe1);
+        entry = nwac_search_hashed__(nwac, hash, key, now, tag);
+        if(entry == NULL) {
+            nwac_stripe_unlock__(stripe1);
+        }
+        return entry;
+    }
+
+    nwac_stripe_lock__(stripe1 < stripe2 ? stripe1 : stripe2);
+    nwac_stripe_lock__(stripe1 < stripe2 ? stripe2 : stripe1);
+    entry = nwac_search_hashed__(nwac, hash, key, now, tag);
+    if(entry == NULL) {
+        nwac_stripe_unlock__(stripe1);
+        nwac_stripe_unlock__(stripe2);
+    }
+    else {
+        uint32_t index = ((uint8_t*)entry - nwac->cache) / nwac->entry_size;
+        if(NWAC_STRIPE(nwac, index / nwac->block_size) == stripe1) {
+            nwac_stripe_unlock__(stripe2);
+        }
+        else {
+            nwac_stripe_unlock__(stripe1);
+        }
+    }
+    return entry;
+}
+
+nwac_entry_t*
+nwac_search_hash_lock(nwac_t* nwac, uint32_t hash, uint8_t* key, uint64_t now)
+{
+    return nwac_search_locked__(nwac, hash, key, now, NWAC_KEY_TAG(nwac, key));
+}
+
+nwac_entry_t*
+nwac_search_lock(nwac_t* nwac, uint8_t* key, uint64_t now)
+{
+    uint32_t hash = murmur_hash(key, nwac->key_size, 0);
+    return nwac_search_locked__(nwac, hash, key, now, NWAC_HASH_TAG(hash));
 }
 
+void
+nwac_entry_unlock(nwac_t* nwac, nwac_entry_t* entry)
+{
+    uint32_t index = ((uint8_t*)entry - nwac->cache) / nwac->entry_size;
+    nwac_stripe_unlock__(NWAC_STRIPE(nwac, index / nwac->block_size));
+}
+
+#endif /* NWAC_CONFIG_LOCK_STRIPES */
+
 void
 nwac_block_show(nwac_t* nwac, uint32_t block, aim_pvs_t* pvs,
                 nwac_entry_show_f custom)
@@ -222,7 +895,10 @@ nwac_block_show(nwac_t* nwac, uint32_t block, aim_pvs_t* pvs,
     NWAC_BLOCK_ITER(nwac, counter, first, entry) {
         aim_printf(pvs, "    valid=%d e=%d", entry->hdr.valid, entry->hdr.evictions);
         if(entry->hdr.valid) {
-            aim_printf(pvs, " ts=%d key=[ %{data}]", entry->hdr.timestamp, entry->key, nwac->key_size);
+#if NWAC_CONFIG_INCLUDE_TIMESTAMP == 1
+            aim_printf(pvs, " ts=%d", entry->hdr.timestamp);
+#endif
+            aim_printf(pvs, " use=%d key=[ %{data}]", entry->hdr.use, entry->key, nwac->key_size);
             if(custom) {
                 aim_printf(pvs, " :: ");
                 custom(nwac, entry, pvs);
@@ -249,9 +925,24 @@ nwac_destroy(nwac_t* nwac)
 {
     if(nwac) {
 
+#if NWAC_CONFIG_INCLUDE_STATS == 1
+        nwac_stats_unregister(nwac);
+        aim_free(nwac->counters);
+        nwac->counters = NULL;
+#endif
 #if NWAC_CONFIG_INCLUDE_LOCKING == 1
         os_sem_destroy(nwac->lock);
 #endif
+#if NWAC_CONFIG_INCLUDE_TAGS == 1
+        aim_free(nwac->tags);
+        nwac->tags = NULL;
+#endif
+#if NWAC_CONFIG_LOCK_STRIPES > 0
+        aim_free(nwac->stripes);
+        nwac->stripes = NULL;
+#endif
+        aim_free(nwac->hands);
+        nwac->hands = NULL;
         if(nwac->flags & NWAC_F_CACHE_ALLOC) {
             aim_free(nwac->cache);
             nwac->cache = NULL;
@@ -266,6 +957,97 @@ void
 nwac_clear(nwac_t* nwac)
 {
     if(nwac) {
+#if NWAC_CONFIG_LOCK_STRIPES > 0
+        int i;
+        for(i = 0; i < NWAC_CONFIG_LOCK_STRIPES; i++) {
+            nwac_stripe_lock__(&nwac->stripes[i]);
+        }
+#endif
         NWAC_MEMSET(nwac->cache, 0, nwac->entry_size*nwac->entry_count);
+#if NWAC_CONFIG_INCLUDE_TAGS == 1
+        NWAC_MEMSET(nwac->tags, 0, nwac->tag_stride*nwac->block_count);
+#endif
+        NWAC_MEMSET(nwac->hands, 0, sizeof(nwac->hands[0])*nwac->block_count);
+#if NWAC_CONFIG_LOCK_STRIPES > 0
+        for(i = 0; i < NWAC_CONFIG_LOCK_STRIPES; i++) {
+            nwac_stripe_unlock__(&nwac->stripes[i]);
+        }
+#endif
+    }
+}
+
+#if NWAC_CONFIG_INCLUDE_STATS == 1
+
+/* Count the valid entries of each block, under its stripe lock */
+static void
+nwac_occupancy__(nwac_t* nwac, nwac_stats_t* stats, struct histogram* hist)
+{
+    nwac_entry_t* first;
+    nwac_entry_t* entry;
+    uint32_t block, valid;
+    int count;
+
+    for(block = 0; block < nwac->block_count; block++) {
+#if NWAC_CONFIG_LOCK_STRIPES > 0
+        nwac_stripe_lock__(NWAC_STRIPE(nwac, block));
+#endif
+        first = NWAC_ENTRY_FIRST(nwac, block);
+        valid = 0;
+        NWAC_BLOCK_ITER(nwac, count, first, entry) {
+            valid += (entry->hdr.valid != 0);
+        }
+#if NWAC_CONFIG_LOCK_STRIPES > 0
+        nwac_stripe_unlock__(NWAC_STRIPE(nwac, block));
+#endif
+        stats->valid_entries += valid;
+        stats->empty_blocks += (valid == 0);
+        stats->full_blocks += (valid == nwac->block_size);
+        if(hist) {
+            histogram_inc(hist, valid);
+        }
     }
 }
+
+void
+nwac_stats_get(nwac_t* nwac, nwac_stats_t* stats, struct histogram* occupancy)
+{
+    int i;
+
+    NWAC_MEMSET(stats, 0, sizeof(*stats));
+    for(i = 0; i < NWAC_COUNTER_SETS; i++) {
+        struct nwac_counters_s* c = &nwac->counters[i];
+#if NWAC_CONFIG_LOCK_STRIPES > 0
+        nwac_stripe_lock__(&nwac->stripes[i]);
+#endif
+        stats->hits += c->hits;
+        stats->fills += c->fills;
+        stats->evictions += c->evictions;
+        stats->full += c->full;
+#if NWAC_CONFIG_LOCK_STRIPES > 0
+        nwac_stripe_unlock__(&nwac->stripes[i]);
+#endif
+    }
+    stats->lookups = stats->hits + stats->fills + stats->evictions + stats->full;
+
+    if(occupancy) {
+        NWAC_MEMSET(occupancy->counts, 0, sizeof(occupancy->counts));
+    }
+    nwac_occupancy__(nwac, stats, occupancy);
+}
+
+void
+nwac_stats_clear(nwac_t* nwac)
+{
+    int i;
+    for(i = 0; i < NWAC_COUNTER_SETS; i++) {
+#if NWAC_CONFIG_LOCK_STRIPES > 0
+        nwac_stripe_lock__(&nwac->stripes[i]);
+#endif
+        NWAC_MEMSET(&nwac->counters[i], 0, sizeof(nwac->counters[i]));
+#if NWAC_CONFIG_LOCK_STRIPES > 0
+        nwac_stripe_unlock__(&nwac->stripes[i]);
+#endif
+    }
+}
+
+#endif /* NWAC_CONFIG_INCLUDE_STATS */
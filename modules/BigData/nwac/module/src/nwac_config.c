@@ -63,6 +63,26 @@ nwac_config_settings_t nwac_config_settings[] =
     { __nwac_config_STRINGIFY_NAME(NWAC_CONFIG_INCLUDE_LOCKING), __nwac_config_STRINGIFY_VALUE(NWAC_CONFIG_INCLUDE_LOCKING) },
 #else
 { NWAC_CONFIG_INCLUDE_LOCKING(__nwac_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef NWAC_CONFIG_INCLUDE_TAGS
+    { __nwac_config_STRINGIFY_NAME(NWAC_CONFIG_INCLUDE_TAGS), __nwac_config_STRINGIFY_VALUE(NWAC_CONFIG_INCLUDE_TAGS) },
+#else
+{ NWAC_CONFIG_INCLUDE_TAGS(__nwac_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef NWAC_CONFIG_LOCK_STRIPES
+    { __nwac_config_STRINGIFY_NAME(NWAC_CONFIG_LOCK_STRIPES), __nwac_config_STRINGIFY_VALUE(NWAC_CONFIG_LOCK_STRIPES) },
+#else
+{ NWAC_CONFIG_LOCK_STRIPES(__nwac_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef NWAC_CONFIG_INCLUDE_TIMESTAMP
+    { __nwac_config_STRINGIFY_NAME(NWAC_CONFIG_INCLUDE_TIMESTAMP), __nwac_config_STRINGIFY_VALUE(NWAC_CONFIG_INCLUDE_TIMESTAMP) },
+#else
+{ NWAC_CONFIG_INCLUDE_TIMESTAMP(__nwac_config_STRINGIFY_NAME), "__undefined__" },
+#endif
+#ifdef NWAC_CONFIG_INCLUDE_STATS
+    { __nwac_config_STRINGIFY_NAME(NWAC_CONFIG_INCLUDE_STATS), __nwac_config_STRINGIFY_VALUE(NWAC_CONFIG_INCLUDE_STATS) },
+#else
+{ NWAC_CONFIG_INCLUDE_STATS(__nwac_config_STRINGIFY_NAME), "__undefined__" },
 #endif
     { NULL, NULL }
 };
@@ -22,5 +22,9 @@
 
 #include <nwac/nwac_config.h>
 
+#if NWAC_CONFIG_INCLUDE_STATS == 1
+/* Create the stats registry lock. Called at module init. */
+void nwac_stats_init__(void);
+#endif
 
 #endif /* __NWAC_INT_H__ */
@@ -19,6 +19,7 @@
 
 #include <nwac/nwac_config.h>
 
+#include "nwac_int.h"
 #include "nwac_log.h"
 
 static int
@@ -33,5 +34,8 @@ void __nwac_module_init__(void)
 {
     AIM_LOG_STRUCT_REGISTER();
     datatypes_init__();
+#if NWAC_CONFIG_INCLUDE_STATS == 1
+    nwac_stats_init__();
+#endif
 }
 
@@ -0,0 +1,188 @@
+/****************************************************************
+ *
+ *        Copyright 2013, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+
+#include <nwac/nwac_config.h>
+
+#if NWAC_CONFIG_INCLUDE_STATS == 1
+
+#include <nwac/nwac_stats.h>
+#include <debug_counter/debug_counter.h>
+#include <histogram/histogram.h>
+#include <AIM/aim_list.h>
+#include <inttypes.h>
+#include <OS/os_sem.h>
+#include "nwac_int.h"
+#include "nwac_log.h"
+
+enum {
+    NWAC_STATS_LOOKUPS,
+    NWAC_STATS_HITS,
+    NWAC_STATS_FILLS,
+    NWAC_STATS_EVICTIONS,
+    NWAC_STATS_FULL,
+    NWAC_STATS_COUNTERS,
+};
+
+static const struct {
+    const char* name;
+    const char* description;
+} nwac_stats_counter_info__[NWAC_STATS_COUNTERS] = {
+    { "lookup", "Number of searches" },
+    { "hit", "Number of searches that found their key" },
+    { "fill", "Number of misses given an unused entry" },
+    { "eviction", "Number of misses given an evicted entry" },
+    { "full", "Number of misses on a full block with eviction disabled" },
+};
+
+/* Registered cache */
+typedef struct nwac_stats_entry_s {
+    struct list_links links;
+    nwac_t* nwac;
+    char* name;
+    debug_counter_t counters[NWAC_STATS_COUNTERS];
+    char* counter_names[NWAC_STATS_COUNTERS];
+    struct histogram* occupancy;
+} nwac_stats_entry_t;
+
+static LIST_DEFINE(nwac_stats_caches__);
+static os_sem_t nwac_stats_lock__;
+
+void
+nwac_stats_init__(void)
+{
+    nwac_stats_lock__ = os_sem_create(1);
+}
+
+void
+nwac_stats_show(nwac_stats_t* stats, aim_pvs_t* pvs)
+{
+    aim_printf(pvs, "searches: %"PRIu64" lookups, %"PRIu64" hits (%.1f%%)\n",
+               stats->lookups, stats->hits,
+               stats->lookups ? 100.0 * stats->hits / stats->lookups : 0.0);
+    aim_printf(pvs, "misses: %"PRIu64" fills, %"PRIu64" evictions, %"PRIu64" full\n",
+               stats->fills, stats->evictions, stats->full);
+    aim_printf(pvs, "occupancy: %u valid entries, %u empty blocks, %u full blocks\n",
+               stats->valid_entries, stats->empty_blocks, stats->full_blocks);
+}
+
+/* Refresh a registered cache's debug counters and histogram */
+static void
+nwac_stats_sync__(nwac_stats_entry_t* entry, nwac_stats_t* stats)
+{
+    uint64_t values[NWAC_STATS_COUNTERS];
+    int i;
+
+    nwac_stats_get(entry->nwac, stats, entry->occupancy);
+    values[NWAC_STATS_LOOKUPS] = stats->lookups;
+    values[NWAC_STATS_HITS] = stats->hits;
+    values[NWAC_STATS_FILLS] = stats->fills;
+    values[NWAC_STATS_EVICTIONS] = stats->evictions;
+    values[NWAC_STATS_FULL] = stats->full;
+    for(i = 0; i < NWAC_STATS_COUNTERS; i++) {
+        debug_counter_reset(&entry->counters[i]);
+        debug_counter_add(&entry->counters[i], values[i]);
+    }
+}
+
+void
+nwac_stats_register(nwac_t* nwac, const char* name)
+{
+    nwac_stats_entry_t* entry = aim_zmalloc(sizeof(*entry));
+    char* hist_name;
+    int i;
+
+    entry->nwac = nwac;
+    entry->name = aim_strdup(name);
+    for(i = 0; i < NWAC_STATS_COUNTERS; i++) {
+        entry->counter_names[i] = aim_fstrdup("nwac.%s.%s", name,
+                                              nwac_stats_counter_info__[i].name);
+        debug_counter_register(&entry->counters[i], entry->counter_names[i],
+                               nwac_stats_counter_info__[i].description);
+    }
+    hist_name = aim_fstrdup("nwac.%s.occupancy", name);
+    entry->occupancy = histogram_create(hist_name);
+    aim_free(hist_name);
+
+    os_sem_take(nwac_stats_lock__);
+    list_push(&nwac_stats_caches__, &entry->links);
+    os_sem_give(nwac_stats_lock__);
+}
+
+void
+nwac_stats_unregister(nwac_t* nwac)
+{
+    struct list_links *cur, *next;
+    int i;
+
+    os_sem_take(nwac_stats_lock__);
+    LIST_FOREACH_SAFE(&nwac_stats_caches__, cur, next) {
+        nwac_stats_entry_t* entry = container_of(cur, links, nwac_stats_entry_t);
+        if(entry->nwac == nwac) {
+            list_remove(&entry->links);
+            for(i = 0; i < NWAC_STATS_COUNTERS; i++) {
+                debug_counter_unregister(&entry->counters[i]);
+                aim_free(entry->counter_names[i]);
+            }
+            histogram_destroy(entry->occupancy);
+            aim_free(entry->name);
+            aim_free(entry);
+        }
+    }
+    os_sem_give(nwac_stats_lock__);
+}
+
+void
+nwac_stats_sync(void)
+{
+    struct list_links* cur;
+
+    os_sem_take(nwac_stats_lock__);
+    LIST_FOREACH(&nwac_stats_caches__, cur) {
+        nwac_stats_entry_t* entry = container_of(cur, links, nwac_stats_entry_t);
+        nwac_stats_t stats;
+        nwac_stats_sync__(entry, &stats);
+    }
+    os_sem_give(nwac_stats_lock__);
+}
+
+int
+nwac_stats_show_registered(const char* prefix, aim_pvs_t* pvs)
+{
+    struct list_links* cur;
+    int count = 0;
+
+    os_sem_take(nwac_stats_lock__);
+    LIST_FOREACH(&nwac_stats_caches__, cur) {
+        nwac_stats_entry_t* entry = container_of(cur, links, nwac_stats_entry_t);
+        nwac_stats_t stats;
+        if(prefix && strncmp(entry->name, prefix, strlen(prefix))) {
+            continue;
+        }
+        nwac_stats_sync__(entry, &stats);
+        aim_printf(pvs, "%s: %d-way, %d blocks\n", entry->name,
+                   entry->nwac->block_size, entry->nwac->block_count);
+        nwac_stats_show(&stats, pvs);
+        count++;
+    }
+    os_sem_give(nwac_stats_lock__);
+
+    return count;
+}
+
+#endif /* NWAC_CONFIG_INCLUDE_STATS */
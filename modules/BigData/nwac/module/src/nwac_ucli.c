@@ -24,6 +24,7 @@
 #include <uCli/ucli.h>
 #include <uCli/ucli_argparse.h>
 #include <uCli/ucli_handler_macros.h>
+#include <nwac/nwac_stats.h>
 
 static ucli_status_t
 nwac_ucli_ucli__config__(ucli_context_t* uc)
@@ -31,6 +32,26 @@ nwac_ucli_ucli__config__(ucli_context_t* uc)
     UCLI_HANDLER_MACRO_MODULE_CONFIG(nwac)
 }
 
+#if NWAC_CONFIG_INCLUDE_STATS == 1
+static ucli_status_t
+nwac_ucli_ucli__stats__(ucli_context_t* uc)
+{
+    UCLI_COMMAND_INFO(uc,
+                      "stats", -1,
+                      "$summary#Show search counters and occupancy of registered caches.");
+
+    const char* prefix = NULL;
+    if(uc->pargs->count > 0) {
+        UCLI_ARGPARSE_OR_RETURN(uc, "s", &prefix);
+    }
+
+    if(nwac_stats_show_registered(prefix, &uc->pvs) == 0) {
+        ucli_printf(uc, "no caches registered\n");
+    }
+    return UCLI_STATUS_OK;
+}
+#endif
+
 /* <auto.ucli.handlers.start> */
 /******************************************************************************
  *
@@ -41,6 +62,9 @@ nwac_ucli_ucli__config__(ucli_context_t* uc)
 static ucli_command_handler_f nwac_ucli_ucli_handlers__[] =
 {
     nwac_ucli_ucli__config__,
+#if NWAC_CONFIG_INCLUDE_STATS == 1
+    nwac_ucli_ucli__stats__,
+#endif
     NULL
 };
 /******************************************************************************/
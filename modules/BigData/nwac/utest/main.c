@@ -27,6 +27,16 @@
 
 #include <OS/os_time.h>
 
+#if NWAC_CONFIG_LOCK_STRIPES > 0
+#include <pthread.h>
+#endif
+
+#if NWAC_CONFIG_INCLUDE_STATS == 1
+#include <nwac/nwac_stats.h>
+#include <debug_counter/debug_counter.h>
+#include <histogram/histogram.h>
+#endif
+
 #define AIM_LOG_MODULE_NAME nwac_unittest
 #include <AIM/aim_log.h>
 AIM_LOG_STRUCT_DEFINE(
@@ -167,6 +177,55 @@ perftest__(nwac_t* nwac, int search_count)
     return 0;
 }
 
+/*
+ * Search random keys from twice as many as fit, serially (batch 0) or
+ * in batches.
+ */
+int
+perftest_batch__(nwac_t* nwac, int search_count, int batch)
+{
+    static uint8_t keys[NWAC_BATCH_SIZE][KEY_SIZE];
+    uint8_t* key_ptrs[NWAC_BATCH_SIZE];
+    nwac_entry_t* entries[NWAC_BATCH_SIZE];
+    uint32_t state = 1;
+    uint64_t start, end;
+    int i, j, k, n, done;
+
+    for(j = 0; j < NWAC_BATCH_SIZE; j++) {
+        key_ptrs[j] = keys[j];
+    }
+
+    start = os_time_thread();
+    for(i = 0; i < search_count; i += n) {
+        n = batch ? batch : 1;
+        for(j = 0; j < n; j++) {
+            state = state * 1103515245 + 12345;
+            *(uint32_t*)keys[j] = state % (2 * nwac->entry_count);
+        }
+        for(j = 0; j < n; j += done) {
+            if(batch) {
+                done = nwac_search_batch(nwac, key_ptrs + j, entries, n - j, 1);
+            }
+            else {
+                entries[0] = nwac_search(nwac, key_ptrs[j], 1);
+                done = 1;
+            }
+            for(k = 0; k < done; k++) {
+                test_entry_t* te = (test_entry_t*)entries[k];
+                if(te->hdr.valid == 0) {
+                    te->hdr.valid = 1;
+                    memcpy(te->key, key_ptrs[j + k], KEY_SIZE);
+                }
+            }
+        }
+    }
+    end = os_time_thread();
+    AIM_LOG_MSG("nwac(%d,%d) batch %d: %f searches/sec",
+                nwac->block_size, nwac->entry_count, batch,
+                search_count / ((end - start) / (1000.0*1000)));
+    return 0;
+}
+
 int
 perftest(int n, int entry_count, int search_count)
 {
@@ -177,16 +236,430 @@ perftest(int n, int entry_count, int search_count)
     return rv;
 }
 
+#define BATCH_KEYS 20000
+#define BATCH_KEY_RANGE 96
+
+/*
+ * Run the same key stream through one cache serially and another in
+ * batches. Both must give the same entries and end up identical. Every
+ * fourth round runs with eviction disabled.
+ */
+int
+test_batch(nwac_policy_t policy, int two_choice)
+{
+    nwac_t* serial = nwac_create(4, KEY_SIZE, sizeof(test_entry_t), 64);
+    nwac_t* batched = nwac_create(4, KEY_SIZE, sizeof(test_entry_t), 64);
+    static uint8_t keys[BATCH_KEYS][KEY_SIZE];
+    uint8_t* key_ptrs[BATCH_KEYS];
+    nwac_entry_t* entries[NWAC_BATCH_SIZE];
+    uint32_t state = 1;
+    int i, j, done, short_batches = 0;
+
+    if(nwac_policy_set(serial, policy) < 0) {
+        nwac_destroy(serial);
+        nwac_destroy(batched);
+        return 0;
+    }
+    nwac_policy_set(batched, policy);
+    nwac_two_choice_set(serial, two_choice);
+    nwac_two_choice_set(batched, two_choice);
+
+    for(i = 0; i < BATCH_KEYS; i++) {
+        state = state * 1103515245 + 12345;
+        memset(keys[i], 0, KEY_SIZE);
+        keys[i][0] = (state >> 16) % BATCH_KEY_RANGE;
+        key_ptrs[i] = keys[i];
+    }
+
+    for(i = 0; i < BATCH_KEYS; i += NWAC_BATCH_SIZE) {
+        int round = i / NWAC_BATCH_SIZE;
+        int end = aim_imin(i + NWAC_BATCH_SIZE, BATCH_KEYS);
+        uint64_t now = (round % 4 == 3) ? 0 : round + 1;
+
+        for(j = i; j < end; j += done) {
+            int k;
+            done = nwac_search_batch(batched, key_ptrs + j, entries, end - j, now);
+            AIM_TRUE_OR_DIE(done >= 1 && done <= end - j);
+            short_batches += (j + done < end);
+
+            for(k = 0; k < done; k++) {
+                test_entry_t* se = (test_entry_t*)nwac_search(serial, keys[j+k], now);
+                test_entry_t* be = (test_entry_t*)entries[k];
+                if(se == NULL || be == NULL) {
+                    AIM_TRUE_OR_DIE(se == NULL && be == NULL);
+                    continue;
+                }
+                AIM_TRUE_OR_DIE((uint8_t*)se - serial->cache ==
+                                (uint8_t*)be - batched->cache);
+                AIM_TRUE_OR_DIE(se->hdr.valid == be->hdr.valid);
+                if(!se->hdr.valid) {
+                    se->hdr.valid = be->hdr.valid = 1;
+                    memcpy(se->key, keys[j+k], KEY_SIZE);
+                    memcpy(be->key, keys[j+k], KEY_SIZE);
+                    se->index = be->index = 0;
+                }
+                se->index++;
+                be->index++;
+            }
+        }
+    }
+
+    AIM_TRUE_OR_DIE(memcmp(serial->cache, batched->cache,
+                           serial->entry_size * serial->entry_count) == 0);
+    AIM_TRUE_OR_DIE(memcmp(serial->hands, batched->hands,
+                           sizeof(serial->hands[0]) * serial->block_count) == 0);
+#if NWAC_CONFIG_INCLUDE_TAGS == 1
+    AIM_TRUE_OR_DIE(memcmp(serial->tags, batched->tags,
+                           serial->tag_stride * serial->block_count) == 0);
+#endif
+    AIM_LOG_MSG("batch policy %d two_choice %d: %d batches ended early",
+                policy, two_choice, short_batches);
+
+    nwac_destroy(serial);
+    nwac_destroy(batched);
+    return 0;
+}
+
+#define PLACEMENT_ENTRIES 4096
+#define PLACEMENT_PASSES 16
+
+/*
+ * Search a working set of a given fraction of the cache size in random
+ * order, and return the steady state misses and evictions of valid
+ * entries per 1000 searches. Every key of the working set would fit.
+ */
+static void
+placement_run__(int two_choice, int percent, int* misses, int* evictions)
+{
+    nwac_t* nwac = nwac_create(8, KEY_SIZE, sizeof(test_entry_t), PLACEMENT_ENTRIES);
+    int keys = PLACEMENT_ENTRIES * percent / 100;
+    int searches = keys * PLACEMENT_PASSES;
+    uint8_t key[KEY_SIZE];
+    uint32_t state = 1;
+    uint64_t now = 1;
+    int i, pass;
+
+    nwac_two_choice_set(nwac, two_choice);
+    *misses = *evictions = 0;
+
+    /* The first pass warms the cache up */
+    for(pass = 0; pass <= PLACEMENT_PASSES; pass++) {
+        for(i = 0; i < keys; i++) {
+            test_entry_t* te;
+            state = state * 1103515245 + 12345;
+            memset(key, 0, sizeof(key));
+            *(uint32_t*)key = (state >> 8) % keys;
+            te = (test_entry_t*)nwac_search(nwac, key, now++);
+            if(te->hdr.valid == 0) {
+                if(pass > 0) {
+                    (*misses)++;
+                    /* Claimed entries that had been evicted were live */
+                    *evictions += (te->index == 1);
+                }
+                te->hdr.valid = 1;
+                te->index = 1;
+                memcpy(te->key, key, sizeof(key));
+            }
+        }
+    }
+
+    *misses = (int)((int64_t)*misses * 1000 / searches);
+    *evictions = (int)((int64_t)*evictions * 1000 / searches);
+    nwac_destroy(nwac);
+}
+
+int
+test_placement(void)
+{
+    int percent;
+    for(percent = 80; percent <= 95; percent += 5) {
+        int misses1, evictions1, misses2, evictions2;
+        placement_run__(0, percent, &misses1, &evictions1);
+        placement_run__(1, percent, &misses2, &evictions2);
+        AIM_LOG_MSG("placement at %d%% occupancy, per 1000 searches: "
+                    "one block %d misses %d evictions, two choice %d misses %d evictions",
+                    percent, misses1, evictions1, misses2, evictions2);
+        if(misses2 >= misses1) {
+            AIM_LOG_ERROR("two choice placement did not reduce misses.");
+            return -1;
+        }
+    }
+    return 0;
+}
+
 int
-test_nwac(int n, int size, int iterations)
+test_nwac(int n, int size, int iterations, nwac_policy_t policy, int two_choice)
 {
     int rv;
     nwac_t* nwac = nwac_create(n, KEY_SIZE, sizeof(test_entry_t), size);
+    nwac_two_choice_set(nwac, two_choice);
+    if(nwac_policy_set(nwac, policy) < 0) {
+        /* Not available in this configuration */
+        nwac_destroy(nwac);
+        return 0;
+    }
     rv = test_nwac__(nwac, iterations);
     nwac_destroy(nwac);
     return rv;
 }
 
+#define SCAN_HOT 4
+#define SCAN_COLD 8
+#define SCAN_ROUNDS 1000
+
+/*
+ * One 8 way block sees a few hot keys between bursts of keys that are
+ * never seen again. The first round only loads the hot keys. Returns
+ * the hot key hit rate of the later rounds in percent.
+ */
+int
+scan_hit_rate(nwac_policy_t policy)
+{
+    nwac_t* nwac = nwac_create(8, KEY_SIZE, sizeof(test_entry_t), 8);
+    uint8_t key[KEY_SIZE];
+    uint64_t now = 1;
+    int round, i, hits = 0;
+
+    if(nwac_policy_set(nwac, policy) < 0) {
+        nwac_destroy(nwac);
+        return -1;
+    }
+
+    for(round = 0; round < SCAN_ROUNDS; round++) {
+        for(i = 0; i < SCAN_HOT + (round ? SCAN_COLD : 0); i++) {
+            test_entry_t* te;
+            memset(key, 0, sizeof(key));
+            if(i < SCAN_HOT) {
+                key[0] = i;
+            }
+            else {
+                memcpy(key + 1, &now, sizeof(now));
+            }
+            te = (test_entry_t*)nwac_search(nwac, key, now++);
+            AIM_TRUE_OR_DIE(te != NULL);
+            if(te->hdr.valid) {
+                hits += (i < SCAN_HOT);
+            }
+            else {
+                memcpy(te->key, key, sizeof(key));
+                te->hdr.valid = 1;
+            }
+        }
+    }
+
+    nwac_destroy(nwac);
+    return hits * 100 / (SCAN_HOT * (SCAN_ROUNDS - 1));
+}
+
+int
+test_scan(void)
+{
+    int lru = scan_hit_rate(NWAC_POLICY_LRU);
+    int clock = scan_hit_rate(NWAC_POLICY_CLOCK);
+    int random = scan_hit_rate(NWAC_POLICY_RANDOM);
+
+    /* scan_hit_rate() returns -1 when LRU is compiled out */
+    if(lru < 0) {
+        AIM_LOG_MSG("scan hot hit rate: clock=%d%% random=%d%%",
+                    clock, random);
+    }
+    else {
+        AIM_LOG_MSG("scan hot hit rate: lru=%d%% clock=%d%% random=%d%%",
+                    lru, clock, random);
+    }
+    if(clock < 90 || clock <= lru) {
+        AIM_LOG_ERROR("CLOCK did not keep the hot keys.");
+        return -1;
+    }
+    return 0;
+}
+
+#if NWAC_CONFIG_LOCK_STRIPES > 0
+#define STRIPE_THREADS 4
+#define STRIPE_KEYS 64
+#define STRIPE_SEARCHES 100000
+
+/*
+ * Threads search a shared set of keys and count their hits in the
+ * entries. The cache is large enough that nothing is evicted, so the
+ * counts only add up if every update happened under the stripe lock.
+ */
+static void*
+stripe_worker__(void* arg)
+{
+    nwac_t* nwac = arg;
+    uint8_t key[KEY_SIZE];
+    int i;
+
+    for(i = 0; i < STRIPE_SEARCHES; i++) {
+        test_entry_t* te;
+        memset(key, i % STRIPE_KEYS, sizeof(key));
+        te = (test_entry_t*)nwac_search_lock(nwac, key, i + 1);
+        AIM_TRUE_OR_DIE(te != NULL);
+        if(te->hdr.valid) {
+            AIM_TRUE_OR_DIE(memcmp(te->key, key, sizeof(key)) == 0);
+            te->index++;
+        }
+        else {
+            memcpy(te->key, key, sizeof(key));
+            te->index = 1;
+            te->hdr.valid = 1;
+        }
+        nwac_entry_unlock(nwac, (nwac_entry_t*)te);
+    }
+    return NULL;
+}
+
+int
+test_stripes(int two_choice)
+{
+    nwac_t* nwac = nwac_create(8, KEY_SIZE, sizeof(test_entry_t), 4096);
+    pthread_t threads[STRIPE_THREADS];
+    test_entry_t* te;
+    int i, total = 0, entries = 0;
+
+    nwac_two_choice_set(nwac, two_choice);
+    for(i = 0; i < STRIPE_THREADS; i++) {
+        pthread_create(&threads[i], NULL, stripe_worker__, nwac);
+    }
+    for(i = 0; i < STRIPE_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    for(te = (test_entry_t*)nwac->cache, i = 0; i < nwac->entry_count; te++, i++) {
+        if(te->hdr.valid) {
+            AIM_TRUE_OR_DIE(te->hdr.evictions == 0);
+            total += te->index;
+            entries++;
+        }
+    }
+#if NWAC_CONFIG_INCLUDE_STATS == 1
+    {
+        nwac_stats_t stats;
+        nwac_stats_get(nwac, &stats, NULL);
+        AIM_TRUE_OR_DIE(stats.lookups == STRIPE_THREADS*STRIPE_SEARCHES);
+        AIM_TRUE_OR_DIE(stats.fills == STRIPE_KEYS && stats.evictions == 0);
+    }
+#endif
+    nwac_destroy(nwac);
+
+    if(entries != STRIPE_KEYS || total != STRIPE_THREADS*STRIPE_SEARCHES) {
+        AIM_LOG_ERROR("striped search lost updates: %d entries, %d hits",
+                      entries, total);
+        return -1;
+    }
+    return 0;
+}
+#endif
+
+#if NWAC_CONFIG_INCLUDE_STATS == 1
+static uint64_t
+debug_counter_value__(const char* name)
+{
+    struct list_links* cur;
+    LIST_FOREACH(debug_counter_list(), cur) {
+        debug_counter_t* counter = container_of(cur, links, debug_counter_t);
+        if(!strcmp(counter->name, name)) {
+            return debug_counter_get(counter);
+        }
+    }
+    AIM_DIE("debug counter %s not found", name);
+    return 0;
+}
+
+static test_entry_t*
+stats_search__(nwac_t* nwac, int k, uint64_t now)
+{
+    uint8_t key[KEY_SIZE];
+    test_entry_t* te;
+
+    memset(key, k, sizeof(key));
+    te = (test_entry_t*)nwac_search_block(nwac, 0, key, now);
+    if(te && !te->hdr.valid) {
+        memcpy(te->key, key, sizeof(key));
+        te->hdr.valid = 1;
+    }
+    return te;
+}
+
+int
+test_stats(void)
+{
+    nwac_t* nwac = nwac_create(4, KEY_SIZE, sizeof(test_entry_t), 16);
+    struct histogram* hist;
+    nwac_stats_t stats;
+    int k;
+
+    nwac_stats_register(nwac, "utest");
+
+    /* Fill block 0, hit once, then miss with and without eviction */
+    for(k = 0; k < 4; k++) {
+        AIM_TRUE_OR_DIE(stats_search__(nwac, k, 0) != NULL);
+    }
+    AIM_TRUE_OR_DIE(stats_search__(nwac, 0, 0) != NULL);
+    AIM_TRUE_OR_DIE(stats_search__(nwac, 4, 0) == NULL);
+    AIM_TRUE_OR_DIE(stats_search__(nwac, 4, 1) != NULL);
+
+    nwac_stats_get(nwac, &stats, NULL);
+    nwac_stats_show(&stats, &aim_pvs_stdout);
+    AIM_TRUE_OR_DIE(stats.lookups == 7 && stats.hits == 1 && stats.fills == 4);
+    AIM_TRUE_OR_DIE(stats.evictions == 1 && stats.full == 1);
+    AIM_TRUE_OR_DIE(stats.valid_entries == 4);
+    AIM_TRUE_OR_DIE(stats.empty_blocks == 3 && stats.full_blocks == 1);
+
+    /* Published counters and occupancy */
+    nwac_stats_sync();
+    AIM_TRUE_OR_DIE(debug_counter_value__("nwac.utest.lookup") == 7);
+    AIM_TRUE_OR_DIE(debug_counter_value__("nwac.utest.eviction") == 1);
+    hist = histogram_find("nwac.utest.occupancy");
+    AIM_TRUE_OR_DIE(hist != NULL);
+    AIM_TRUE_OR_DIE(hist->counts[histogram_bucket(0)] == 3);
+    AIM_TRUE_OR_DIE(hist->counts[histogram_bucket(4)] == 1);
+    AIM_TRUE_OR_DIE(nwac_stats_show_registered("utest", &aim_pvs_stdout) == 1);
+    AIM_TRUE_OR_DIE(nwac_stats_show_registered("other", &aim_pvs_stdout) == 0);
+
+    nwac_stats_clear(nwac);
+    nwac_stats_get(nwac, &stats, NULL);
+    AIM_TRUE_OR_DIE(stats.lookups == 0 && stats.valid_entries == 4);
+
+    /* Destroying the cache unregisters it */
+    nwac_destroy(nwac);
+    AIM_TRUE_OR_DIE(histogram_find("nwac.utest.occupancy") == NULL);
+    return 0;
+}
+#endif
+
+int
+test_nwac_sizes(nwac_policy_t policy, int two_choice)
+{
+    int n, size, iterations;
+
+    for(n = 2; n <= 8; n <<= 1) {
+        for(size=n*2; size < n*256; size <<= 1) {
+            for(iterations = size; iterations < size*16; iterations <<= 1) {
+                AIM_LOG_MSG("==");
+                if(test_nwac(n, size, iterations, policy, two_choice) != 0) {
+                    AIM_LOG_ERROR("failed: policy=%d two_choice=%d n=%d size=%d count=%d",
+                                  policy, two_choice, n, size, iterations);
+                    return 1;
+                }
+                if(test_nwac(n, size, iterations+1, policy, two_choice) != 0) {
+                    AIM_LOG_ERROR("failed: policy=%d two_choice=%d n=%d size=%d iterations=%d",
+                                  policy, two_choice, n, size, iterations+1);
+                    return 1;
+                }
+                if(test_nwac(n, size, iterations-1, policy, two_choice) != 0) {
+                    AIM_LOG_ERROR("failed: policy=%d two_choice=%d n=%d size=%d iterations=%d",
+                                  policy, two_choice, n, size, iterations-1);
+                    return 1;
+                }
+                AIM_LOG_MSG("==");
+            }
+        }
+    }
+    return 0;
+}
+
 NWAC_DEFINE_STATIC(static_nwac, 8, sizeof(test_entry_t), 256, KEY_SIZE);
 
 int
@@ -195,6 +668,8 @@ aim_main(int argc, char* argv[])
     int n;
     int size;
     int iterations;
+    nwac_policy_t policy;
+    int two_choice;
 
     if(argc > 1) {
         if(!strcmp(argv[1], "perf")) {
@@ -203,7 +678,16 @@ aim_main(int argc, char* argv[])
                 perftest(8, 512, iterations);
             }
             else {
-                if(!strcmp(argv[2], "all")) {
+                if(!strcmp(argv[2], "batch")) {
+                    /* A cache larger than the CPU caches */
+                    nwac_t* nwac = nwac_create(8, KEY_SIZE, sizeof(test_entry_t), 1024*1024);
+                    int iterations = 4*1024*1024;
+                    perftest_batch__(nwac, iterations, 0);
+                    perftest_batch__(nwac, iterations, 8);
+                    perftest_batch__(nwac, iterations, NWAC_BATCH_SIZE);
+                    nwac_destroy(nwac);
+                }
+                else if(!strcmp(argv[2], "all")) {
                     int iterations = 16*1024*1024;
                     perftest(4, 128, iterations);
                     perftest(4, 256, iterations);
@@ -232,33 +716,20 @@ aim_main(int argc, char* argv[])
             n = atoi(argv[1]);
             size = atoi(argv[2]);
             iterations = atoi(argv[3]);
-            return test_nwac(n, size, iterations);
+            return test_nwac(n, size, iterations, NWAC_POLICY_LRU, 0);
         }
         fprintf(stderr, "unknown option '%s'\n", argv[1]);
         return -1;
     }
 
     /* Default Unit Test */
-    for(n = 2; n <= 8; n <<= 1) {
-        for(size=n*2; size < n*256; size <<= 1) {
-            for(iterations = size; iterations < size*16; iterations <<= 1) {
-                AIM_LOG_MSG("==");
-                if(test_nwac(n, size, iterations) != 0) {
-                    AIM_LOG_ERROR("failed: n=%d size=%d count=%d",
-                                  n, size, iterations);
-                    return 1;
-                }
-                if(test_nwac(n, size, iterations+1) != 0) {
-                    AIM_LOG_ERROR("failed: n=%d size=%d iterations=%d",
-                                  n, size, iterations+1);
-                    return 1;
-                }
-                if(test_nwac(n, size, iterations-1) != 0) {
-                    AIM_LOG_ERROR("failed: n=%d size=%d iterations=%d",
-                           n, size, iterations-1);
-                    return 1;
-                }
-                AIM_LOG_MSG("==");
+    for(policy = NWAC_POLICY_LRU; policy <= NWAC_POLICY_RANDOM; policy++) {
+        for(two_choice = 0; two_choice <= 1; two_choice++) {
+            if(test_nwac_sizes(policy, two_choice) != 0) {
+                return 1;
+            }
+            if(test_batch(policy, two_choice) != 0) {
+                return 1;
             }
         }
     }
@@ -268,6 +739,22 @@ aim_main(int argc, char* argv[])
         test_nwac__(&static_nwac, 1024);
         nwac_destroy(&static_nwac);
     }
+    if(test_scan() != 0) {
+        return 1;
+    }
+    if(test_placement() != 0) {
+        return 1;
+    }
+#if NWAC_CONFIG_INCLUDE_STATS == 1
+    if(test_stats() != 0) {
+        return 1;
+    }
+#endif
+#if NWAC_CONFIG_LOCK_STRIPES > 0
+    if(test_stripes(0) != 0 || test_stripes(1) != 0) {
+        return 1;
+    }
+#endif
     return 0;
 }
 
@@ -10,6 +10,7 @@ BASEDIR := $(dir $(lastword $(MAKEFILE_LIST)))
 BigHash_BASEDIR := $(BASEDIR)BigData/BigHash
 BigList_BASEDIR := $(BASEDIR)BigData/BigList
 BigRing_BASEDIR := $(BASEDIR)BigData/BigRing
+BigVector_BASEDIR := $(BASEDIR)BigData/BigVector
 ELS_BASEDIR := $(BASEDIR)ELS
 FME_BASEDIR := $(BASEDIR)FME
 IOF_BASEDIR := $(BASEDIR)IOF
@@ -33,4 +34,4 @@ timer_wheel_BASEDIR := $(BASEDIR)timer_wheel
 uCli_BASEDIR := $(BASEDIR)uCli
 
 
-ALL_MODULES := $(ALL_MODULES) BigHash BigList BigRing ELS FME IOF OS PPE VPI bloom_filter cjson cjson_util debug_counter murmur nwac orc pimu sff sff_utest slot_allocator snmp_subagent timer_wheel uCli
+ALL_MODULES := $(ALL_MODULES) BigHash BigList BigRing BigVector ELS FME IOF OS PPE VPI bloom_filter cjson cjson_util debug_counter murmur nwac orc pimu sff sff_utest slot_allocator snmp_subagent timer_wheel uCli
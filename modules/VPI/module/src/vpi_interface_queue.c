@@ -27,6 +27,13 @@
 #include "vpi_interface_queue.h"
 
 #include <OS/os_sem.h>
+#include <BigList/biglist_mpsc.h>
+#include <AIM/aim_list.h>
+
+/* pq_unshift__ blocks in biglist_mpsc_wait */
+#if BIGLIST_CONFIG_INCLUDE_LOCKED != 1
+#error "The VPI queue interface requires BIGLIST_CONFIG_INCLUDE_LOCKED=1"
+#endif
 
 static const char* queue_interface_docstring__ =
     "----------------------------------------------------\n"
@@ -43,15 +50,16 @@ static const char* queue_interface_docstring__ =
  *
  *****************************************************************************/
 typedef struct vpi_qpacket_s {
-    char* data;
+    biglist_mpsc_node_t node;
     int size;
+    unsigned char data[];
 } vpi_qpacket_t;
 
 static vpi_qpacket_t*
 qpacket_alloc__(unsigned char* data, int size)
 {
-    vpi_qpacket_t* qp = aim_zmalloc(sizeof(*qp));
-    qp->data = aim_memdup(data, size);
+    vpi_qpacket_t* qp = aim_malloc(sizeof(*qp) + size);
+    VPI_MEMCPY(qp->data, data, size);
     qp->size = size;
     return qp;
 }
@@ -59,9 +67,6 @@ static void
 qpacket_free__(vpi_qpacket_t* qp)
 {
     if(qp) {
-        if(qp->data) {
-            aim_free(qp->data);
-        }
         aim_free(qp);
     }
 }
@@ -76,17 +81,14 @@ typedef struct vpi_pq_s {
     /** The name of this queue */
     const char* name;
 
-    /** Queue Management lock. */
-    os_sem_t mlock;
-
     /**
-     * Packets available semaphore.
-     * Do not take while holding the management lock.
+     * Reader lock. Senders push without locking, but the queue
+     * allows only one reader at a time.
      */
-    os_sem_t packets_available;
+    os_sem_t mlock;
 
     /** The actual packet queue */
-    biglist_t* list;
+    biglist_mpsc_t queue;
 
     /** Packet history queue (TBD) */
     biglist_t* history_list;
@@ -131,7 +133,7 @@ pq_alloc_locked__(const char* name)
 
     pq->name = aim_strdup(name);
     pq->mlock = os_sem_create(1);
-    pq->packets_available = os_sem_create(0);
+    biglist_mpsc_init(&pq->queue);
     pq->refcount = 0;
 
     pq_list__->list = biglist_prepend(pq_list__->list, pq);
@@ -145,13 +147,17 @@ pq_alloc_locked__(const char* name)
 void
 pq_destroy__(vpi_pq_t* pq)
 {
+    biglist_mpsc_node_t* node;
+
     pq->refcount--;
     if(pq->refcount <= 0) {
         biglist_locked_remove(pq_list__, pq);
         aim_free((char*)pq->name);
         os_sem_destroy(pq->mlock);
-        os_sem_destroy(pq->packets_available);
-        biglist_free_all(pq->list, (biglist_free_f)qpacket_free__);
+        while((node = biglist_mpsc_pop(&pq->queue)) != NULL) {
+            qpacket_free__(container_of(node, node, vpi_qpacket_t));
+        }
+        biglist_mpsc_destroy(&pq->queue);
         aim_free(pq);
     }
 }
@@ -224,23 +230,27 @@ vpi_queue_interface_register(void)
 void
 pq_append__(vpi_pq_t* q, vpi_qpacket_t* qp)
 {
-    os_sem_take(q->mlock);
-    q->list = biglist_append(q->list, qp);
-    os_sem_give(q->mlock);
-    os_sem_give(q->packets_available);
+    biglist_mpsc_push(&q->queue, &qp->node);
 }
 
+/**
+ * Wait for and remove the oldest packet.
+ */
 vpi_qpacket_t*
 pq_unshift__(vpi_pq_t* q)
 {
-    vpi_qpacket_t* rv = NULL;
+    biglist_mpsc_node_t* node;
+
     os_sem_take(q->mlock);
-    if(q->list) {
-        rv = (vpi_qpacket_t*)(q->list->data);
-        q->list = biglist_remove_link_free(q->list, q->list);
+    /*
+     * The pop can miss a packet whose sender is still linking it
+     * in, so wait again until it shows up.
+     */
+    while((node = biglist_mpsc_pop(&q->queue)) == NULL) {
+        biglist_mpsc_wait(&q->queue, 0);
     }
     os_sem_give(q->mlock);
-    return rv;
+    return container_of(node, node, vpi_qpacket_t);
 }
 
 int
@@ -255,26 +265,9 @@ int
 vpi_queue_interface_recv(vpi_interface_t* _vi, unsigned char* data, int size)
 {
     VICAST(vi, _vi);
-    vpi_qpacket_t* qpacket = NULL;
+    vpi_qpacket_t* qpacket = pq_unshift__(vi->rq);
     int rv;
 
-    do {
-        /** A packet must be available. */
-        os_sem_take(vi->rq->packets_available);
-
-        qpacket = pq_unshift__(vi->rq);
-
-        /**
-         * We don't expect multiple queue readers, so the qp pointer
-         * should never be NULL at this point.
-         *
-         * Treat this as a bug for now.
-         */
-        if(qpacket == NULL) {
-            AIM_LOG_ERROR(vi, "packet semaphore was signalled but packet was missing.");
-        }
-    } while(qpacket == NULL);
-
     rv = aim_imin(size, qpacket->size);
     VPI_MEMCPY(data, qpacket->data, rv);
     qpacket_free__(qpacket);
@@ -285,7 +278,12 @@ int
 vpi_queue_interface_recv_ready(vpi_interface_t* _vi)
 {
     VICAST(vi, _vi);
-    return vi->rq->list != NULL;
+    /*
+     * No mlock: a receiver blocked in pq_unshift__ holds it. Without it
+     * the answer is only a hint, which is all a ready check gives anyway,
+     * since another receiver can take the packet before our recv.
+     */
+    return !biglist_mpsc_empty(&vi->rq->queue);
 }
 
 int
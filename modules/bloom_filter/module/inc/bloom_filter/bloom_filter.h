@@ -36,6 +36,13 @@
  *
  * The largest allowed value of M is 65536. Larger values will be silently
  * ignored.
+ *
+ * Removal needs a reference count per bit. bloom_filter_create uses 16-bit
+ * counts, 16 times the size of the bitmap. bloom_filter_create_compact
+ * packs 4-bit counts instead, 4 times the size of the bitmap and a quarter
+ * of the 16-bit counts. A count saturates once 15 items share its bit, and
+ * the bit then stays set for good. Lookups only read the bitmap in either
+ * mode.
  */
 
 #ifndef __BLOOM_FILTER_H__
@@ -54,6 +61,13 @@ typedef struct bloom_filter bloom_filter_t;
  */
 bloom_filter_t *bloom_filter_create(int m);
 
+/**
+ * Create a bloom filter with 4-bit reference counts
+ *
+ * @param m Size of the bloom filter, in bits. Must be a power of 2.
+ */
+bloom_filter_t *bloom_filter_create_compact(int m);
+
 /**
  * Destroy a bloom filter
  */
@@ -88,6 +102,7 @@ static inline bool bloom_filter_lookup(bloom_filter_t *b, uint32_t hash);
 struct bloom_filter {
     aim_bitmap_t bitmap;
     uint16_t *refcounts; /* Reference count for each bit in the bitmap */
+    uint8_t *refcounts4; /* Or two 4-bit counts per byte, if compact */
     uint32_t mask; /* Size minus one */
 };
 
@@ -0,0 +1,231 @@
+/****************************************************************
+ *
+ *        Copyright 2014, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+
+/**
+ * Blocked bloom filter
+ *
+ * A variant of the bloom filter in bloom_filter.h where every probe for an
+ * item falls in the same 64 byte block, so a lookup touches one cache line
+ * however large the filter is. The block is picked by the high bits of the
+ * hash. The rest of the hash is remixed and multiplied by a different odd
+ * salt for each probe, so the probes don't share hash bits.
+ *
+ * Each probe picks one of the 512 bits in the block. The number of probes
+ * (K) is chosen at create time and may be 1 to 16. With AVX2, lookups
+ * compute eight probes at a time, gather the block words they fall in and
+ * test all their bits at once. Otherwise the probes are tested one by one.
+ *
+ * Keeping the probes in one block costs some false positives compared to
+ * an unblocked filter of the same size and K, since blocks fill unevenly,
+ * but more probes are affordable. Measured with the bloom_filter utest
+ * ("perf"):
+ *   M/N = 8, K = 4 -> 2.5% false positive rate
+ *   M/N = 16, K = 8 -> 0.09% false positive rate
+ * More than about M/N / 2 probes makes the rate worse again. With millions
+ * of items, colliding 32-bit hashes add N / 2^32 to the rate.
+ *
+ * Unlike bloom_filter_create, M is not limited to 65536. Large filters will
+ * usually want bloom_filter_blocked_create_compact, which keeps 4-bit
+ * reference counts in place of 16-bit ones, as bloom_filter_create_compact.
+ *
+ * Lookups never write and may run concurrently with
+ * bloom_filter_blocked_add_atomic and bloom_filter_blocked_remove_atomic,
+ * which may also run concurrently with each other. These update the
+ * reference counts with compare and swap and the bits with atomic or/and.
+ * A remove that clears a bit rechecks its count and sets it again if a
+ * concurrent add got in first, and an add waits for the removes that had
+ * started before it finished its updates, so once an add returns its item
+ * is found until it is removed. Removes started later are not waited for,
+ * so a steady stream of removes can't hold up an add, but removes finish in
+ * the order they started and one stalled remove delays later removes and
+ * adds until it completes. The plain bloom_filter_blocked_add and
+ * bloom_filter_blocked_remove must not be mixed with the atomic ones.
+ */
+
+#ifndef __BLOOM_FILTER_BLOCKED_H__
+#define __BLOOM_FILTER_BLOCKED_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <AIM/aim.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+typedef struct bloom_filter_blocked bloom_filter_blocked_t;
+
+/**
+ * Create a blocked bloom filter
+ *
+ * @param m Size of the bloom filter, in bits. Rounded up to a multiple of
+ * the 512 bit block size.
+ * @param k Number of probes per item, from 1 to 16.
+ */
+bloom_filter_blocked_t *bloom_filter_blocked_create(int m, int k);
+
+/**
+ * Create a blocked bloom filter with 4-bit reference counts
+ *
+ * The counts take 4 times the size of the bitmap rather than 16.
+ *
+ * @param m Size of the bloom filter, in bits. Rounded up to a multiple of
+ * the 512 bit block size.
+ * @param k Number of probes per item, from 1 to 16.
+ */
+bloom_filter_blocked_t *bloom_filter_blocked_create_compact(int m, int k);
+
+/**
+ * Destroy a blocked bloom filter
+ */
+void bloom_filter_blocked_destroy(bloom_filter_blocked_t *bloom);
+
+/**
+ * Add an item to the set
+ *
+ * @param hash Hash of the item
+ */
+void bloom_filter_blocked_add(bloom_filter_blocked_t *bloom, uint32_t hash);
+
+/**
+ * Remove an item from the set
+ *
+ * @param hash Hash of the item
+ */
+void bloom_filter_blocked_remove(bloom_filter_blocked_t *bloom, uint32_t hash);
+
+/**
+ * Add an item to the set, concurrently with lookups and atomic updates
+ *
+ * @param hash Hash of the item
+ */
+void bloom_filter_blocked_add_atomic(bloom_filter_blocked_t *bloom, uint32_t hash);
+
+/**
+ * Remove an item from the set, concurrently with lookups and atomic updates
+ *
+ * @param hash Hash of the item
+ */
+void bloom_filter_blocked_remove_atomic(bloom_filter_blocked_t *bloom, uint32_t hash);
+
+/**
+ * Check whether an item might exist in the set
+ *
+ * @param hash Hash of the item
+ */
+static inline bool bloom_filter_blocked_lookup(bloom_filter_blocked_t *bloom,
+                                               uint32_t hash);
+
+
+/* Private inline functions */
+
+#define BLOOM_FILTER_BLOCK_WORDS 16
+#define BLOOM_FILTER_BLOCK_BITS (BLOOM_FILTER_BLOCK_WORDS * 32)
+
+struct bloom_filter_blocked {
+    uint32_t *blocks; /* 64 byte aligned, BLOOM_FILTER_BLOCK_WORDS per block */
+    void *blocks_alloc; /* Unaligned allocation backing blocks */
+    uint16_t *refcounts; /* Reference count for each bit in the blocks */
+    uint8_t *refcounts4; /* Or two 4-bit counts per byte, if compact */
+    uint32_t num_blocks;
+    int k;
+    uint32_t remove_next; /* Next ticket for an atomic remove */
+    uint32_t remove_done; /* Atomic removes before this ticket have finished */
+    uint32_t probe_mask[BLOOM_FILTER_BLOCK_WORDS]; /* ~0 for probes 0..k-1 */
+};
+
+static const uint32_t bloom_filter_blocked_salts[BLOOM_FILTER_BLOCK_WORDS] = {
+    0x47b6137b, 0x44974d91, 0x8824ad5b, 0xa2b7289d,
+    0x705495c7, 0x2df1424b, 0x9efc4947, 0x5c6bfb31,
+    0x9e3779b1, 0x85ebca6b, 0xc2b2ae35, 0x27d4eb2f,
+    0x165667b1, 0xd3a2646d, 0xfd7046c5, 0xb55a4f09,
+};
+
+/**
+ * Return the block for a hash, using its high bits.
+ */
+static inline uint32_t
+bloom_filter_blocked_block_index(bloom_filter_blocked_t *bloom, uint32_t hash)
+{
+    return ((uint64_t)hash * bloom->num_blocks) >> 32;
+}
+
+/**
+ * Remix the hash so the probe bits don't depend only on the bits left
+ * over after picking the block. This is the MurmurHash3 finalizer.
+ */
+static inline uint32_t
+bloom_filter_blocked_probe_key(uint32_t hash)
+{
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+/**
+ * Return the bit within the block set by probe i.
+ */
+static inline int
+bloom_filter_blocked_probe_bit(uint32_t key, int i)
+{
+    return (key * bloom_filter_blocked_salts[i]) >> 23;
+}
+
+static inline bool
+bloom_filter_blocked_lookup(bloom_filter_blocked_t *bloom, uint32_t hash)
+{
+    const uint32_t *block = bloom->blocks +
+        bloom_filter_blocked_block_index(bloom, hash) * BLOOM_FILTER_BLOCK_WORDS;
+    uint32_t key = bloom_filter_blocked_probe_key(hash);
+    int i;
+
+    /*
+     * Words may change under us with atomic updates. Each word is read
+     * once, whole, and the gather loads are aligned 32-bit reads.
+     */
+#if defined(__AVX2__)
+    __m256i keys = _mm256_set1_epi32(key);
+    for (i = 0; i < bloom->k; i += 8) {
+        __m256i salts = _mm256_loadu_si256((const __m256i *)&bloom_filter_blocked_salts[i]);
+        __m256i bits = _mm256_srli_epi32(_mm256_mullo_epi32(keys, salts), 23);
+        __m256i words = _mm256_i32gather_epi32((const int *)block, _mm256_srli_epi32(bits, 5), 4);
+        __m256i want = _mm256_sllv_epi32(_mm256_set1_epi32(1),
+                                         _mm256_and_si256(bits, _mm256_set1_epi32(31)));
+        want = _mm256_and_si256(want, _mm256_loadu_si256((const __m256i *)&bloom->probe_mask[i]));
+        if (!_mm256_testc_si256(words, want)) {
+            return false;
+        }
+    }
+#else
+    for (i = 0; i < bloom->k; i++) {
+        int bit = bloom_filter_blocked_probe_bit(key, i);
+        uint32_t word = __atomic_load_n(&block[bit / 32], __ATOMIC_RELAXED);
+        if (((word >> (bit % 32)) & 1) == 0) {
+            return false;
+        }
+    }
+#endif
+
+    return true;
+}
+
+#endif
@@ -18,10 +18,10 @@
  ***************************************************************/
 
 #include <bloom_filter/bloom_filter.h>
+#include "bloom_filter_int.h"
 
-/* Documented in bloom_filter.h */
-bloom_filter_t *
-bloom_filter_create(int size)
+static bloom_filter_t *
+bloom_filter_create__(int size, bool compact)
 {
     AIM_ASSERT(aim_is_pow2_u32(size), "bloom filter size must be a power of 2");
 
@@ -36,18 +36,38 @@ bloom_filter_create(int size)
     bloom_filter_t *bloom = aim_zmalloc(sizeof(*bloom));
 
     aim_bitmap_alloc(&bloom->bitmap, size);
-    bloom->refcounts = aim_zmalloc(size * sizeof(bloom->refcounts[0]));
+    if (compact) {
+        bloom->refcounts4 = aim_zmalloc(bloom_filter_refcounts_size(size, true));
+    }
+    else {
+        bloom->refcounts = aim_zmalloc(bloom_filter_refcounts_size(size, false));
+    }
     bloom->mask = size - 1;
 
     return bloom;
 }
 
+/* Documented in bloom_filter.h */
+bloom_filter_t *
+bloom_filter_create(int size)
+{
+    return bloom_filter_create__(size, false);
+}
+
+/* Documented in bloom_filter.h */
+bloom_filter_t *
+bloom_filter_create_compact(int size)
+{
+    return bloom_filter_create__(size, true);
+}
+
 /* Documented in bloom_filter.h */
 void
 bloom_filter_destroy(bloom_filter_t *bloom)
 {
     aim_bitmap_free(&bloom->bitmap);
     aim_free(bloom->refcounts);
+    aim_free(bloom->refcounts4);
     aim_free(bloom);
 }
 
@@ -59,14 +79,9 @@ bloom_filter_add(bloom_filter_t *bloom, uint32_t hash)
     for (i = 0; i < BLOOM_FILTER_NUM_PROBES; i++) {
         int idx = bloom_filter_probe_index(bloom, hash, i);
 
-        if (bloom->refcounts[idx] == 0) {
+        if (bloom_filter_refcount_inc(bloom->refcounts, bloom->refcounts4, idx)) {
             AIM_BITMAP_SET(&bloom->bitmap, idx);
         }
-
-        /* Prevent overflow */
-        if (bloom->refcounts[idx] != UINT16_MAX) {
-            bloom->refcounts[idx]++;
-        }
     }
 }
 
@@ -79,15 +94,10 @@ bloom_filter_remove(bloom_filter_t *bloom, uint32_t hash)
         int idx = bloom_filter_probe_index(bloom, hash, i);
 
         /*
-         * If the refcount is saturated at UINT16_MAX we
-         * can't decrement it. Doing so would allow
-         * a false negative.
+         * If the refcount is saturated we can't decrement it.
+         * Doing so would allow a false negative.
          */
-        if (bloom->refcounts[idx] != UINT16_MAX) {
-            bloom->refcounts[idx]--;
-        }
-
-        if (bloom->refcounts[idx] == 0) {
+        if (bloom_filter_refcount_dec(bloom->refcounts, bloom->refcounts4, idx)) {
             AIM_BITMAP_CLR(&bloom->bitmap, idx);
         }
     }
@@ -0,0 +1,213 @@
+/****************************************************************
+ *
+ *        Copyright 2014, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+
+#include <bloom_filter/bloom_filter_blocked.h>
+#include "bloom_filter_int.h"
+#include <sched.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_RELAX() __builtin_ia32_pause()
+#else
+#define CPU_RELAX() __asm__ __volatile__("" ::: "memory")
+#endif
+
+/* Spin briefly, then give up the CPU in case a remove needs it */
+#define SPIN_LIMIT 1000
+
+static bloom_filter_blocked_t *
+bloom_filter_blocked_create__(int m, int k, bool compact)
+{
+    AIM_ASSERT(m > 0, "bloom filter size must be positive");
+    AIM_ASSERT(k >= 1 && k <= BLOOM_FILTER_BLOCK_WORDS,
+               "bloom filter probe count must be from 1 to 16");
+
+    bloom_filter_blocked_t *bloom = aim_zmalloc(sizeof(*bloom));
+    int i;
+
+    bloom->num_blocks = (m + BLOOM_FILTER_BLOCK_BITS - 1) / BLOOM_FILTER_BLOCK_BITS;
+    bloom->k = k;
+
+    /* One block per cache line */
+    bloom->blocks_alloc = aim_zmalloc((size_t)bloom->num_blocks * BLOOM_FILTER_BLOCK_BITS / 8 + 63);
+    bloom->blocks = (uint32_t *)(((uintptr_t)bloom->blocks_alloc + 63) & ~(uintptr_t)63);
+
+    size_t bits = (size_t)bloom->num_blocks * BLOOM_FILTER_BLOCK_BITS;
+    if (compact) {
+        bloom->refcounts4 = aim_zmalloc(bloom_filter_refcounts_size(bits, true));
+    }
+    else {
+        bloom->refcounts = aim_zmalloc(bloom_filter_refcounts_size(bits, false));
+    }
+
+    for (i = 0; i < k; i++) {
+        bloom->probe_mask[i] = UINT32_MAX;
+    }
+
+    return bloom;
+}
+
+/* Documented in bloom_filter_blocked.h */
+bloom_filter_blocked_t *
+bloom_filter_blocked_create(int m, int k)
+{
+    return bloom_filter_blocked_create__(m, k, false);
+}
+
+/* Documented in bloom_filter_blocked.h */
+bloom_filter_blocked_t *
+bloom_filter_blocked_create_compact(int m, int k)
+{
+    return bloom_filter_blocked_create__(m, k, true);
+}
+
+/* Documented in bloom_filter_blocked.h */
+void
+bloom_filter_blocked_destroy(bloom_filter_blocked_t *bloom)
+{
+    aim_free(bloom->blocks_alloc);
+    aim_free(bloom->refcounts);
+    aim_free(bloom->refcounts4);
+    aim_free(bloom);
+}
+
+/* Documented in bloom_filter_blocked.h */
+void
+bloom_filter_blocked_add(bloom_filter_blocked_t *bloom, uint32_t hash)
+{
+    uint32_t block = bloom_filter_blocked_block_index(bloom, hash);
+    uint32_t key = bloom_filter_blocked_probe_key(hash);
+    int i;
+
+    for (i = 0; i < bloom->k; i++) {
+        int bit = bloom_filter_blocked_probe_bit(key, i);
+        uint32_t word = block * BLOOM_FILTER_BLOCK_WORDS + bit / 32;
+        uint32_t idx = block * BLOOM_FILTER_BLOCK_BITS + bit;
+
+        if (bloom_filter_refcount_inc(bloom->refcounts, bloom->refcounts4, idx)) {
+            bloom->blocks[word] |= 1u << (bit % 32);
+        }
+    }
+}
+
+/* Documented in bloom_filter_blocked.h */
+void
+bloom_filter_blocked_remove(bloom_filter_blocked_t *bloom, uint32_t hash)
+{
+    uint32_t block = bloom_filter_blocked_block_index(bloom, hash);
+    uint32_t key = bloom_filter_blocked_probe_key(hash);
+    int i;
+
+    for (i = 0; i < bloom->k; i++) {
+        int bit = bloom_filter_blocked_probe_bit(key, i);
+        uint32_t word = block * BLOOM_FILTER_BLOCK_WORDS + bit / 32;
+        uint32_t idx = block * BLOOM_FILTER_BLOCK_BITS + bit;
+
+        /* A saturated refcount can't be decremented, see bloom_filter_remove */
+        if (bloom_filter_refcount_dec(bloom->refcounts, bloom->refcounts4, idx)) {
+            bloom->blocks[word] &= ~(1u << (bit % 32));
+        }
+    }
+}
+
+/* Spin until the tickets before 'ticket' have been retired */
+static void
+bloom_filter_blocked_remove_wait(bloom_filter_blocked_t *bloom, uint32_t ticket)
+{
+    int spins = 0;
+
+    while ((int32_t)(__atomic_load_n(&bloom->remove_done, __ATOMIC_SEQ_CST) - ticket) < 0) {
+        if (++spins < SPIN_LIMIT) {
+            CPU_RELAX();
+        }
+        else {
+            sched_yield();
+        }
+    }
+}
+
+/* Documented in bloom_filter_blocked.h */
+void
+bloom_filter_blocked_add_atomic(bloom_filter_blocked_t *bloom, uint32_t hash)
+{
+    uint32_t block = bloom_filter_blocked_block_index(bloom, hash);
+    uint32_t key = bloom_filter_blocked_probe_key(hash);
+    int i;
+
+    for (i = 0; i < bloom->k; i++) {
+        int bit = bloom_filter_blocked_probe_bit(key, i);
+        uint32_t word = block * BLOOM_FILTER_BLOCK_WORDS + bit / 32;
+        uint32_t idx = block * BLOOM_FILTER_BLOCK_BITS + bit;
+
+        /*
+         * Set the bit even if the count was already nonzero, since the
+         * add that raised it from zero may not have set it yet.
+         */
+        bloom_filter_refcount_inc_atomic(bloom->refcounts, bloom->refcounts4, idx);
+        __atomic_fetch_or(&bloom->blocks[word], 1u << (bit % 32), __ATOMIC_SEQ_CST);
+    }
+
+    /*
+     * A remove that saw a count reach zero before our increment may still
+     * clear one of our bits. It rechecks the count afterwards and sets the
+     * bit again, so wait for it. Such a remove took its ticket before our
+     * increments, so only removes already started are waited for.
+     */
+    bloom_filter_blocked_remove_wait(bloom,
+        __atomic_load_n(&bloom->remove_next, __ATOMIC_SEQ_CST));
+}
+
+/* Documented in bloom_filter_blocked.h */
+void
+bloom_filter_blocked_remove_atomic(bloom_filter_blocked_t *bloom, uint32_t hash)
+{
+    uint32_t block = bloom_filter_blocked_block_index(bloom, hash);
+    uint32_t key = bloom_filter_blocked_probe_key(hash);
+    uint32_t ticket;
+    int i;
+
+    ticket = __atomic_fetch_add(&bloom->remove_next, 1, __ATOMIC_SEQ_CST);
+
+    for (i = 0; i < bloom->k; i++) {
+        int bit = bloom_filter_blocked_probe_bit(key, i);
+        uint32_t word = block * BLOOM_FILTER_BLOCK_WORDS + bit / 32;
+        uint32_t idx = block * BLOOM_FILTER_BLOCK_BITS + bit;
+
+        if (bloom_filter_refcount_dec_atomic(bloom->refcounts, bloom->refcounts4, idx)) {
+            __atomic_fetch_and(&bloom->blocks[word], ~(1u << (bit % 32)), __ATOMIC_SEQ_CST);
+
+            /*
+             * An add may have raised the count again before we cleared.
+             * If another remove drops it back to zero before we set the
+             * bit, the bit stays set: a false positive, never a false
+             * negative.
+             */
+            if (bloom_filter_refcount_nonzero_atomic(bloom->refcounts, bloom->refcounts4, idx)) {
+                __atomic_fetch_or(&bloom->blocks[word], 1u << (bit % 32), __ATOMIC_SEQ_CST);
+            }
+        }
+    }
+
+    /*
+     * Retire tickets in order, so remove_done passing a ticket means every
+     * remove before it has finished. Earlier removes never wait for later
+     * ones, so this wait is bounded too.
+     */
+    bloom_filter_blocked_remove_wait(bloom, ticket);
+    __atomic_store_n(&bloom->remove_done, ticket + 1, __ATOMIC_SEQ_CST);
+}
@@ -0,0 +1,164 @@
+/****************************************************************
+ *
+ *        Copyright 2014, Big Switch Networks, Inc.
+ *
+ * Licensed under the Eclipse Public License, Version 1.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *        http://www.eclipse.org/legal/epl-v10.html
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the
+ * License.
+ *
+ ***************************************************************/
+
+#ifndef __BLOOM_FILTER_INT_H__
+#define __BLOOM_FILTER_INT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <AIM/aim.h>
+
+/*
+ * Reference counts for the bits of a filter. They are either uint16_t
+ * refcounts, or refcounts4 which packs two 4-bit counts per byte, low
+ * nibble first. Exactly one of the two is allocated.
+ *
+ * A count that reaches its maximum sticks there: the items that were
+ * counted are no longer known, so decrementing could clear a bit another
+ * item still needs and cause a false negative. A count of zero is not
+ * decremented either, since the item being removed was never added, and
+ * wrapping would leave the count saturated with the bit clear.
+ */
+
+#define BLOOM_FILTER_REFCOUNT4_MAX 15
+
+/* Bytes needed for the refcounts of 'bits' bits */
+static inline size_t
+bloom_filter_refcounts_size(size_t bits, bool compact)
+{
+    return compact ? (bits + 1) / 2 : bits * sizeof(uint16_t);
+}
+
+/**
+ * Increment the count for bit idx. Returns true if the bit must be set.
+ */
+static inline bool
+bloom_filter_refcount_inc(uint16_t *refcounts, uint8_t *refcounts4, uint32_t idx)
+{
+    if (refcounts4) {
+        int shift = (idx % 2) * 4;
+        int count = (refcounts4[idx / 2] >> shift) & 0xf;
+
+        if (count != BLOOM_FILTER_REFCOUNT4_MAX) {
+            refcounts4[idx / 2] += 1 << shift;
+        }
+        return count == 0;
+    }
+
+    /* Prevent overflow */
+    if (refcounts[idx] != UINT16_MAX) {
+        refcounts[idx]++;
+    }
+    return refcounts[idx] == 1;
+}
+
+/**
+ * Decrement the count for bit idx. Returns true if the bit must be cleared.
+ */
+static inline bool
+bloom_filter_refcount_dec(uint16_t *refcounts, uint8_t *refcounts4, uint32_t idx)
+{
+    if (refcounts4) {
+        int shift = (idx % 2) * 4;
+        int count = (refcounts4[idx / 2] >> shift) & 0xf;
+
+        if (count == 0 || count == BLOOM_FILTER_REFCOUNT4_MAX) {
+            return false;
+        }
+        refcounts4[idx / 2] -= 1 << shift;
+        return count == 1;
+    }
+
+    if (refcounts[idx] == 0 || refcounts[idx] == UINT16_MAX) {
+        return false;
+    }
+    return --refcounts[idx] == 0;
+}
+
+/*
+ * Atomic versions of the above for concurrent writers. A packed count is
+ * updated with a compare and swap on its whole byte.
+ */
+
+static inline bool
+bloom_filter_refcount_inc_atomic(uint16_t *refcounts, uint8_t *refcounts4, uint32_t idx)
+{
+    if (refcounts4) {
+        int shift = (idx % 2) * 4;
+        uint8_t old = __atomic_load_n(&refcounts4[idx / 2], __ATOMIC_RELAXED);
+        int count;
+        do {
+            count = (old >> shift) & 0xf;
+            if (count == BLOOM_FILTER_REFCOUNT4_MAX) {
+                return false;
+            }
+        } while (!__atomic_compare_exchange_n(&refcounts4[idx / 2], &old, old + (1 << shift),
+                                              false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+        return count == 0;
+    }
+    else {
+        uint16_t old = __atomic_load_n(&refcounts[idx], __ATOMIC_RELAXED);
+        do {
+            if (old == UINT16_MAX) {
+                return false;
+            }
+        } while (!__atomic_compare_exchange_n(&refcounts[idx], &old, old + 1,
+                                              false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+        return old == 0;
+    }
+}
+
+static inline bool
+bloom_filter_refcount_dec_atomic(uint16_t *refcounts, uint8_t *refcounts4, uint32_t idx)
+{
+    if (refcounts4) {
+        int shift = (idx % 2) * 4;
+        uint8_t old = __atomic_load_n(&refcounts4[idx / 2], __ATOMIC_RELAXED);
+        int count;
+        do {
+            count = (old >> shift) & 0xf;
+            if (count == 0 || count == BLOOM_FILTER_REFCOUNT4_MAX) {
+                return false;
+            }
+        } while (!__atomic_compare_exchange_n(&refcounts4[idx / 2], &old, old - (1 << shift),
+                                              false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+        return count == 1;
+    }
+    else {
+        uint16_t old = __atomic_load_n(&refcounts[idx], __ATOMIC_RELAXED);
+        do {
+            if (old == 0 || old == UINT16_MAX) {
+                return false;
+            }
+        } while (!__atomic_compare_exchange_n(&refcounts[idx], &old, old - 1,
+                                              false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+        return old == 1;
+    }
+}
+
+static inline bool
+bloom_filter_refcount_nonzero_atomic(uint16_t *refcounts, uint8_t *refcounts4, uint32_t idx)
+{
+    if (refcounts4) {
+        return (__atomic_load_n(&refcounts4[idx / 2], __ATOMIC_SEQ_CST) >> ((idx % 2) * 4)) & 0xf;
+    }
+    return __atomic_load_n(&refcounts[idx], __ATOMIC_SEQ_CST) != 0;
+}
+
+#endif /* __BLOOM_FILTER_INT_H__ */
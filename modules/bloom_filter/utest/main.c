@@ -17,11 +17,15 @@
  *
  ***************************************************************/
 #include <bloom_filter/bloom_filter.h>
+#include <bloom_filter/bloom_filter_blocked.h>
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <AIM/aim.h>
+#include <OS/os_time.h>
+#include <pthread.h>
+#include <sched.h>
 
 /*
  * Construct a "hash" such that we control which bits the
@@ -33,15 +37,28 @@ make_hash(int bit0, int bit1)
     return bit0 | (bit1 << 16);
 }
 
+static bloom_filter_t *
+create(int m, bool compact)
+{
+    return compact ? bloom_filter_create_compact(m) : bloom_filter_create(m);
+}
+
+/* Count at which a refcount saturates */
+static int
+saturation(bool compact)
+{
+    return compact ? 15 : UINT16_MAX;
+}
+
 static void
-test_basic(void)
+test_basic(bool compact)
 {
     const uint32_t h1 = make_hash(0, 1);
     const uint32_t h2 = make_hash(2, 3);
     const uint32_t h3 = make_hash(0, 3);
 
     /* Empty set */
-    bloom_filter_t *bloom = bloom_filter_create(8);
+    bloom_filter_t *bloom = create(8, compact);
     AIM_ASSERT(!bloom_filter_lookup(bloom, h1));
     AIM_ASSERT(!bloom_filter_lookup(bloom, h2));
     AIM_ASSERT(!bloom_filter_lookup(bloom, h3));
@@ -91,18 +108,18 @@ test_basic(void)
  * removals will not decrement the refcount, to avoid false negatives.
  */
 static void
-test_saturated(void)
+test_saturated(bool compact)
 {
     const uint32_t h = make_hash(0, 1);
-    bloom_filter_t *bloom = bloom_filter_create(8);
+    bloom_filter_t *bloom = create(8, compact);
     int i;
 
-    for (i = 0; i < UINT16_MAX; i++) {
+    for (i = 0; i < saturation(compact); i++) {
         bloom_filter_add(bloom, h);
         AIM_ASSERT(bloom_filter_lookup(bloom, h));
     }
 
-    for (i = 0; i < UINT16_MAX; i++) {
+    for (i = 0; i < saturation(compact); i++) {
         AIM_ASSERT(bloom_filter_lookup(bloom, h));
         bloom_filter_remove(bloom, h);
     }
@@ -118,18 +135,18 @@ test_saturated(void)
  * so doesn't hit the saturation condition.
  */
 static void
-test_unsaturated(void)
+test_unsaturated(bool compact)
 {
     const uint32_t h = make_hash(0, 1);
-    bloom_filter_t *bloom = bloom_filter_create(8);
+    bloom_filter_t *bloom = create(8, compact);
     int i;
 
-    for (i = 0; i < UINT16_MAX-1; i++) {
+    for (i = 0; i < saturation(compact)-1; i++) {
         bloom_filter_add(bloom, h);
         AIM_ASSERT(bloom_filter_lookup(bloom, h));
     }
 
-    for (i = 0; i < UINT16_MAX-1; i++) {
+    for (i = 0; i < saturation(compact)-1; i++) {
         AIM_ASSERT(bloom_filter_lookup(bloom, h));
         bloom_filter_remove(bloom, h);
     }
@@ -139,6 +156,65 @@ test_unsaturated(void)
     bloom_filter_destroy(bloom);
 }
 
+/*
+ * Removing an item that was never added must not wrap its refcounts,
+ * which would leave them stuck and the item unfindable once added.
+ */
+static void
+test_remove_absent(bool compact)
+{
+    const uint32_t h1 = make_hash(0, 1);
+    const uint32_t h2 = make_hash(2, 3);
+    bloom_filter_t *bloom = create(8, compact);
+
+    bloom_filter_remove(bloom, h1);
+    bloom_filter_add(bloom, h1);
+    AIM_ASSERT(bloom_filter_lookup(bloom, h1));
+
+    bloom_filter_remove(bloom, h2);
+    bloom_filter_add(bloom, h2);
+    AIM_ASSERT(bloom_filter_lookup(bloom, h2));
+
+    bloom_filter_remove(bloom, h1);
+    bloom_filter_remove(bloom, h2);
+    AIM_ASSERT(!bloom_filter_lookup(bloom, h1));
+    AIM_ASSERT(!bloom_filter_lookup(bloom, h2));
+
+    bloom_filter_destroy(bloom);
+}
+
+/*
+ * Neighbouring 4-bit refcounts share a byte and must not disturb each
+ * other, including when one of them saturates.
+ */
+static void
+test_compact_neighbours(void)
+{
+    bloom_filter_t *bloom = bloom_filter_create_compact(8);
+    int i, j;
+
+    /* Both probes use bit i, so it gets 2*(2i+1) references. Bits 4-7 saturate */
+    for (i = 0; i < 8; i++) {
+        for (j = 0; j <= i*2; j++) {
+            bloom_filter_add(bloom, make_hash(i, i));
+        }
+    }
+
+    for (i = 0; i < 8; i++) {
+        for (j = 0; j <= i*2; j++) {
+            AIM_ASSERT(bloom_filter_lookup(bloom, make_hash(i, i)));
+            bloom_filter_remove(bloom, make_hash(i, i));
+        }
+    }
+
+    for (i = 0; i < 8; i++) {
+        AIM_ASSERT(bloom_filter_lookup(bloom, make_hash(i, i)) ==
+                   ((i*2+1)*2 >= 15));
+    }
+
+    bloom_filter_destroy(bloom);
+}
+
 /*
  * Create a bloom filter with an estimated 5% false positive rate
  * and run random queries to see if the actual false positive rate
@@ -175,11 +251,480 @@ test_false_positive_rate(void)
     bloom_filter_destroy(bloom);
 }
 
+/*
+ * random() only returns 31 bits, and the blocked filter picks the block
+ * with the high bits.
+ */
+static uint32_t
+random_hash(void)
+{
+    return ((uint32_t)random() << 16) ^ (uint32_t)random();
+}
+
+/*
+ * Add and remove random items for each probe count. There must be no
+ * false negatives, and removing everything must clear every bit.
+ */
+static void
+test_blocked_basic(bool compact)
+{
+    static const int ks[] = { 1, 4, 8, 16 };
+    const int num_items = 4096;
+    uint32_t *hashes = aim_zmalloc(num_items * sizeof(*hashes));
+    int i, j;
+
+    for (i = 0; i < AIM_ARRAYSIZE(ks); i++) {
+        bloom_filter_blocked_t *bloom = compact ?
+            bloom_filter_blocked_create_compact(num_items*16, ks[i]) :
+            bloom_filter_blocked_create(num_items*16, ks[i]);
+
+        for (j = 0; j < num_items; j++) {
+            hashes[j] = random_hash();
+            bloom_filter_blocked_add(bloom, hashes[j]);
+            AIM_ASSERT(bloom_filter_blocked_lookup(bloom, hashes[j]));
+        }
+
+        for (j = 0; j < num_items; j++) {
+            AIM_ASSERT(bloom_filter_blocked_lookup(bloom, hashes[j]));
+        }
+
+        /* Remove the first half, the second half must still be found */
+        for (j = 0; j < num_items/2; j++) {
+            bloom_filter_blocked_remove(bloom, hashes[j]);
+        }
+        for (j = num_items/2; j < num_items; j++) {
+            AIM_ASSERT(bloom_filter_blocked_lookup(bloom, hashes[j]));
+        }
+
+        for (j = num_items/2; j < num_items; j++) {
+            bloom_filter_blocked_remove(bloom, hashes[j]);
+        }
+        for (j = 0; j < bloom->num_blocks * BLOOM_FILTER_BLOCK_WORDS; j++) {
+            AIM_ASSERT(bloom->blocks[j] == 0);
+        }
+        for (j = 0; j < num_items; j++) {
+            AIM_ASSERT(!bloom_filter_blocked_lookup(bloom, hashes[j]));
+        }
+
+        bloom_filter_blocked_destroy(bloom);
+    }
+
+    aim_free(hashes);
+}
+
+/*
+ * As test_saturated, for the blocked filter.
+ */
+static void
+test_blocked_saturated(bool compact)
+{
+    const uint32_t h = 0x12345678;
+    bloom_filter_blocked_t *bloom = compact ?
+        bloom_filter_blocked_create_compact(512, 8) :
+        bloom_filter_blocked_create(512, 8);
+    int i;
+
+    for (i = 0; i < saturation(compact); i++) {
+        bloom_filter_blocked_add(bloom, h);
+    }
+
+    for (i = 0; i < saturation(compact); i++) {
+        AIM_ASSERT(bloom_filter_blocked_lookup(bloom, h));
+        bloom_filter_blocked_remove(bloom, h);
+    }
+
+    AIM_ASSERT(bloom_filter_blocked_lookup(bloom, h));
+
+    bloom_filter_blocked_destroy(bloom);
+}
+
+/*
+ * Check the false positive rates documented in bloom_filter_blocked.h,
+ * within 10%.
+ */
+static void
+test_blocked_false_positive_rate__(int bits_per_item, int k, double expected)
+{
+    const int num_items = 65536;
+    const int num_queries = 1000000;
+    bloom_filter_blocked_t *bloom = bloom_filter_blocked_create(num_items*bits_per_item, k);
+    int i;
+    int hits = 0;
+
+    for (i = 0; i < num_items; i++) {
+        bloom_filter_blocked_add(bloom, random_hash());
+    }
+
+    for (i = 0; i < num_queries; i++) {
+        hits += bloom_filter_blocked_lookup(bloom, random_hash()) ? 1 : 0;
+    }
+
+    double false_positive_rate = hits*1.0/num_queries;
+
+    AIM_ASSERT(false_positive_rate > 0.9 * expected);
+    AIM_ASSERT(false_positive_rate < 1.1 * expected);
+
+    bloom_filter_blocked_destroy(bloom);
+}
+
+static void
+test_blocked_false_positive_rate(void)
+{
+    test_blocked_false_positive_rate__(8, 4, 0.025);
+    test_blocked_false_positive_rate__(16, 8, 0.0009);
+}
+
+/*
+ * Readers look up stable items while the main thread adds more of them
+ * and writer threads keep adding and removing their own churn items,
+ * all with the atomic functions. A stable item must be found once its
+ * add has returned.
+ */
+#define CONCURRENT_STABLE 20000
+#define CONCURRENT_CHURN 1000
+#define CONCURRENT_READERS 2
+#define CONCURRENT_WRITERS 2
+#define CONCURRENT_LOOKUPS 200000
+
+typedef struct concurrent_test {
+    bloom_filter_blocked_t *bloom;
+    int stable_count;
+    int stop;
+    int errors;
+    uint64_t lookups;
+} concurrent_test_t;
+
+typedef struct concurrent_writer {
+    concurrent_test_t *t;
+    int id;
+} concurrent_writer_t;
+
+static uint32_t
+concurrent_hash(uint32_t id)
+{
+    return id * 0x9e3779b1;
+}
+
+static void *
+concurrent_reader__(void *arg)
+{
+    concurrent_test_t *t = arg;
+    uint64_t lookups = 0;
+    uint32_t r = (uintptr_t)&lookups;
+
+    while (!__atomic_load_n(&t->stop, __ATOMIC_ACQUIRE)) {
+        int stable_count = __atomic_load_n(&t->stable_count, __ATOMIC_ACQUIRE);
+        if (stable_count == 0) {
+            continue;
+        }
+        r = r * 1103515245 + 12345;
+        if (!bloom_filter_blocked_lookup(t->bloom, concurrent_hash((r >> 8) % stable_count))) {
+            __atomic_add_fetch(&t->errors, 1, __ATOMIC_RELAXED);
+        }
+        if (++lookups % 1024 == 0) {
+            __atomic_add_fetch(&t->lookups, 1024, __ATOMIC_RELAXED);
+        }
+    }
+
+    return NULL;
+}
+
+static void *
+concurrent_writer__(void *arg)
+{
+    concurrent_writer_t *w = arg;
+    uint32_t base = CONCURRENT_STABLE + w->id * CONCURRENT_CHURN;
+    int i;
+
+    while (!__atomic_load_n(&w->t->stop, __ATOMIC_ACQUIRE)) {
+        for (i = 0; i < CONCURRENT_CHURN; i++) {
+            bloom_filter_blocked_add_atomic(w->t->bloom, concurrent_hash(base + i));
+        }
+        for (i = 0; i < CONCURRENT_CHURN; i++) {
+            bloom_filter_blocked_remove_atomic(w->t->bloom, concurrent_hash(base + i));
+        }
+    }
+
+    return NULL;
+}
+
+static void
+test_blocked_concurrent(bool compact)
+{
+    concurrent_test_t t = { 0 };
+    concurrent_writer_t writers[CONCURRENT_WRITERS];
+    pthread_t threads[CONCURRENT_READERS + CONCURRENT_WRITERS];
+    int i;
+
+    /* Small enough that stable and churn items share bits */
+    t.bloom = compact ?
+        bloom_filter_blocked_create_compact(CONCURRENT_STABLE * 4, 4) :
+        bloom_filter_blocked_create(CONCURRENT_STABLE * 4, 4);
+
+    for (i = 0; i < CONCURRENT_READERS; i++) {
+        AIM_ASSERT(pthread_create(&threads[i], NULL, concurrent_reader__, &t) == 0);
+    }
+    for (i = 0; i < CONCURRENT_WRITERS; i++) {
+        writers[i].t = &t;
+        writers[i].id = i;
+        AIM_ASSERT(pthread_create(&threads[CONCURRENT_READERS + i], NULL,
+                                  concurrent_writer__, &writers[i]) == 0);
+    }
+
+    for (i = 0; i < CONCURRENT_STABLE; i++) {
+        bloom_filter_blocked_add_atomic(t.bloom, concurrent_hash(i));
+        __atomic_store_n(&t.stable_count, i + 1, __ATOMIC_RELEASE);
+    }
+
+    /* Let the readers run against the churn for a while */
+    while (__atomic_load_n(&t.lookups, __ATOMIC_RELAXED) < CONCURRENT_LOOKUPS) {
+        sched_yield();
+    }
+
+    __atomic_store_n(&t.stop, 1, __ATOMIC_RELEASE);
+    for (i = 0; i < CONCURRENT_READERS + CONCURRENT_WRITERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    if (t.errors) {
+        AIM_DIE("%d concurrent false negatives", t.errors);
+    }
+
+    for (i = 0; i < CONCURRENT_STABLE; i++) {
+        AIM_ASSERT(bloom_filter_blocked_lookup(t.bloom, concurrent_hash(i)));
+    }
+
+    bloom_filter_blocked_destroy(t.bloom);
+}
+
+/*
+ * Benchmark: false positive rate against lookup cost for the classic
+ * filter and the blocked filter with several probe counts, at 8 and 16
+ * bits per item. The classic filter is capped at 65536 bits, so it only
+ * runs at the small size. The large size doesn't fit in cache, which is
+ * where blocking pays off.
+ */
+#define PERF_QUERIES (4*1024*1024)
+
+static uint32_t *perf_queries;
+
+static void
+perf_report(const char *name, int m, int k, uint64_t start, uint64_t end, int hits)
+{
+    printf("%-8s m=%-9d k=%-2d fpr %6.3f%%  %6.2f ns/lookup\n",
+                name, m, k, 100.0 * hits / PERF_QUERIES,
+                (end - start) * 1000.0 / PERF_QUERIES);
+}
+
+static void
+perf_classic(int m, int bits_per_item)
+{
+    bloom_filter_t *bloom = bloom_filter_create(m);
+    uint64_t start, end;
+    int i, hits = 0;
+
+    for (i = 0; i < m / bits_per_item; i++) {
+        bloom_filter_add(bloom, random_hash());
+    }
+
+    start = os_time_thread();
+    for (i = 0; i < PERF_QUERIES; i++) {
+        hits += bloom_filter_lookup(bloom, perf_queries[i]);
+    }
+    end = os_time_thread();
+
+    perf_report("classic", m, BLOOM_FILTER_NUM_PROBES, start, end, hits);
+    bloom_filter_destroy(bloom);
+}
+
+static void
+perf_blocked(int m, int bits_per_item, int k)
+{
+    bloom_filter_blocked_t *bloom = bloom_filter_blocked_create(m, k);
+    uint64_t start, end;
+    int i, hits = 0;
+
+    for (i = 0; i < m / bits_per_item; i++) {
+        bloom_filter_blocked_add(bloom, random_hash());
+    }
+
+    start = os_time_thread();
+    for (i = 0; i < PERF_QUERIES; i++) {
+        hits += bloom_filter_blocked_lookup(bloom, perf_queries[i]);
+    }
+    end = os_time_thread();
+
+    perf_report("blocked", m, k, start, end, hits);
+    bloom_filter_blocked_destroy(bloom);
+}
+
+static void
+perftest(void)
+{
+    static const int ms[] = { 65536, 64*1024*1024 };
+    static const int bits_per_items[] = { 8, 16 };
+    static const int ks[] = { 2, 4, 6, 8, 12, 16 };
+    int i, j, l;
+
+    perf_queries = aim_zmalloc(PERF_QUERIES * sizeof(*perf_queries));
+    for (i = 0; i < PERF_QUERIES; i++) {
+        perf_queries[i] = random_hash();
+    }
+
+    for (i = 0; i < AIM_ARRAYSIZE(bits_per_items); i++) {
+        printf("M/N = %d\n", bits_per_items[i]);
+        for (j = 0; j < AIM_ARRAYSIZE(ms); j++) {
+            if (ms[j] <= UINT16_MAX+1) {
+                perf_classic(ms[j], bits_per_items[i]);
+            }
+            for (l = 0; l < AIM_ARRAYSIZE(ks); l++) {
+                perf_blocked(ms[j], bits_per_items[i], ks[l]);
+            }
+        }
+    }
+
+    aim_free(perf_queries);
+}
+
+/*
+ * Benchmark: lookup throughput while a writer adds and removes items,
+ * lock-free against serializing lookups and updates with a mutex.
+ */
+#define PERF_CONCURRENT_LOOKUPS (4*1024*1024)
+
+typedef struct perf_concurrent {
+    bloom_filter_blocked_t *bloom;
+    pthread_mutex_t *lock;
+    int stop;
+    uint64_t updates;
+} perf_concurrent_t;
+
+static void *
+perf_concurrent_reader__(void *arg)
+{
+    perf_concurrent_t *p = arg;
+    uint32_t r = (uintptr_t)&r;
+    int i, hits = 0;
+
+    for (i = 0; i < PERF_CONCURRENT_LOOKUPS; i++) {
+        r = r * 1103515245 + 12345;
+        if (p->lock) {
+            pthread_mutex_lock(p->lock);
+        }
+        hits += bloom_filter_blocked_lookup(p->bloom, r);
+        if (p->lock) {
+            pthread_mutex_unlock(p->lock);
+        }
+    }
+
+    return (void *)(uintptr_t)hits;
+}
+
+static void *
+perf_concurrent_writer__(void *arg)
+{
+    perf_concurrent_t *p = arg;
+    uint64_t updates = 0;
+    uint32_t i = 0;
+
+    while (!__atomic_load_n(&p->stop, __ATOMIC_ACQUIRE)) {
+        uint32_t hash = concurrent_hash(i++ % 65536 + (1u << 20));
+        if (p->lock) {
+            pthread_mutex_lock(p->lock);
+            bloom_filter_blocked_add(p->bloom, hash);
+            bloom_filter_blocked_remove(p->bloom, hash);
+            pthread_mutex_unlock(p->lock);
+        }
+        else {
+            bloom_filter_blocked_add_atomic(p->bloom, hash);
+            bloom_filter_blocked_remove_atomic(p->bloom, hash);
+        }
+        updates += 2;
+    }
+
+    p->updates = updates;
+    return NULL;
+}
+
+static void
+perf_concurrent(int readers, bool writer, bool locked)
+{
+    perf_concurrent_t p = { 0 };
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    pthread_t reader_threads[readers], writer_thread;
+    uint64_t start, end;
+    int i;
+
+    p.bloom = bloom_filter_blocked_create_compact(64*1024*1024, 8);
+    p.lock = locked ? &lock : NULL;
+    for (i = 0; i < 4*1024*1024; i++) {
+        bloom_filter_blocked_add(p.bloom, concurrent_hash(i));
+    }
+
+    start = os_time_monotonic();
+    if (writer) {
+        AIM_ASSERT(pthread_create(&writer_thread, NULL, perf_concurrent_writer__, &p) == 0);
+    }
+    for (i = 0; i < readers; i++) {
+        AIM_ASSERT(pthread_create(&reader_threads[i], NULL, perf_concurrent_reader__, &p) == 0);
+    }
+    for (i = 0; i < readers; i++) {
+        pthread_join(reader_threads[i], NULL);
+    }
+    end = os_time_monotonic();
+    __atomic_store_n(&p.stop, 1, __ATOMIC_RELEASE);
+    if (writer) {
+        pthread_join(writer_thread, NULL);
+    }
+
+    printf("%d readers, %-9s %-7s %6.1f M lookups/sec, %6.2f M updates/sec\n",
+           readers, writer ? "writer," : "no writer", locked ? "mutex" : "atomic",
+           (double)readers * PERF_CONCURRENT_LOOKUPS / (end - start),
+           (double)p.updates / (end - start));
+
+    bloom_filter_blocked_destroy(p.bloom);
+}
+
+static void
+perftest_concurrent(void)
+{
+    int readers;
+
+    for (readers = 1; readers <= 4; readers *= 2) {
+        perf_concurrent(readers, false, false);
+        perf_concurrent(readers, true, false);
+        perf_concurrent(readers, true, true);
+    }
+}
+
 int aim_main(int argc, char* argv[])
 {
-    test_basic();
-    test_saturated();
-    test_unsaturated();
+    if (argc > 1 && !strcmp(argv[1], "perf")) {
+        if (argc > 2 && !strcmp(argv[2], "concurrent")) {
+            perftest_concurrent();
+        }
+        else {
+            perftest();
+        }
+        return 0;
+    }
+
+    test_basic(false);
+    test_basic(true);
+    test_saturated(false);
+    test_saturated(true);
+    test_unsaturated(false);
+    test_unsaturated(true);
+    test_remove_absent(false);
+    test_remove_absent(true);
+    test_compact_neighbours();
     test_false_positive_rate();
+    test_blocked_basic(false);
+    test_blocked_basic(true);
+    test_blocked_saturated(false);
+    test_blocked_saturated(true);
+    test_blocked_concurrent(false);
+    test_blocked_concurrent(true);
+    test_blocked_false_positive_rate();
     return 0;
 }
@@ -23,6 +23,7 @@
 #include "pimu_log.h"
 
 #include <nwac/nwac.h>
+#include <nwac/nwac_stats.h>
 #include <AIM/aim_rl.h>
 
 #include <inttypes.h>
@@ -92,6 +93,9 @@ pimu_create(uint32_t block_size, uint32_t entry_count)
     pimu_t* pimu = aim_zmalloc(sizeof(*pimu));
     pimu->nwac = nwac_create(block_size, PIMU_CONFIG_PACKET_KEY_SIZE,
                              sizeof(pimu_entry_t), entry_count);
+#if NWAC_CONFIG_INCLUDE_STATS == 1
+    nwac_stats_register(pimu->nwac, "pimu.flows");
+#endif
     return pimu;
 }
 
@@ -179,17 +183,19 @@ pimu_flow_action__(pimu_t* pimu, int pid,
         }
         data = key;
     }
-    pe = (pimu_entry_t*)nwac_search(pimu->nwac, data, now);
+    /* The entry's block stays locked while it is used */
+    pe = (pimu_entry_t*)nwac_search_lock(pimu->nwac, data, now);
     if(pe) {
+        pimu_action_t action;
         if(pe->hdr.valid && (pimu->keyf || pe->pid == pid)) {
             /** Entry exists and the ingress port hasn't changed */
             if(aim_ratelimiter_limit(&pe->rl, now) == 0) {
                 /* Allowed */
-                return PIMU_ACTION_FORWARD_EXISTING;
+                action = PIMU_ACTION_FORWARD_EXISTING;
             }
             else {
                 /* Rate limit exceeded */
-                return PIMU_ACTION_DROP;
+                action = PIMU_ACTION_DROP;
             }
         }
         else {
@@ -200,8 +206,10 @@ pimu_flow_action__(pimu_t* pimu, int pid,
                                  pimu->flow_burst, NULL);
             aim_ratelimiter_limit(&pe->rl, now);
             pe->pid = pid;
-            return PIMU_ACTION_FORWARD_NEW;
+            action = PIMU_ACTION_FORWARD_NEW;
         }
+        nwac_entry_unlock(pimu->nwac, (nwac_entry_t*)pe);
+        return action;
     }
     else {
         /* This should only happen if 'now' is zero */